@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AIAwarenessSubsystem.h"
+#include "AI_GameCharacter.h"
+#include "Game_AIController.h"
+#include "AISimulationStats.h"
+#include "Async/ParallelFor.h"
+
+void UAIAwarenessSubsystem::RegisterCharacter(AAI_GameCharacter* character)
+{
+	if (character) Characters.AddUnique(character);
+}
+
+void UAIAwarenessSubsystem::UnregisterCharacter(AAI_GameCharacter* character)
+{
+	Characters.Remove(character);
+	//A character that died this frame is gone for everyone right away, not on the next Update
+	for (AGame_AIController* controller : Controllers) controller->ForgetNearbyEnemy(character);
+}
+
+void UAIAwarenessSubsystem::RegisterController(AGame_AIController* controller)
+{
+	if (controller) Controllers.AddUnique(controller);
+}
+
+void UAIAwarenessSubsystem::UnregisterController(AGame_AIController* controller)
+{
+	Controllers.Remove(controller);
+}
+
+void UAIAwarenessSubsystem::Update()
+{
+	double startTime = FPlatformTime::Seconds();
+	HashedCharacters.Reset();
+	TMap<AAI_GameCharacter*, int32> hashIndices;
+	TArray<FVector> locations;
+	locations.Reserve(Characters.Num());
+	for (AAI_GameCharacter* character : Characters)
+	{
+		if (!IsValid(character)) continue;
+
+		hashIndices.Add(character, HashedCharacters.Add(character));
+		locations.Add(character->GetActorLocation());
+	}
+
+	float cellSize = MinCellSize;
+	for (AGame_AIController* controller : Controllers) cellSize = FMath::Max(cellSize, controller->GetNearbyEnemyRange());
+	Hash.Build(locations, cellSize);
+
+	//Each controller writes only its own results, they are handed out after the queries
+	TArray<TArray<int32>> results;
+	results.SetNum(Controllers.Num());
+	TArray<int32> ownIndices;
+	ownIndices.Init(INDEX_NONE, Controllers.Num());
+	for (int32 i = 0; i < Controllers.Num(); i++)
+	{
+		if (const int32* index = hashIndices.Find(Controllers[i]->GetCharacter())) ownIndices[i] = *index;
+	}
+	ParallelFor(Controllers.Num(), [&](int32 i)
+	{
+		if (ownIndices[i] == INDEX_NONE) return;
+
+		Hash.FindInRadius(Hash.GetPoint(ownIndices[i]), Controllers[i]->GetNearbyEnemyRange(), results[i], ownIndices[i]);
+	});
+
+	TArray<AAI_GameCharacter*> enemies;
+	for (int32 i = 0; i < Controllers.Num(); i++)
+	{
+		enemies.Reset(results[i].Num());
+		for (int32 index : results[i]) enemies.Add(HashedCharacters[index]);
+		Controllers[i]->SetNearbyEnemies(enemies);
+	}
+	FAISimulationStats::Get().DecisionSeconds += FPlatformTime::Seconds() - startTime;
+}
+
+TArray<AAI_GameCharacter*> UAIAwarenessSubsystem::FindCharactersInRadius(FVector location, float radius, AAI_GameCharacter* ignore) const
+{
+	TArray<int32> indices;
+	Hash.FindInRadius(location, radius, indices, HashedCharacters.Find(ignore));
+
+	TArray<AAI_GameCharacter*> characters;
+	characters.Reserve(indices.Num());
+	for (int32 index : indices)
+	{
+		if (IsValid(HashedCharacters[index])) characters.Add(HashedCharacters[index]);
+	}
+	return characters;
+}
+
+TArray<AAI_GameCharacter*> UAIAwarenessSubsystem::FindNearestCharacters(FVector location, int32 count, float maxRadius, AAI_GameCharacter* ignore) const
+{
+	TArray<int32> indices;
+	Hash.FindNearest(location, count, maxRadius, indices, HashedCharacters.Find(ignore));
+
+	TArray<AAI_GameCharacter*> characters;
+	characters.Reserve(indices.Num());
+	for (int32 index : indices)
+	{
+		if (IsValid(HashedCharacters[index])) characters.Add(HashedCharacters[index]);
+	}
+	return characters;
+}
+
+void UAIAwarenessSubsystem::Tick(float DeltaTime)
+{
+	Update();
+}
+
+bool UAIAwarenessSubsystem::IsTickable() const
+{
+	return !IsTemplate() && GetWorld() && GetWorld()->HasBegunPlay();
+}
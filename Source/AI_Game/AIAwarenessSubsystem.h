@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SpatialHash.h"
+#include "AIAwarenessSubsystem.generated.h"
+
+class AAI_GameCharacter;
+class AGame_AIController;
+
+/**
+ * Which characters every AI controller is aware of.
+ * Once per frame the live characters are put in a spatial hash and every controller gets the enemies within its
+ * NearbyEnemyRange, nearest first, all controllers queried together on the worker threads.
+ * Characters and controllers register themselves in BeginPlay and leave in EndPlay.
+ */
+UCLASS()
+class AI_GAME_API UAIAwarenessSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterCharacter(AAI_GameCharacter* character);
+	void UnregisterCharacter(AAI_GameCharacter* character);
+	void RegisterController(AGame_AIController* controller);
+	void UnregisterController(AGame_AIController* controller);
+
+	//Rebuilds the hash from where the characters are now and hands every controller its nearby enemies
+	void Update();
+
+	//Characters within radius of location, nearest first, as of the last Update
+	UFUNCTION(BlueprintCallable)
+		TArray<AAI_GameCharacter*> FindCharactersInRadius(FVector location, float radius, AAI_GameCharacter* ignore = nullptr) const;
+	//The count characters nearest to location and within maxRadius, nearest first, as of the last Update
+	UFUNCTION(BlueprintCallable)
+		TArray<AAI_GameCharacter*> FindNearestCharacters(FVector location, int32 count, float maxRadius, AAI_GameCharacter* ignore = nullptr) const;
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override { RETURN_QUICK_DECLARE_CYCLE_STAT(UAIAwarenessSubsystem, STATGROUP_Tickables); }
+
+protected:
+	UPROPERTY(Transient)
+		TArray<AAI_GameCharacter*> Characters;
+	UPROPERTY(Transient)
+		TArray<AGame_AIController*> Controllers;
+
+	//Characters in the order they were hashed, Hash point i is HashedCharacters[i]
+	UPROPERTY(Transient)
+		TArray<AAI_GameCharacter*> HashedCharacters;
+	FSpatialHash Hash;
+	//Smallest cell of the hash, the cells follow the largest NearbyEnemyRange so a controller's query looks at 3x3 cells
+	float MinCellSize = 500.0f;
+};
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AIDecisionScheduler.h"
+#include "Game_AIController.h"
+#include "AI_GameCharacter.h"
+#include "AISimulationStats.h"
+#include "GameFramework/PlayerController.h"
+#include "Async/ParallelFor.h"
+
+void UAIDecisionScheduler::RegisterController(AGame_AIController* controller)
+{
+	if (!controller) return;
+
+	//Spread the first decisions over one interval, one bucket after the other
+	float interval = 1.0f / FMath::Max(DecisionRate, KINDA_SMALL_NUMBER);
+	int32 bucketCount = FMath::Max(DecisionBuckets, 1);
+	float phase = interval * (RegisteredCount++ % bucketCount) / bucketCount;
+	Controllers.Add({ controller, GetWorld()->GetTimeSeconds() + phase });
+}
+
+void UAIDecisionScheduler::UnregisterController(AGame_AIController* controller)
+{
+	//A commit can kill a pawn and end its controller's play, the entries stay where they are until the loop is done
+	if (Committing)
+	{
+		for (FScheduledController& scheduled : Controllers)
+		{
+			if (scheduled.Controller == controller) scheduled.Controller = nullptr;
+		}
+		return;
+	}
+
+	Controllers.RemoveAll([controller](const FScheduledController& scheduled) { return scheduled.Controller == controller; });
+}
+
+float UAIDecisionScheduler::GetDecisionInterval(const FVector& location, const TArray<FVector>& viewLocations) const
+{
+	float rate = FMath::Max(DecisionRate, KINDA_SMALL_NUMBER);
+	if (viewLocations.Num() == 0) return 1.0f / rate;
+
+	float closestDistanceSquared = MAX_flt;
+	for (const FVector& viewLocation : viewLocations) closestDistanceSquared = FMath::Min(closestDistanceSquared, FVector::DistSquared(location, viewLocation));
+
+	float alpha = FMath::Clamp((FMath::Sqrt(closestDistanceSquared) - NearDistance) / FMath::Max(FarDistance - NearDistance, 1.0f), 0.0f, 1.0f);
+	return 1.0f / (rate * FMath::Lerp(1.0f, FMath::Max(FarRateScale, KINDA_SMALL_NUMBER), alpha));
+}
+
+void UAIDecisionScheduler::Tick(float DeltaTime)
+{
+	UWorld* world = GetWorld();
+	double now = world->GetTimeSeconds();
+
+	TArray<FVector> viewLocations;
+	for (FConstPlayerControllerIterator it = world->GetPlayerControllerIterator(); it; ++it)
+	{
+		if (!it->IsValid()) continue;
+
+		FVector location;
+		FRotator rotation;
+		(*it)->GetPlayerViewPoint(location, rotation);
+		viewLocations.Add(location);
+	}
+
+	//Most overdue first
+	TArray<int32> due;
+	for (int32 i = 0; i < Controllers.Num(); i++)
+	{
+		if (Controllers[i].NextDecisionTime <= now && IsValid(Controllers[i].Controller->GetCharacter())) due.Add(i);
+	}
+	due.Sort([this](int32 a, int32 b) { return Controllers[a].NextDecisionTime < Controllers[b].NextDecisionTime || (Controllers[a].NextDecisionTime == Controllers[b].NextDecisionTime && a < b); });
+	if (MaxDecisionsPerFrame > 0 && due.Num() > MaxDecisionsPerFrame) due.SetNum(MaxDecisionsPerFrame, false);
+
+	if (due.Num() == 0) return;
+
+	double startTime = FPlatformTime::Seconds();
+	Inputs.SetNum(due.Num(), false);
+	Decisions.SetNum(due.Num(), false);
+	Locations.SetNum(due.Num(), false);
+	for (int32 i = 0; i < due.Num(); i++)
+	{
+		Inputs[i] = Controllers[due[i]].Controller->GatherDecisionInput();
+		Locations[i] = Inputs[i].Location;
+	}
+
+	//The controllers share the grid, their cells are snapped in one batch
+	if (AGridManager* gridManager = Controllers[due[0]].Controller->GridManager)
+	{
+		gridManager->GetClosestWalkableCellIndices(Locations, CellIndices);
+		for (int32 i = 0; i < due.Num(); i++) Inputs[i].CellIndex = CellIndices[i];
+	}
+
+	//Each decision only reads its own input and draws from its own controller's random stream
+	ParallelFor(due.Num(), [this, &due](int32 i)
+	{
+		Decisions[i] = Controllers[due[i]].Controller->Decide(Inputs[i]);
+	});
+
+	//Pick up queries, traces, path requests and shots touch the world, in the same order every run
+	Committing = true;
+	for (int32 i = 0; i < due.Num(); i++)
+	{
+		//Killed by an earlier commit this frame
+		if (!Controllers[due[i]].Controller) continue;
+
+		Controllers[due[i]].Controller->CommitDecision(Decisions[i]);
+
+		//Keep the phase of the bucket, unless the controller fell more than an interval behind. The commit can register
+		//controllers, the entry is looked up again after it.
+		FScheduledController& scheduled = Controllers[due[i]];
+		float interval = GetDecisionInterval(Inputs[i].Location, viewLocations);
+		scheduled.NextDecisionTime += interval;
+		if (scheduled.NextDecisionTime <= now) scheduled.NextDecisionTime = now + interval;
+	}
+	Committing = false;
+	Controllers.RemoveAll([](const FScheduledController& scheduled) { return !scheduled.Controller; });
+	FAISimulationStats::Get().DecisionSeconds += FPlatformTime::Seconds() - startTime;
+}
+
+bool UAIDecisionScheduler::IsTickable() const
+{
+	return !IsTemplate() && GetWorld() && GetWorld()->HasBegunPlay();
+}
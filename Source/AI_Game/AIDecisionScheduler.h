@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Game_AIController.h"
+#include "AIDecisionScheduler.generated.h"
+
+/**
+ * Runs the state machine of the AI controllers whose decision is due, the others only keep steering.
+ * The inputs are copied on the game thread, the decisions run in parallel on them and are committed back on the game thread
+ * in the order they were due, so the result doesn't depend on the number of worker threads.
+ * Every controller decides DecisionRate times a second, slower the further it is from the players' view points, and the
+ * controllers are spread over DecisionBuckets phases of that interval so they don't all decide on the same frame.
+ * No more than MaxDecisionsPerFrame decide in one frame, the most overdue first, whatever the number of bots.
+ */
+UCLASS(config = Game)
+class AI_GAME_API UAIDecisionScheduler : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterController(AGame_AIController* controller);
+	void UnregisterController(AGame_AIController* controller);
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override { RETURN_QUICK_DECLARE_CYCLE_STAT(UAIDecisionScheduler, STATGROUP_Tickables); }
+
+	//Decisions per second of a controller close to a player
+	UPROPERTY(config, EditAnywhere, Category = "Scheduling")
+		float DecisionRate = 10.0f;
+	UPROPERTY(config, EditAnywhere, Category = "Scheduling")
+		int32 DecisionBuckets = 6;
+	//0 for no limit
+	UPROPERTY(config, EditAnywhere, Category = "Scheduling")
+		int32 MaxDecisionsPerFrame = 32;
+
+	//Closer than this to a view point the controller decides at DecisionRate
+	UPROPERTY(config, EditAnywhere, Category = "Level of detail")
+		float NearDistance = 3000.0f;
+	//Further than this it decides at DecisionRate * FarRateScale, in between the rate is interpolated
+	UPROPERTY(config, EditAnywhere, Category = "Level of detail")
+		float FarDistance = 15000.0f;
+	UPROPERTY(config, EditAnywhere, Category = "Level of detail")
+		float FarRateScale = 0.25f;
+
+protected:
+	struct FScheduledController
+	{
+		AGame_AIController* Controller;
+		double NextDecisionTime;
+	};
+	TArray<FScheduledController> Controllers;
+	//Registrations so far, the bucket of the next controller
+	int32 RegisteredCount = 0;
+	//Unregistered controllers are only cleared while the decisions are committed, and removed after
+	bool Committing = false;
+
+	//Reused between frames, one per due controller
+	TArray<FAIDecisionInput> Inputs;
+	TArray<FAIDecision> Decisions;
+	TArray<FVector> Locations;
+	TArray<int32> CellIndices;
+
+	float GetDecisionInterval(const FVector& location, const TArray<FVector>& viewLocations) const;
+};
@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AISimulationCommandlet.h"
+#include "AISimulationStats.h"
+#include "GridManager.h"
+#include "Game_AIController.h"
+#include "AI_GameCharacter.h"
+#include "BasePickUp.h"
+#include "Engine/Engine.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/App.h"
+
+UAISimulationCommandlet::UAISimulationCommandlet()
+{
+	IsClient = false;
+	IsServer = true;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UAISimulationCommandlet::Main(const FString& Params)
+{
+	int32 botCount = 32;
+	int32 pickUpCount = 8;
+	int32 tickCount = 1000;
+	int32 seed = 0;
+	int32 gridSize = 128;
+	float deltaSeconds = 1.0f / 30.0f;
+	FString layoutName = TEXT("rooms");
+	FString outputFile;
+	FParse::Value(*Params, TEXT("bots="), botCount);
+	FParse::Value(*Params, TEXT("pickups="), pickUpCount);
+	FParse::Value(*Params, TEXT("ticks="), tickCount);
+	FParse::Value(*Params, TEXT("seed="), seed);
+	FParse::Value(*Params, TEXT("gridsize="), gridSize);
+	FParse::Value(*Params, TEXT("deltaseconds="), deltaSeconds);
+	FParse::Value(*Params, TEXT("layout="), layoutName);
+	FParse::Value(*Params, TEXT("output="), outputFile);
+
+	EBenchmarkGridLayout layout = RANDOM_OBSTACLES;
+	if (layoutName == TEXT("maze")) layout = MAZE;
+	else if (layoutName == TEXT("rooms")) layout = ROOMS;
+	else layoutName = TEXT("random");
+	float obstacleDensity = layout == MAZE ? 0.0f : 0.1f;
+
+	if (botCount <= 0 || tickCount <= 0 || gridSize < 8 || deltaSeconds <= 0.0f)
+	{
+		UE_LOG(LogTemp, Error, TEXT("AISimulation: invalid arguments, expected -bots > 0, -ticks > 0, -gridsize >= 8 and -deltaseconds > 0"));
+		return 1;
+	}
+
+	//Every tick advances the same fixed time, whatever the machine
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(deltaSeconds);
+
+	UWorld* world = UWorld::CreateWorld(EWorldType::Game, false, TEXT("AISimulation"));
+	FWorldContext& worldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	worldContext.SetCurrentWorld(world);
+	FURL url;
+	world->SetGameMode(url);
+	world->InitializeActorsForPlay(url);
+
+	FActorSpawnParameters spawnParams;
+	spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AGridManager* gridManager = world->SpawnActor<AGridManager>(FVector::ZeroVector, FRotator::ZeroRotator, spawnParams);
+	gridManager->GenerateBenchmarkCells(gridSize, layout, obstacleDensity, seed);
+	gridManager->SetRandomSeed(seed);
+	gridManager->SetPathRequestMode(SAME_TICK);
+
+	//Controllers read their pawn in BeginPlay, so everything is spawned and possessed before the world begins play
+	TArray<AGame_AIController*> controllers;
+	for (int32 i = 0; i < botCount; i++)
+	{
+		int32 cellIndex = gridManager->GetRandomCellIndex();
+		if (cellIndex == INDEX_NONE) break;
+
+		FVector location = gridManager->GetNavGrid().GetLocation(cellIndex);
+		AAI_GameCharacter* character = world->SpawnActor<AAI_GameCharacter>(location, FRotator(0.0f, 360.0f * i / botCount, 0.0f), spawnParams);
+		//There is no floor to walk on, flying keeps the bots on the height of the generated grid
+		character->GetCharacterMovement()->SetMovementMode(MOVE_Flying);
+
+		AGame_AIController* controller = world->SpawnActor<AGame_AIController>(location, FRotator::ZeroRotator, spawnParams);
+		controller->SetRandomSeed(seed + i + 1);
+		controller->Possess(character);
+		controllers.Add(controller);
+	}
+
+	TArray<ABasePickUp*> pickUps;
+	for (int32 i = 0; i < pickUpCount; i++)
+	{
+		int32 cellIndex = gridManager->GetRandomCellIndex();
+		if (cellIndex == INDEX_NONE) break;
+
+		ABasePickUp* pickUp = world->SpawnActor<ABasePickUp>(gridManager->GetNavGrid().GetLocation(cellIndex), FRotator::ZeroRotator, spawnParams);
+		pickUp->Tags.Add(i % 2 == 0 ? TEXT("AmmoPickUp") : TEXT("HealthPickUp"));
+		pickUps.Add(pickUp);
+	}
+
+	//BeginPlay builds the grid from the empty level, put the generated one back. Same seed, same cells.
+	world->BeginPlay();
+	gridManager->GenerateBenchmarkCells(gridSize, layout, obstacleDensity, seed);
+	for (AGame_AIController* controller : controllers) controller->SetGridManager(gridManager);
+
+	FAISimulationStats& stats = FAISimulationStats::Get();
+	stats.Reset();
+	TArray<double> aiTimes;
+	TArray<double> pathTimes;
+	TArray<double> tickTimes;
+	aiTimes.Reserve(tickCount);
+	pathTimes.Reserve(tickCount);
+	tickTimes.Reserve(tickCount);
+	double startTime = FPlatformTime::Seconds();
+	for (int32 tick = 0; tick < tickCount && controllers.Num() > 0; tick++)
+	{
+		CollectPickUps(controllers, pickUps);
+
+		double decisionSeconds = stats.DecisionSeconds;
+		double pathRequestSeconds = stats.PathRequestSeconds;
+		double tickStartTime = FPlatformTime::Seconds();
+		world->Tick(LEVELTICK_All, deltaSeconds);
+		tickTimes.Add((FPlatformTime::Seconds() - tickStartTime) * 1000.0);
+		//The searches run in the grid manager's Tick in SAME_TICK mode, they are part of what the bots cost
+		pathTimes.Add((stats.PathRequestSeconds - pathRequestSeconds) * 1000.0);
+		aiTimes.Add((stats.DecisionSeconds - decisionSeconds) * 1000.0 + pathTimes.Last());
+
+		RemoveDeadBots(controllers);
+	}
+	double totalSeconds = FPlatformTime::Seconds() - startTime;
+
+	auto percentile = [](TArray<double> values, float fraction)
+	{
+		if (values.Num() == 0) return 0.0;
+		values.Sort();
+		return values[FMath::Min(values.Num() - 1, FMath::FloorToInt(values.Num() * fraction))];
+	};
+	auto mean = [](const TArray<double>& values)
+	{
+		double sum = 0.0;
+		for (double value : values) sum += value;
+		return values.Num() > 0 ? sum / values.Num() : 0.0;
+	};
+
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetNumberField(TEXT("bots"), botCount);
+	report->SetNumberField(TEXT("pickups"), pickUps.Num());
+	report->SetNumberField(TEXT("ticks"), tickTimes.Num());
+	report->SetNumberField(TEXT("seed"), seed);
+	report->SetNumberField(TEXT("grid_size"), gridSize);
+	report->SetStringField(TEXT("layout"), layoutName);
+	report->SetNumberField(TEXT("delta_seconds"), deltaSeconds);
+	report->SetNumberField(TEXT("total_seconds"), totalSeconds);
+	report->SetNumberField(TEXT("ai_ms_mean"), mean(aiTimes));
+	report->SetNumberField(TEXT("ai_ms_p50"), percentile(aiTimes, 0.5f));
+	report->SetNumberField(TEXT("ai_ms_p99"), percentile(aiTimes, 0.99f));
+	report->SetNumberField(TEXT("ai_ms_max"), percentile(aiTimes, 1.0f));
+	report->SetNumberField(TEXT("path_requests_ms_mean"), mean(pathTimes));
+	report->SetNumberField(TEXT("path_requests_ms_p99"), percentile(pathTimes, 0.99f));
+	report->SetNumberField(TEXT("tick_ms_mean"), mean(tickTimes));
+	report->SetNumberField(TEXT("tick_ms_p99"), percentile(tickTimes, 0.99f));
+	report->SetNumberField(TEXT("decisions"), stats.Decisions);
+	report->SetNumberField(TEXT("path_queries"), stats.PathQueries);
+	report->SetNumberField(TEXT("traces"), stats.Traces);
+	const FPathCacheStats& pathCacheStats = gridManager->GetPathCacheStats();
+	report->SetNumberField(TEXT("path_cache_hits"), pathCacheStats.Hits);
+	report->SetNumberField(TEXT("path_cache_suffix_hits"), pathCacheStats.SuffixHits);
+	report->SetNumberField(TEXT("path_cache_misses"), pathCacheStats.Misses);
+	report->SetNumberField(TEXT("path_cache_invalidations"), pathCacheStats.Invalidations);
+	report->SetNumberField(TEXT("path_cache_evictions"), pathCacheStats.Evictions);
+	report->SetNumberField(TEXT("bots_alive"), controllers.Num());
+	report->SetStringField(TEXT("checksum"), FString::Printf(TEXT("%08x"), CalculateChecksum(controllers)));
+
+	const UEnum* stateEnum = StaticEnum<AIState>();
+	TArray<TSharedPtr<FJsonValue>> transitions;
+	for (int32 from = 0; from < AI_SIMULATION_MAX_STATES; from++)
+	{
+		for (int32 to = 0; to < AI_SIMULATION_MAX_STATES; to++)
+		{
+			if (stats.StateTransitions[from][to] == 0) continue;
+
+			TSharedRef<FJsonObject> transition = MakeShared<FJsonObject>();
+			transition->SetStringField(TEXT("from"), stateEnum->GetNameStringByValue(from));
+			transition->SetStringField(TEXT("to"), stateEnum->GetNameStringByValue(to));
+			transition->SetNumberField(TEXT("count"), stats.StateTransitions[from][to]);
+			transitions.Add(MakeShared<FJsonValueObject>(transition));
+		}
+	}
+	report->SetArrayField(TEXT("state_transitions"), transitions);
+
+	UE_LOG(LogTemp, Display, TEXT("AISimulation: %d ticks, %d/%d bots alive, AI %.3f ms mean, %.3f ms p99 (path requests %.3f ms mean), %lld path queries, %lld traces, checksum %s"),
+		tickTimes.Num(), controllers.Num(), botCount, mean(aiTimes), percentile(aiTimes, 0.99f), mean(pathTimes), stats.PathQueries, stats.Traces, *report->GetStringField(TEXT("checksum")));
+
+	GEngine->DestroyWorldContext(world);
+	world->DestroyWorld(false);
+
+	FString json;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+	FJsonSerializer::Serialize(report, writer);
+
+	FString path = outputFile.IsEmpty()
+		? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Simulations"), FString::Printf(TEXT("AISimulation-%s.json"), *FDateTime::Now().ToString()))
+		: outputFile;
+	if (!FFileHelper::SaveStringToFile(json, *path))
+	{
+		UE_LOG(LogTemp, Error, TEXT("AISimulation: could not write %s"), *path);
+		return 1;
+	}
+	UE_LOG(LogTemp, Display, TEXT("AISimulation: report written to %s"), *path);
+	return 0;
+}
+
+void UAISimulationCommandlet::CollectPickUps(const TArray<AGame_AIController*>& controllers, const TArray<ABasePickUp*>& pickUps) const
+{
+	for (ABasePickUp* pickUp : pickUps)
+	{
+		if (!pickUp->IsValidPickUp()) continue;
+
+		for (AGame_AIController* controller : controllers)
+		{
+			AAI_GameCharacter* character = controller->GetCharacter();
+			if (FVector::Dist2D(character->GetActorLocation(), pickUp->GetActorLocation()) > PickUpRadius) continue;
+
+			if (pickUp->ActorHasTag(TEXT("AmmoPickUp"))) character->AddAmmo(character->GetMaxAmmo());
+			else character->AddHP(character->GetMaxHp());
+			pickUp->SetValidPickUp(false);
+			break;
+		}
+	}
+}
+
+void UAISimulationCommandlet::RemoveDeadBots(TArray<AGame_AIController*>& controllers) const
+{
+	for (int32 i = controllers.Num() - 1; i >= 0; i--)
+	{
+		AAI_GameCharacter* character = controllers[i]->GetCharacter();
+		if (IsValid(character)) continue;
+
+		controllers[i]->Destroy();
+		controllers.RemoveAt(i);
+	}
+}
+
+uint32 UAISimulationCommandlet::CalculateChecksum(const TArray<AGame_AIController*>& controllers) const
+{
+	uint32 crc = 0;
+	for (AGame_AIController* controller : controllers)
+	{
+		AAI_GameCharacter* character = controller->GetCharacter();
+		FVector location = character->GetActorLocation();
+		float yaw = character->GetActorRotation().Yaw;
+		int32 values[] = { controller->GetCurrentState(), character->GetCurrentHp(), character->GetCurrentAmmo() };
+		crc = FCrc::MemCrc32(&location, sizeof(location), crc);
+		crc = FCrc::MemCrc32(&yaw, sizeof(yaw), crc);
+		crc = FCrc::MemCrc32(values, sizeof(values), crc);
+	}
+	return crc;
+}
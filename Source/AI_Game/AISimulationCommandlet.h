@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "AISimulationCommandlet.generated.h"
+
+class AGridManager;
+class AGame_AIController;
+class ABasePickUp;
+
+/**
+ * Headless load test of the AI: spawns bots and pick ups on a generated grid and ticks the world a fixed number of times
+ * with a fixed time step and seed, then reports what the AI cost per tick, path searches included. Runs without a level or a renderer:
+ * UE4Editor-Cmd AI_Game -run=AISimulation -bots=64 -pickups=16 -ticks=3000 -seed=0 -gridsize=128 -layout=rooms -nullrhi
+ * Optional -deltaseconds= and -output= (defaults to Saved/Simulations). Two runs with the same arguments end with the same checksum.
+ */
+UCLASS()
+class AI_GAME_API UAISimulationCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UAISimulationCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	//The level Blueprints pick up with overlap events, the simulation does it by distance in spawn order
+	void CollectPickUps(const TArray<AGame_AIController*>& controllers, const TArray<ABasePickUp*>& pickUps) const;
+	//Drops the controllers whose character died
+	void RemoveDeadBots(TArray<AGame_AIController*>& controllers) const;
+	//CRC of the state of every bot, equal between two runs only if they played out the same
+	uint32 CalculateChecksum(const TArray<AGame_AIController*>& controllers) const;
+
+	float PickUpRadius = 100.0f;
+};
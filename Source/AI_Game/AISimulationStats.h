@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#define AI_SIMULATION_MAX_STATES 8
+
+/**
+ * Counters of the work the AI does, summed over every controller and character.
+ * Only read by the headless simulation (UAISimulationCommandlet), which resets them before a run. Game thread only.
+ */
+struct FAISimulationStats
+{
+	//Path searches asked of the grid manager: requests, replans, refinements and flow field steps
+	int64 PathQueries = 0;
+	//Scene traces made while deciding and firing
+	int64 Traces = 0;
+	//Controller ticks that ran the state machine, the others only steered
+	int64 Decisions = 0;
+	//Changes of AIState, indexed [from][to]
+	int64 StateTransitions[AI_SIMULATION_MAX_STATES][AI_SIMULATION_MAX_STATES] = {};
+	//Time spent in the controllers' Tick and in the awareness update
+	double DecisionSeconds = 0.0;
+	//Time the grid manager's Tick spent streaming chunks and processing path requests on the game thread
+	double PathRequestSeconds = 0.0;
+
+	void Reset() { *this = FAISimulationStats(); }
+
+	static FAISimulationStats& Get()
+	{
+		static FAISimulationStats stats;
+		return stats;
+	}
+};
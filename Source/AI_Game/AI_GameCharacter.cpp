@@ -5,10 +5,13 @@
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
+#include "Components/SphereComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "DrawDebugHelpers.h"
+#include "AISimulationStats.h"
+#include "AIAwarenessSubsystem.h"
 
 #define COLLISION_WEAPON ECC_GameTraceChannel1
 
@@ -125,6 +128,26 @@ void AAI_GameCharacter::AddHP(int hp)
 	if (CurrentHP > MaxHP) CurrentHP = MaxHP;
 }
 
+void AAI_GameCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+	if (UAIAwarenessSubsystem* awareness = GetWorld()->GetSubsystem<UAIAwarenessSubsystem>()) awareness->RegisterCharacter(this);
+
+	//The Blueprint's enemy checker sphere fed the nearby enemies before UAIAwarenessSubsystem, its overlaps are no longer used
+	TArray<USphereComponent*> spheres;
+	GetComponents<USphereComponent>(spheres);
+	for (USphereComponent* sphere : spheres)
+	{
+		if (sphere->GetFName() == TEXT("AI_Enemy_Checker")) sphere->SetGenerateOverlapEvents(false);
+	}
+}
+
+void AAI_GameCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UAIAwarenessSubsystem* awareness = GetWorld()->GetSubsystem<UAIAwarenessSubsystem>()) awareness->UnregisterCharacter(this);
+	Super::EndPlay(EndPlayReason);
+}
+
 void AAI_GameCharacter::DealDamage(int damage)
 {
 	CurrentHP -= damage;
@@ -158,6 +181,7 @@ bool AAI_GameCharacter::Fire()
 		false, 0.3f, 10,
 		12.333 
 	);
+	FAISimulationStats::Get().Traces++;
 	if (GetWorld()->LineTraceSingleByChannel(outHitResult, GetActorLocation() + GetActorForwardVector() * FireRange + FVector(0.0f, 0.0f, 16.0f), (GetActorForwardVector() * WeaponRange) + GetActorLocation() + GetActorForwardVector() * FireRange + FVector(0.0f, 0.0f, 16.0f), COLLISION_WEAPON, params))
 	{
 		if (Cast<AAI_GameCharacter>(outHitResult.Actor)) Cast<AAI_GameCharacter>(outHitResult.Actor)->DealDamage(WeaponDamage);
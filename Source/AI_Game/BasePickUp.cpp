@@ -2,6 +2,7 @@
 
 
 #include "BasePickUp.h"
+#include "PickUpSubsystem.h"
 
 // Sets default values
 ABasePickUp::ABasePickUp()
@@ -24,7 +25,21 @@ ABasePickUp::ABasePickUp()
 void ABasePickUp::BeginPlay()
 {
 	Super::BeginPlay();
-	
+	if (UPickUpSubsystem* pickUps = GetWorld()->GetSubsystem<UPickUpSubsystem>()) pickUps->RegisterPickUp(this);
+}
+
+void ABasePickUp::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UPickUpSubsystem* pickUps = GetWorld()->GetSubsystem<UPickUpSubsystem>()) pickUps->UnregisterPickUp(this);
+	Super::EndPlay(EndPlayReason);
+}
+
+void ABasePickUp::SetValidPickUp(bool valid)
+{
+	if (valid == ValidPickUp) return;
+
+	ValidPickUp = valid;
+	if (UPickUpSubsystem* pickUps = GetWorld()->GetSubsystem<UPickUpSubsystem>()) pickUps->OnValidPickUpChanged(this);
 }
 
 bool ABasePickUp::OnPickedUp(AAI_GameCharacter* character)
@@ -32,7 +47,7 @@ bool ABasePickUp::OnPickedUp(AAI_GameCharacter* character)
 	if (ValidPickUp)
 	{
 		if (Mesh) Mesh->SetVisibility(false);
-		ValidPickUp = false;
+		SetValidPickUp(false);
 	}
 	return !ValidPickUp;
 }
@@ -46,7 +61,7 @@ void ABasePickUp::Tick(float DeltaTime)
 	{
 		if (SecondsSleeping >= SleepTime)
 		{
-			ValidPickUp = true;
+			SetValidPickUp(true);
 			SecondsSleeping = 0.0f;
 			if (Mesh) Mesh->SetVisibility(true);
 		}
@@ -33,6 +33,9 @@ protected:
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	bool ValidPickUp = true;
 
 	UFUNCTION(BlueprintCallable)
 	virtual bool OnPickedUp(AAI_GameCharacter* character);
@@ -40,6 +43,9 @@ protected:
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
-	bool ValidPickUp = true;
+
+	inline bool IsValidPickUp() const { return ValidPickUp; }
+	//Tells UPickUpSubsystem, so the bots stop or start looking for this pick up
+	void SetValidPickUp(bool valid);
 
 };
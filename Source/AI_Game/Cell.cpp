@@ -1,5 +1,6 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 #include "Cell.h"
+#include "NavGrid.h"
 
 UCell::UCell()
 {
@@ -32,57 +33,5 @@ UCell::UCell(int32 x, int32 y, int32 z, int32 index, FVector location, float mov
 
 void UCell::SetColorByState()
 {
-	switch (State)
-	{
-	case FREE: Color = FColor::Green;
-		break;
-	case OCCUPIED: Color = FColor::Yellow;
-		break;
-	case BLOCKED: Color = FColor::Red;
-		break;
-	case DEAD: Color = FColor::Black;
-		break;
-	default: Color = FColor::White;
-	}
+	Color = FNavGrid::GetStateColor(State);
 }
-
-void UCell::SetCellParameters(TEnumAsByte<ECellState> state, float moveCost, int32 modifierPriority)
-{
-	if (modifierPriority >= ModifierPriority)
-	{
-		ModifierPriority = modifierPriority;
-		MoveCost = moveCost;
-		State = state;
-		SetColorByState();
-	}
-}
-
-void UCell::SetPathfindingData(float gCost, float hCost, int32 parentIndex)
-{
-	GCost = gCost;
-	HCost = hCost;
-	ParentIndex = parentIndex;
-}
-
-void UCell::SetPathfindingData(const UCell& cell)
-{
-	GCost = cell.GCost;
-	HCost = cell.HCost;
-	ParentIndex = cell.ParentIndex;
-}
-
-TSet<UCell*> UCell::GetNeighbors(const bool& diagonal, const bool& vertical) const
-{
-	TSet<UCell*> neighbors;
-	neighbors.Append(Neighbors);
-	if (diagonal)
-	{
-		neighbors.Append(DiagonalNeighbors);
-		if (vertical)
-		{
-			neighbors.Append(Diagonal3DNeighbors);
-		}
-	}
-
-	return neighbors;
-}
\ No newline at end of file
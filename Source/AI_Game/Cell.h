@@ -16,6 +16,8 @@ enum ECellState
 	DEAD		UMETA(DisplayName = "Dead")
 };
 
+//Blueprint view of one grid cell. The grid data itself lives in FNavGrid, AGridManager creates these on demand and refreshes them from it.
+//The view is read only, cells are changed with AGridManager::SetCell and SetCellColor.
 UCLASS(ClassGroup = (Custom), Blueprintable)
 class AI_GAME_API UCell : public UObject
 {
@@ -31,38 +33,21 @@ public:
 
 	UPROPERTY(BlueprintReadOnly, Category = "Movement")
 		float MoveCost;
-	UPROPERTY(BlueprintReadWrite, Category = "Movement")
+	UPROPERTY(BlueprintReadOnly, Category = "Movement")
 		TEnumAsByte<ECellState> State;
 
 	UPROPERTY(BlueprintReadOnly, Category = "Pathfinding")
-		float GCost = 0.0f;
-	UPROPERTY(BlueprintReadOnly, Category = "Pathfinding")
-		float HCost = 0.0f;
-	UPROPERTY(BlueprintReadOnly, Category = "Pathfinding")
-		int32 ParentIndex;
-	UPROPERTY(BlueprintReadWrite, Category = "Pathfinding")
 		FColor Color;
 
-	UPROPERTY(BlueprintReadWrite)
+	UPROPERTY(BlueprintReadOnly)
 		int32 ModifierPriority = -999;
 
-	TSet<UCell*> Neighbors;
-	TSet<UCell*> DiagonalNeighbors;
-	TSet<UCell*> Diagonal3DNeighbors;
-
 	//Constructors
 	UCell();
 	UCell(UCell* cell);
 	UCell(int32 x, int32 y, int32 z, int32 index, FVector location = FVector(0.0f, 0.0f, 0.0f), float moveCost = 0, TEnumAsByte<ECellState> state = ECellState::FREE);
 
 	void SetColorByState();
-	void SetCellParameters(TEnumAsByte<ECellState> state, float moveCost, int32 modifierPriority);
-	void SetPathfindingData(float gCost, float hCost, int32 parentIndex);
-	void SetPathfindingData(const UCell& cell);
-
-	inline float FCost() const { return GCost + HCost; }
-
-	TSet<UCell*> GetNeighbors(const bool& diagonal = false, const bool& vertical = false) const;
 
 	inline bool operator== (const UCell& cell) const { return Index == cell.Index; }
 	inline bool operator!= (const UCell& cell) const { return Index != cell.Index; }
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CellHeap.h"
+
+void FCellHeap::Reset(int32 cellCount)
+{
+	if (Positions.Num() < cellCount)
+	{
+		Positions.Init(INDEX_NONE, cellCount);
+	}
+	else
+	{
+		//Popped cells already cleared their position, only the ones left in the heap need it
+		for (const auto& node : Nodes) Positions[node.CellIndex] = INDEX_NONE;
+	}
+	Nodes.Reset();
+}
+
+void FCellHeap::Push(int32 cellIndex, float fCost, float hCost)
+{
+	FCellHeapNode node;
+	node.CellIndex = cellIndex;
+	node.FCost = fCost;
+	node.HCost = hCost;
+
+	int32 position = Nodes.Add(node);
+	Positions[cellIndex] = position;
+	SiftUp(position);
+}
+
+void FCellHeap::Update(int32 cellIndex, float fCost, float hCost)
+{
+	int32 position = Positions[cellIndex];
+	Nodes[position].FCost = fCost;
+	Nodes[position].HCost = hCost;
+	SiftUp(position);
+}
+
+int32 FCellHeap::Pop()
+{
+	int32 cellIndex = Nodes[0].CellIndex;
+	int32 last = Nodes.Num() - 1;
+	if (last > 0) Swap(0, last);
+
+	Nodes.RemoveAt(last, 1, false);
+	Positions[cellIndex] = INDEX_NONE;
+	if (Nodes.Num() > 1) SiftDown(0);
+
+	return cellIndex;
+}
+
+void FCellHeap::Remove(int32 cellIndex)
+{
+	if (!Contains(cellIndex)) return;
+
+	int32 position = Positions[cellIndex];
+	int32 last = Nodes.Num() - 1;
+	if (position != last) Swap(position, last);
+
+	Nodes.RemoveAt(last, 1, false);
+	Positions[cellIndex] = INDEX_NONE;
+	if (position < Nodes.Num())
+	{
+		//The node moved into the hole can belong either above or below it
+		SiftUp(position);
+		SiftDown(position);
+	}
+}
+
+void FCellHeap::SiftUp(int32 position)
+{
+	while (position > 0)
+	{
+		int32 parent = (position - 1) / 2;
+		if (!(Nodes[position] < Nodes[parent])) break;
+		Swap(position, parent);
+		position = parent;
+	}
+}
+
+void FCellHeap::SiftDown(int32 position)
+{
+	int32 count = Nodes.Num();
+	while (true)
+	{
+		int32 left = 2 * position + 1;
+		if (left >= count) break;
+
+		int32 smallest = left;
+		int32 right = left + 1;
+		if (right < count && Nodes[right] < Nodes[left]) smallest = right;
+		if (!(Nodes[smallest] < Nodes[position])) break;
+
+		Swap(position, smallest);
+		position = smallest;
+	}
+}
+
+void FCellHeap::Swap(int32 positionA, int32 positionB)
+{
+	Nodes.Swap(positionA, positionB);
+	Positions[Nodes[positionA].CellIndex] = positionA;
+	Positions[Nodes[positionB].CellIndex] = positionB;
+}
+
+void FCellLinearOpenList::Reset(int32 cellCount)
+{
+	if (Positions.Num() < cellCount)
+	{
+		Positions.Init(INDEX_NONE, cellCount);
+	}
+	else
+	{
+		for (const auto& node : Nodes) Positions[node.CellIndex] = INDEX_NONE;
+	}
+	Nodes.Reset();
+}
+
+void FCellLinearOpenList::Push(int32 cellIndex, float fCost, float hCost)
+{
+	FCellHeapNode node;
+	node.CellIndex = cellIndex;
+	node.FCost = fCost;
+	node.HCost = hCost;
+	Positions[cellIndex] = Nodes.Add(node);
+}
+
+void FCellLinearOpenList::Update(int32 cellIndex, float fCost, float hCost)
+{
+	FCellHeapNode& node = Nodes[Positions[cellIndex]];
+	node.FCost = fCost;
+	node.HCost = hCost;
+}
+
+int32 FCellLinearOpenList::Pop()
+{
+	int32 best = 0;
+	for (int32 i = 1; i < Nodes.Num(); i++)
+	{
+		if (Nodes[i] < Nodes[best]) best = i;
+	}
+
+	int32 cellIndex = Nodes[best].CellIndex;
+	Positions[cellIndex] = INDEX_NONE;
+	Nodes.RemoveAtSwap(best, 1, false);
+	if (best < Nodes.Num()) Positions[Nodes[best].CellIndex] = best;
+
+	return cellIndex;
+}
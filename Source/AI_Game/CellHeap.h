@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FCellHeapNode
+{
+	int32 CellIndex = INDEX_NONE;
+	float FCost = 0.0f;
+	float HCost = 0.0f;
+
+	//Lowest FCost first, ties are broken by the lowest HCost (the cell closer to the target)
+	inline bool operator< (const FCellHeapNode& other) const
+	{
+		return FCost < other.FCost || (FCost == other.FCost && HCost < other.HCost);
+	}
+};
+
+/**
+ * Indexed binary min-heap used as the A* open list.
+ * Every cell index keeps its position inside the heap, so Contains is O(1) and Update (decrease-key) is O(log n).
+ */
+class AI_GAME_API FCellHeap
+{
+public:
+	//Prepares the heap for a new search on a grid with cellCount cells
+	void Reset(int32 cellCount);
+
+	inline bool IsEmpty() const { return Nodes.Num() == 0; }
+	inline int32 Num() const { return Nodes.Num(); }
+	inline bool Contains(int32 cellIndex) const { return Positions.IsValidIndex(cellIndex) && Positions[cellIndex] != INDEX_NONE; }
+
+	void Push(int32 cellIndex, float fCost, float hCost);
+	//Lowers the key of a cell that is already in the heap
+	void Update(int32 cellIndex, float fCost, float hCost);
+	//Removes and returns the cell index with the lowest key
+	int32 Pop();
+	//Node with the lowest key, the heap must not be empty
+	inline const FCellHeapNode& Top() const { return Nodes[0]; }
+	//Removes a cell from anywhere in the heap, does nothing if it isn't there
+	void Remove(int32 cellIndex);
+
+	inline SIZE_T GetAllocatedSize() const { return Nodes.GetAllocatedSize() + Positions.GetAllocatedSize(); }
+
+private:
+	void SiftUp(int32 position);
+	void SiftDown(int32 position);
+	void Swap(int32 positionA, int32 positionB);
+
+	TArray<FCellHeapNode> Nodes;
+	TArray<int32> Positions;
+};
+
+/**
+ * Reference open list that scans every open cell to find the best one, the way FindPathByCell used to.
+ * Only kept so BenchmarkPathfinding has a baseline to compare FCellHeap against.
+ */
+class AI_GAME_API FCellLinearOpenList
+{
+public:
+	void Reset(int32 cellCount);
+
+	inline bool IsEmpty() const { return Nodes.Num() == 0; }
+	inline int32 Num() const { return Nodes.Num(); }
+	inline bool Contains(int32 cellIndex) const { return Positions.IsValidIndex(cellIndex) && Positions[cellIndex] != INDEX_NONE; }
+
+	void Push(int32 cellIndex, float fCost, float hCost);
+	void Update(int32 cellIndex, float fCost, float hCost);
+	int32 Pop();
+
+private:
+	TArray<FCellHeapNode> Nodes;
+	TArray<int32> Positions;
+};
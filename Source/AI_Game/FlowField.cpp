@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FlowField.h"
+#include "CellHeap.h"
+
+void FFlowField::Build(const FNavGrid& grid, int32 goalIndex)
+{
+	Build(grid, TArrayView<const int32>(&goalIndex, 1));
+}
+
+void FFlowField::Build(const FNavGrid& grid, TArrayView<const int32> goalIndices)
+{
+	Goals.Reset();
+	for (int32 goalIndex : goalIndices)
+	{
+		if (grid.IsValidIndex(goalIndex)) Goals.AddUnique(goalIndex);
+	}
+	Goals.Sort();
+	Costs.Init(MAX_flt, grid.Num());
+	Lengths.Init(MAX_flt, grid.Num());
+	NextCells.Init(INDEX_NONE, grid.Num());
+
+	FCellHeap openCells;
+	openCells.Reset(grid.Num());
+	for (int32 goalIndex : Goals)
+	{
+		if (grid.GetState(goalIndex) == ECellState::BLOCKED) continue;
+
+		Costs[goalIndex] = 0.0f;
+		Lengths[goalIndex] = 0.0f;
+		openCells.Push(goalIndex, 0.0f, 0.0f);
+	}
+
+	while (!openCells.IsEmpty())
+	{
+		int32 currentIndex = openCells.Pop();
+		float currentCost = Costs[currentIndex];
+
+		for (FCellNeighbors::FIterator it = grid.GetNeighbors(currentIndex).CreateIterator(); it; ++it)
+		{
+			int32 index = it.GetIndex();
+			//Stepping from the neighbor into the current cell pays for the current cell
+			float newCost = currentCost + it.GetDistance() + grid.GetMoveCost(currentIndex);
+			if (newCost >= Costs[index]) continue;
+
+			bool isOpen = openCells.Contains(index);
+			Costs[index] = newCost;
+			Lengths[index] = Lengths[currentIndex] + FVector::Dist(grid.GetLocation(index), grid.GetLocation(currentIndex));
+			NextCells[index] = currentIndex;
+
+			//A blocked cell can still leave towards the goal, the same way A* accepts a blocked start, but nothing walks through it
+			if (grid.GetState(index) == ECellState::BLOCKED) continue;
+
+			if (isOpen) openCells.Update(index, newCost, 0.0f);
+			else openCells.Push(index, newCost, 0.0f);
+		}
+	}
+}
+
+int32 FFlowField::FindGoal(int32 index) const
+{
+	if (!IsReachable(index)) return INDEX_NONE;
+
+	while (NextCells[index] != INDEX_NONE) index = NextCells[index];
+	return index;
+}
+
+FVector FFlowField::GetDirection(const FNavGrid& grid, int32 index) const
+{
+	if (!NextCells.IsValidIndex(index) || NextCells[index] == INDEX_NONE) return FVector::ZeroVector;
+
+	FVector direction = grid.GetLocation(NextCells[index]) - grid.GetLocation(index);
+	direction.Z = 0.0f;
+	return direction.GetSafeNormal();
+}
+
+bool FFlowField::IsAffectedBy(const FNavGrid& grid, int32 cellIndex) const
+{
+	if (!grid.IsValidIndex(cellIndex) || !Costs.IsValidIndex(cellIndex) || Goals.Contains(cellIndex)) return true;
+
+	//The state, cost and links of a cell only enter the costs of the cell itself and of its neighbors.
+	//If those still are what Build would compute from the grid as it is now, every other cell is too.
+	if (!IsConsistent(grid, cellIndex)) return true;
+	for (int32 index : grid.GetNeighbors(cellIndex))
+	{
+		if (!IsConsistent(grid, index)) return true;
+	}
+	return false;
+}
+
+bool FFlowField::IsConsistent(const FNavGrid& grid, int32 index) const
+{
+	//Only the goals the sweep started from cost nothing, every step costs at least its distance
+	if (Costs[index] == 0.0f) return true;
+
+	float bestCost = MAX_flt;
+	bool nextIsOnGradient = NextCells[index] == INDEX_NONE;
+	for (FCellNeighbors::FIterator it = grid.GetNeighbors(index).CreateIterator(); it; ++it)
+	{
+		int32 neighborIndex = it.GetIndex();
+		if (Costs[neighborIndex] == MAX_flt || (Costs[neighborIndex] != 0.0f && grid.GetState(neighborIndex) == ECellState::BLOCKED)) continue;
+
+		float cost = Costs[neighborIndex] + it.GetDistance() + grid.GetMoveCost(neighborIndex);
+		bestCost = FMath::Min(bestCost, cost);
+		if (neighborIndex == NextCells[index]) nextIsOnGradient = FMath::IsNearlyEqual(cost, Costs[index], Costs[index] * KINDA_SMALL_NUMBER);
+	}
+
+	if (bestCost == MAX_flt) return Costs[index] == MAX_flt && NextCells[index] == INDEX_NONE;
+	return nextIsOnGradient && NextCells[index] != INDEX_NONE && FMath::IsNearlyEqual(bestCost, Costs[index], Costs[index] * KINDA_SMALL_NUMBER);
+}
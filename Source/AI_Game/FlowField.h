@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavGrid.h"
+
+/**
+ * Integration and flow field towards one goal cell, or towards the nearest of several.
+ * Build runs a single Dijkstra sweep out from the goals, after that any cell can look up its cost to the nearest goal and the
+ * next cell to step into in O(1), so every agent heading to the same goal shares one search.
+ * Costs are the ones FGridPathfinder uses, following NextCells from a cell walks one of its A* optimal paths.
+ */
+class AI_GAME_API FFlowField
+{
+public:
+	void Build(const FNavGrid& grid, int32 goalIndex);
+	//Nothing leads to a blocked goal, the field is rebuilt once the goal is no longer blocked
+	void Build(const FNavGrid& grid, TArrayView<const int32> goalIndices);
+
+	//Sorted, without duplicates
+	FORCEINLINE const TArray<int32>& GetGoals() const { return Goals; }
+	//Goal the next cells lead the cell to, INDEX_NONE if it can't reach one
+	int32 FindGoal(int32 index) const;
+	FORCEINLINE bool IsReachable(int32 index) const { return Costs.IsValidIndex(index) && Costs[index] < MAX_flt; }
+	//Cost of walking from the cell to the goal, MAX_flt if it can't reach it
+	FORCEINLINE float GetCost(int32 index) const { return Costs[index]; }
+	//World distance walked from the cell to the goal along the next cells, MAX_flt if it can't reach it
+	FORCEINLINE float GetLength(int32 index) const { return Lengths[index]; }
+	//Next cell towards the goal, INDEX_NONE for the goal itself and for cells that can't reach it
+	FORCEINLINE int32 GetNextCell(int32 index) const { return NextCells[index]; }
+	//Normalized direction from the cell to its next cell, zero if there is none
+	FVector GetDirection(const FNavGrid& grid, int32 index) const;
+
+	//False if the field is still the one Build would make after the cell changed: the cell and its neighbors still get the
+	//same costs through the same next cells. A change off the cost gradient that can't lower any cost keeps the field.
+	bool IsAffectedBy(const FNavGrid& grid, int32 cellIndex) const;
+
+	SIZE_T GetAllocatedSize() const { return Goals.GetAllocatedSize() + Costs.GetAllocatedSize() + Lengths.GetAllocatedSize() + NextCells.GetAllocatedSize(); }
+
+	//Frame the field was last asked for, the least recently used fields are dropped first
+	uint64 LastUsedFrame = 0;
+
+private:
+	//The cell's cost and next cell are the best step into one of its neighbors on the grid as it is now
+	bool IsConsistent(const FNavGrid& grid, int32 index) const;
+
+	TArray<int32> Goals;
+	TArray<float> Costs;
+	//Costs add the move costs of the cells, these only the distances between them
+	TArray<float> Lengths;
+	TArray<int32> NextCells;
+};
@@ -6,16 +6,26 @@
 #include "Cell.h"
 #include "Components/CapsuleComponent.h"
 #include "Kismet/GameplayStatics.h"
+#include "AISimulationStats.h"
+#include "AIAwarenessSubsystem.h"
+#include "PickUpSubsystem.h"
+#include "AIDecisionScheduler.h"
 
 #define VERY_BIG 999999999.9f
 #define SMALL 100.0f
 
-float AGame_AIController::LookAt(FVector target)
+float AGame_AIController::GetAngleTo(const FVector& location, const FVector& forward, const FVector& target)
 {
-	FVector2D currentDirection(Character->GetActorForwardVector());
-	FVector2D targetDirection((target - Character->GetActorLocation()).GetSafeNormal());
+	FVector2D currentDirection(forward);
+	FVector2D targetDirection((target - location).GetSafeNormal());
 	float angle = UKismetMathLibrary::Acos(FVector2D::DotProduct(currentDirection, targetDirection));
 	if (FVector2D::CrossProduct(currentDirection, targetDirection) < 0) angle = -angle;
+	return angle;
+}
+
+float AGame_AIController::LookAt(FVector target)
+{
+	float angle = GetAngleTo(Character->GetActorLocation(), Character->GetActorForwardVector(), target);
 
 	float distance = FVector2D::Distance(FVector2D(Character->GetActorLocation()), FVector2D(target));
 	//Try to look at the target
@@ -36,28 +46,85 @@ float AGame_AIController::LookAt(FVector target)
 
 bool AGame_AIController::FindPath(FVector destination)
 {
-	for (auto& cell : Path.CellsInPath)
+	return FindPathFromCell(INDEX_NONE, destination);
+}
+
+bool AGame_AIController::FindPathFromCell(int32 startIndex, FVector destination)
+{
+	for (int32 i = Path.Cursor; i < Path.Cells.Num(); i++)
+	{
+		GridManager->SetCellColor(Path.Cells[i], FColor::Blue);
+	}
+
+	if (startIndex == INDEX_NONE) startIndex = GridManager->GetClosestWalkableCellIndex(Character->GetActorLocation());
+	PathRequestHandle = GridManager->RequestPathByIndex(this, startIndex, GridManager->GetClosestWalkableCellIndex(destination), FOnPathRequestComplete::CreateUObject(this, &AGame_AIController::OnPathRequestComplete));
+	FAISimulationStats::Get().PathQueries++;
+	return PathRequestHandle != INDEX_NONE;
+}
+
+bool AGame_AIController::ReplanPath(FVector destination)
+{
+	if (IsWaitingForPath())
 	{
-		GridManager->SetCellColor(cell->Index, FColor::Blue);
+		GridManager->CancelPathRequest(PathRequestHandle);
+		PathRequestHandle = INDEX_NONE;
 	}
 
-	return GridManager->FindPathByLocation(Path, Character->GetActorLocation(), destination);
+	FAISimulationStats::Get().PathQueries++;
+	return GridManager->ReplanPath(this, Character->GetActorLocation(), destination, Path);
+}
+
+void AGame_AIController::OnPathRequestComplete(int32 requestHandle, bool pathFound, const FPath& path)
+{
+	if (requestHandle != PathRequestHandle) return;
+
+	PathRequestHandle = INDEX_NONE;
+	Path.Assign(path);
+}
+
+void AGame_AIController::OnGridRegionDirty(const FGridDirtyRegion& region)
+{
+	if (!Character || Path.IsDone() || IsWaitingForPath()) return;
+
+	const FNavGrid& grid = GridManager->GetNavGrid();
+	int32 fromIndex = GridManager->GetClosestCellIndexFromLocation(Character->GetActorLocation());
+	if (fromIndex == INDEX_NONE) return;
+
+	//Smoothed paths cut across cells that are not on them, so every stretch between two of their cells is checked
+	FIntVector from = grid.GetCoordinates(fromIndex);
+	for (int32 i = Path.Cursor; i < Path.Cells.Num(); i++)
+	{
+		FIntVector to = grid.GetCoordinates(Path.Cells[i]);
+		if (region.Intersects(from, to))
+		{
+			int32 targetIndex = Path.Waypoints.Num() > 0 ? Path.Waypoints.Last() : Path.Cells.Last();
+			FindPath(grid.GetLocation(targetIndex));
+			return;
+		}
+		from = to;
+	}
 }
 
 void AGame_AIController::FollowPathToTarget()
 {
-	if(Path.CellsInPath.Num() == 0) return;
+	if (Path.Waypoints.Num() > 0 && Path.Num() < PathRefineCellsAhead)
+	{
+		GridManager->RefinePath(Path);
+		FAISimulationStats::Get().PathQueries++;
+	}
+	if (Path.IsDone()) return;
 
-	float distance = FVector2D::Distance(FVector2D(Path.CellsInPath[0]->Location), FVector2D(Character->GetActorLocation()));
+	const FNavGrid& grid = GridManager->GetNavGrid();
+	float distance = FVector2D::Distance(FVector2D(grid.GetLocation(Path.GetNextCell())), FVector2D(Character->GetActorLocation()));
 	while (distance < CellReachDistance)
 	{
-		GridManager->SetCellColor(Path.CellsInPath[0]->Index, FColor::Green);
-		Path.CellsInPath.RemoveAt(0);
-		if (Path.CellsInPath.Num() == 0) return;
-		distance = FVector2D::Distance(FVector2D(Path.CellsInPath[0]->Location), FVector2D(Character->GetActorLocation()));
+		GridManager->SetCellColor(Path.GetNextCell(), FColor::Green);
+		Path.Advance();
+		if (Path.IsDone()) return;
+		distance = FVector2D::Distance(FVector2D(grid.GetLocation(Path.GetNextCell())), FVector2D(Character->GetActorLocation()));
 	}
 
-	float angle = LookAt(Path.CellsInPath[0]->Location);
+	float angle = LookAt(grid.GetLocation(Path.GetNextCell()));
 	if ( abs(angle) < PathfindMaxMoveAngle)
 	{
 		//float input = (1 - (abs(angle) / MaxMoveAngle));// *(0.5 + 0.5 * (1 - distance / CellReachDistance));
@@ -66,32 +133,168 @@ void AGame_AIController::FollowPathToTarget()
 	}
 }
 
-void AGame_AIController::Act()
+bool AGame_AIController::FollowFlowField(FVector destination)
+{
+	FVector nextLocation;
+	int32 goalIndex = GridManager->GetClosestWalkableCellIndex(destination);
+	if (goalIndex != FlowFieldGoalIndex)
+	{
+		FlowFieldGoalIndex = goalIndex;
+		FAISimulationStats::Get().PathQueries++;
+	}
+	if (!GridManager->GetFlowFieldStep(Character->GetActorLocation(), destination, nextLocation)) return false;
+
+	float angle = LookAt(nextLocation);
+	if (abs(angle) < PathfindMaxMoveAngle) Character->MoveForward(1.0f);
+	return true;
+}
+
+TEnumAsByte<AIState> AGame_AIController::RunDecision(TEnumAsByte<AIState> state)
+{
+	FAIDecisionInput input = GatherDecisionInput();
+	input.State = state;
+	CommitDecision(Decide(input));
+	return CurrentState;
+}
+
+FAIDecisionInput AGame_AIController::GatherDecisionInput() const
+{
+	FAIDecisionInput input;
+	input.State = CurrentState;
+	input.Location = Character->GetActorLocation();
+	input.Forward = Character->GetActorForwardVector();
+	input.Hp = Character->GetCurrentHp();
+	input.MaxHp = Character->GetMaxHp();
+	input.Ammo = Character->GetCurrentAmmo();
+	input.LowHealth = Character->LowHealth;
+	input.WeaponRange = Character->GetWeaponRange();
+	input.WeaponHitboxRadius = Character->GetWeaponHitbox()->GetScaledCapsuleRadius();
+	input.Enemies.Reserve(NearbyEnemies.Num());
+	for (AAI_GameCharacter* enemy : NearbyEnemies) input.Enemies.Add({ enemy, enemy->GetActorLocation(), enemy->LowHealth });
+	input.TargetEnemy = TargetEnemy;
+	input.HasValidPickUp = TargetPickUp && TargetPickUp->IsValidPickUp();
+	input.PickUpLocation = input.HasValidPickUp ? TargetPickUp->GetActorLocation() : FVector::ZeroVector;
+	input.HasPath = !Path.IsDone() || IsWaitingForPath();
+	input.DeltaSeconds = SecondsSinceDecision;
+	return input;
+}
+
+FAIDecision AGame_AIController::Decide(const FAIDecisionInput& input)
+{
+	FAIDecision decision;
+	decision.State = input.State;
+	decision.TargetEnemy = input.TargetEnemy;
+	decision.TargetLocation = TargetLocation;
+	decision.SecondsWandering = SecondsWandering;
+	decision.SecondsFled = SecondsFled;
+	decision.StartCellIndex = input.CellIndex;
+
+	switch (input.State)
+	{
+	case CHASING:
+		DecideChase(input, decision);
+		break;
+	case FLEEING:
+		DecideFlee(input, decision);
+		break;
+	case WANDERING:
+		DecideWander(input, decision);
+		break;
+	case ENGAGE_VIOLENCE:
+		DecideFire(input, decision);
+		break;
+	case SEEKING:
+		DecideSeek(input, decision);
+		break;
+	}
+	return decision;
+}
+
+void AGame_AIController::CommitDecision(const FAIDecision& decision)
+{
+	TEnumAsByte<AIState> previousState = CurrentState;
+	CurrentState = decision.State;
+	//The enemy can have been killed by a decision committed before this one
+	TargetEnemy = IsValid(decision.TargetEnemy) ? decision.TargetEnemy : nullptr;
+	TargetLocation = decision.TargetLocation;
+	SecondsFled = decision.SecondsFled;
+	SecondsSinceDecision = 0.0f;
+
+	if (!decision.PickUpTag.IsNone())
+	{
+		TargetPickUp = FindClosestPickUp(decision.PickUpTag);
+		if (TargetPickUp) CurrentState = SEEKING;
+	}
+
+	if (CurrentState == WANDERING)
+	{
+		SecondsWandering = decision.SecondsWandering;
+		if (decision.NewWanderPath)
+		{
+			FindPathFromCell(decision.StartCellIndex, TargetLocation);
+			//Without a free cell loaded the old target is kept and the next decision tries again
+			int32 cellIndex = GridManager->GetRandomCellIndex();
+			if (cellIndex != INDEX_NONE) TargetLocation = GridManager->GetNavGrid().GetLocation(cellIndex);
+		}
+	}
+
+	if (decision.ChaseEnemy && TargetEnemy)
+	{
+		FHitResult outHitResult;
+		FCollisionObjectQueryParams objectQuerry;
+		FCollisionQueryParams collisionParams;
+		FAISimulationStats::Get().Traces++;
+		if (GetWorld()->LineTraceSingleByObjectType(outHitResult, Character->GetActorLocation() + Character->GetActorForwardVector() * VERY_BIG + FVector(0.0f, 0.0f, 16.0f), (Character->GetActorForwardVector() * VERY_BIG) + Character->GetActorLocation() + Character->GetActorForwardVector() * VERY_BIG + FVector(0.0f, 0.0f, 16.0f), objectQuerry, collisionParams))
+		{
+			//Steer heads straight for the enemy without a path
+			Path.Empty();
+		}
+		else
+		{
+			//The enemy moves every frame, repair the last search instead of starting a new one
+			ReplanPath(TargetEnemy->GetActorLocation());
+		}
+	}
+
+	if (decision.Fire) Character->Fire();
+
+	if (CurrentState != previousState) FAISimulationStats::Get().StateTransitions[previousState][CurrentState]++;
+	FAISimulationStats::Get().Decisions++;
+	//No screen to print on in the headless simulation
+	if (!IsRunningCommandlet()) PrintData();
+}
+
+void AGame_AIController::Steer()
 {
 	switch (CurrentState)
 	{
 	case CHASING:
-		CurrentState = Chase();
+		if (!Path.IsDone()) FollowPathToTarget();
+		else if (TargetEnemy)
+		{
+			TargetLocation = TargetEnemy->GetActorLocation();
+			GoToLocation();
+		}
 		break;
 	case FLEEING:
-		CurrentState = Flee();
+		if (NearbyEnemies.Num() > 0) MoveAwayFromLocation();
 		break;
 	case WANDERING:
-		CurrentState = Wander();
+		FollowPathToTarget();
 		break;
 	case ENGAGE_VIOLENCE:
-		CurrentState = Fire();
+		//Keep aiming, firing is decided
+		if (TargetEnemy) LookAt(TargetEnemy->GetActorLocation());
 		break;
 	case SEEKING:
-		CurrentState = Seek();
+		if (TargetPickUp && !FollowFlowField(TargetLocation)) GoToLocation();
 		break;
 	}
 }
 
 float AGame_AIController::GetMissAngle()
 {
-	static FRandomStream random;
-	return FMath::Max(0.0f, random.FRandRange(0.0f, MissAngleRange) - MissAngleRange * Accuracy);
+	return FMath::Max(0.0f, Random.FRandRange(0.0f, MissAngleRange) - MissAngleRange * Accuracy);
 }
 
 void AGame_AIController::GoToLocation()
@@ -151,182 +354,182 @@ AActor* AGame_AIController::FindClosestActor(TArray<AActor*>& actors)
 	return closest;
 }
 
-AAI_GameCharacter* AGame_AIController::FindClosestEnemy(TSet<AAI_GameCharacter*>& enemies)
+ABasePickUp* AGame_AIController::FindClosestPickUp(FName tag) const
 {
-	if (NearbyEnemies.Num() <= 0) return nullptr;
-	AAI_GameCharacter* closest = nullptr;
-	for (const auto& first : enemies) { closest = first; break; }
-	float closestDistance = FVector::Distance(Character->GetActorLocation(), closest->GetActorLocation());
-	float tempDistance;
-	for (const auto& enemy : enemies)
-	{
-		tempDistance = FVector::Distance(Character->GetActorLocation(), enemy->GetActorLocation());
-		if (tempDistance < closestDistance)
-		{
-			closest = enemy;
-			closestDistance = tempDistance;
-		}
-	}
+	UPickUpSubsystem* pickUps = GetWorld()->GetSubsystem<UPickUpSubsystem>();
+	if (!pickUps) return nullptr;
 
-	return closest;
+	return pickUps->FindNearestPickUp(tag, Character->GetActorLocation(), PickUpsByPathDistance ? GridManager : nullptr);
 }
 
-TEnumAsByte<AIState> AGame_AIController::Wander()
+AAI_GameCharacter* AGame_AIController::FindClosestEnemy() const
 {
-	static FRandomStream random;
+	return NearbyEnemies.Num() > 0 ? NearbyEnemies[0] : nullptr;
+}
+
+AAI_GameCharacter* AGame_AIController::GetClosestEnemy(const FAIDecisionInput& input)
+{
+	return input.Enemies.Num() > 0 ? input.Enemies[0].Character : nullptr;
+}
 
-	if (Character->GetCurrentAmmo() <= 0)
+void AGame_AIController::DecideWander(const FAIDecisionInput& input, FAIDecision& decision)
+{
+	decision.State = WANDERING;
+	if (input.Ammo <= 0)
 	{
-		TArray<AActor*> pickUps;
-		UGameplayStatics::GetAllActorsWithTag(GetWorld(), "AmmoPickUp", pickUps);
-		if (pickUps.Num() > 0)
-		{
-			TargetPickUp = Cast<ABasePickUp>(FindClosestActor(pickUps));
-			FindPath(TargetPickUp->GetActorLocation());
-			return SEEKING;
-		}
+		decision.PickUpTag = "AmmoPickUp";
 	}
-	else if (NearbyEnemies.Num() > 0)
+	else if (input.Enemies.Num() > 0)
 	{
-		return HasEnemyInSight();
+		DecideOnEnemies(input, decision);
+		return;
 	}
-	else if (random.RandRange(0, Character->GetMaxHp()) > Character->GetCurrentHp())
+	else if (Random.RandRange(0, input.MaxHp) > input.Hp)
 	{
-		TArray<AActor*> pickUps;
-		UGameplayStatics::GetAllActorsWithTag(GetWorld(), "HealthPickUp", pickUps);
-		if (pickUps.Num() > 0)
-		{
-			TargetPickUp = Cast<ABasePickUp>(FindClosestActor(pickUps));
-			FindPath(TargetPickUp->GetActorLocation());
-			return SEEKING;
-		}
+		decision.PickUpTag = "HealthPickUp";
 	}
 
-	if (SecondsWandering <= 0 || Path.CellsInPath.Num() <= 0)
+	//What is left to do if there is no pick up to seek
+	if (decision.SecondsWandering <= 0 || !input.HasPath)
 	{
-		FindPath(TargetLocation);
-		TargetLocation = GridManager->GetRandomCell()->Location;
-		SecondsWandering = 5.0f;
+		decision.NewWanderPath = true;
+		decision.SecondsWandering = 5.0f;
 	}
-	else SecondsWandering -= GetWorld()->GetDeltaSeconds();
-
-	FollowPathToTarget();
-	return WANDERING;
+	else decision.SecondsWandering -= input.DeltaSeconds;
 }
 
-TEnumAsByte<AIState> AGame_AIController::Chase()
+void AGame_AIController::DecideChase(const FAIDecisionInput& input, FAIDecision& decision) const
 {
-	if (NearbyEnemies.Num() <= 0 || Character->GetCurrentAmmo() <= 0) return WANDERING;
-	if (!TargetEnemy) TargetEnemy = FindClosestEnemy(NearbyEnemies);
+	if (input.Enemies.Num() <= 0 || input.Ammo <= 0)
+	{
+		decision.State = WANDERING;
+		return;
+	}
+	//The target can have left the awareness range since the last decision
+	const FAIDecisionInput::FEnemy* target = input.Enemies.FindByPredicate([&](const FAIDecisionInput::FEnemy& enemy) { return enemy.Character == decision.TargetEnemy; });
+	if (!target) target = &input.Enemies[0];
+	decision.TargetEnemy = target->Character;
 
-	if (FVector::Distance(Character->GetActorLocation(), TargetEnemy->GetActorLocation()) > Character->GetWeaponRange())
+	if (FVector::Distance(input.Location, target->Location) > input.WeaponRange)
 	{
-		FHitResult outHitResult;
-		FCollisionObjectQueryParams objectQuerry;
-		FCollisionQueryParams collisionParams;
-		if (GetWorld()->LineTraceSingleByObjectType(outHitResult, Character->GetActorLocation() + Character->GetActorForwardVector() * VERY_BIG + FVector(0.0f, 0.0f, 16.0f), (Character->GetActorForwardVector() * VERY_BIG) + Character->GetActorLocation() + Character->GetActorForwardVector() * VERY_BIG + FVector(0.0f, 0.0f, 16.0f), objectQuerry, collisionParams))
-		{
-			TargetLocation = TargetEnemy->GetActorLocation();
-			GoToLocation();
-		}
-		else
-		{
-			FindPath(TargetEnemy->GetActorLocation());
-			FollowPathToTarget();
-		}
-		return CHASING;
+		decision.State = CHASING;
+		decision.ChaseEnemy = true;
+		decision.TargetLocation = target->Location;
 	}
-	else return ENGAGE_VIOLENCE;
+	else decision.State = ENGAGE_VIOLENCE;
 }
 
-TEnumAsByte<AIState> AGame_AIController::Flee()
+void AGame_AIController::DecideFlee(const FAIDecisionInput& input, FAIDecision& decision) const
 {
-	static float flightTime = 0.0f;
-
-	if (NearbyEnemies.Num() <= 0)
+	if (input.Enemies.Num() <= 0)
 	{
-		if (flightTime >= SecondsFleeing)
+		if (decision.SecondsFled >= SecondsFleeing)
 		{
-			flightTime = 0.0f;
-			return WANDERING;
+			decision.SecondsFled = 0.0f;
+			decision.State = WANDERING;
 		}
 		else
 		{
-			flightTime += GetWorld()->GetDeltaSeconds();
-			return FLEEING;
+			decision.SecondsFled += input.DeltaSeconds;
+			decision.State = FLEEING;
 		}
+		return;
 	}
 
-	if (!TargetEnemy) TargetEnemy = FindClosestEnemy(NearbyEnemies);
-	
-	FVector averageEnemyLocation = FVector(0.0f);
-	for (const auto& enemy : NearbyEnemies)
-	{
-		averageEnemyLocation += enemy->GetActorLocation();
-	}
-	averageEnemyLocation /= NearbyEnemies.Num();
-	TargetLocation = (Character->GetActorLocation() - averageEnemyLocation).GetSafeNormal() * SafeFlightDistance;
+	if (!decision.TargetEnemy) decision.TargetEnemy = GetClosestEnemy(input);
 
-	FHitResult outHitResult;
-	FCollisionObjectQueryParams objectQuerry;
-	FCollisionQueryParams collisionParams;
-	if (true)//GetWorld()->LineTraceSingleByObjectType(outHitResult, Character->GetActorLocation() + Character->GetActorForwardVector() * SMALL + FVector(0.0f, 0.0f, 16.0f), (Character->GetActorForwardVector() * SMALL) + Character->GetActorLocation() + Character->GetActorForwardVector() * SMALL + FVector(0.0f, 0.0f, 16.0f), objectQuerry, collisionParams))
-	{
-		MoveAwayFromLocation();
-	}
-	else
+	//The enemies are sorted by distance, the nearest ones are the threat
+	int32 enemyCount = FMath::Clamp(FleeEnemyCount, 1, input.Enemies.Num());
+	FVector averageEnemyLocation = FVector(0.0f);
+	for (int32 i = 0; i < enemyCount; i++)
 	{
-		FindPath(TargetLocation);
-		FollowPathToTarget();
+		averageEnemyLocation += input.Enemies[i].Location;
 	}
-	return FLEEING;
+	averageEnemyLocation /= enemyCount;
+	decision.TargetLocation = (input.Location - averageEnemyLocation).GetSafeNormal() * SafeFlightDistance;
+	decision.State = FLEEING;
 }
 
-TEnumAsByte<AIState> AGame_AIController::Fire()
+void AGame_AIController::DecideFire(const FAIDecisionInput& input, FAIDecision& decision)
 {
-	if (NearbyEnemies.Num() < 0 || Character->GetCurrentAmmo() <= 0) return WANDERING;
+	decision.State = WANDERING;
+	if (input.Ammo <= 0) return;
 
-	if (!TargetEnemy) TargetEnemy = FindClosestEnemy(NearbyEnemies);
-	if (!TargetEnemy) return WANDERING;
+	if (!decision.TargetEnemy) decision.TargetEnemy = GetClosestEnemy(input);
+	const FAIDecisionInput::FEnemy* target = input.Enemies.FindByPredicate([&](const FAIDecisionInput::FEnemy& enemy) { return enemy.Character == decision.TargetEnemy; });
+	if (!target) return;
 
-	if (FVector::Distance(Character->GetActorLocation(), TargetEnemy->GetActorLocation()) > Character->GetWeaponRange()) return CHASING;
-
-	float angle = LookAt(TargetEnemy->GetActorLocation());
-	if (tan(abs(angle)) * FVector::Distance(Character->GetActorLocation(), TargetEnemy->GetActorLocation()) <= Character->GetWeaponHitbox()->GetScaledCapsuleRadius() + GetMissAngle())
+	float distance = FVector::Distance(input.Location, target->Location);
+	if (distance > input.WeaponRange)
 	{
-		Character->Fire();
+		decision.State = CHASING;
+		return;
 	}
-	return ENGAGE_VIOLENCE;
+
+	float angle = GetAngleTo(input.Location, input.Forward, target->Location);
+	decision.Fire = tan(abs(angle)) * distance <= input.WeaponHitboxRadius + GetMissAngle();
+	decision.State = ENGAGE_VIOLENCE;
 }
 
-TEnumAsByte<AIState> AGame_AIController::Seek()
+void AGame_AIController::DecideSeek(const FAIDecisionInput& input, FAIDecision& decision) const
 {
-	if(NearbyEnemies.Num() > 0) return HasEnemyInSight();
-	
-	if (!TargetPickUp || !TargetPickUp->ValidPickUp)
+	if (input.Enemies.Num() > 0)
 	{
-		return WANDERING;
+		DecideOnEnemies(input, decision);
+		return;
 	}
 
-	if (true)//Path.CellsInPath.Num() <= 0)
+	if (!input.HasValidPickUp)
 	{
-		TargetLocation = TargetPickUp->GetActorLocation();
-		GoToLocation();
+		decision.State = WANDERING;
+		return;
 	}
-	else FollowPathToTarget();
 
-	return SEEKING;
+	//Every bot going for the same pick up follows the same flow field, the last cell is walked straight
+	decision.TargetLocation = input.PickUpLocation;
+	decision.State = SEEKING;
 }
 
-TEnumAsByte<AIState> AGame_AIController::HasEnemyInSight()
+void AGame_AIController::DecideOnEnemies(const FAIDecisionInput& input, FAIDecision& decision) const
 {
-	for (const auto& enemy : NearbyEnemies)
+	for (const auto& enemy : input.Enemies)
 	{
-		if (Character->LowHealth && !enemy->LowHealth) return FLEEING;
-		else if (!TargetEnemy) TargetEnemy = FindClosestEnemy(NearbyEnemies);
+		if (input.LowHealth && !enemy.LowHealth)
+		{
+			decision.State = FLEEING;
+			return;
+		}
 	}
-	if (TargetEnemy && FVector::Distance(TargetEnemy->GetActorLocation(), Character->GetActorLocation()) <= Character->GetWeaponRange()) return ENGAGE_VIOLENCE;
-	else return CHASING;
+	if (!decision.TargetEnemy) decision.TargetEnemy = GetClosestEnemy(input);
+
+	const FAIDecisionInput::FEnemy* target = input.Enemies.FindByPredicate([&](const FAIDecisionInput::FEnemy& enemy) { return enemy.Character == decision.TargetEnemy; });
+	if (target && FVector::Distance(target->Location, input.Location) <= input.WeaponRange) decision.State = ENGAGE_VIOLENCE;
+	else decision.State = CHASING;
+}
+
+TEnumAsByte<AIState> AGame_AIController::Wander()
+{
+	return RunDecision(WANDERING);
+}
+
+TEnumAsByte<AIState> AGame_AIController::Chase()
+{
+	return RunDecision(CHASING);
+}
+
+TEnumAsByte<AIState> AGame_AIController::Flee()
+{
+	return RunDecision(FLEEING);
+}
+
+TEnumAsByte<AIState> AGame_AIController::Fire()
+{
+	return RunDecision(ENGAGE_VIOLENCE);
+}
+
+TEnumAsByte<AIState> AGame_AIController::Seek()
+{
+	return RunDecision(SEEKING);
 }
 
 void AGame_AIController::BeginPlay()
@@ -338,27 +541,55 @@ void AGame_AIController::BeginPlay()
 
 	FAttachmentTransformRules transformRules(EAttachmentRule::SnapToTarget, false);
 	AttachToActor(Character, transformRules);
-	//NearbyEnemies.Empty();
+	if (UAIAwarenessSubsystem* awareness = GetWorld()->GetSubsystem<UAIAwarenessSubsystem>()) awareness->RegisterController(this);
+	if (UAIDecisionScheduler* scheduler = GetWorld()->GetSubsystem<UAIDecisionScheduler>()) scheduler->RegisterController(this);
+}
+
+void AGame_AIController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UAIAwarenessSubsystem* awareness = GetWorld()->GetSubsystem<UAIAwarenessSubsystem>()) awareness->UnregisterController(this);
+	if (UAIDecisionScheduler* scheduler = GetWorld()->GetSubsystem<UAIDecisionScheduler>()) scheduler->UnregisterController(this);
+	if (IsValid(GridManager))
+	{
+		if (IsWaitingForPath()) GridManager->CancelPathRequest(PathRequestHandle);
+		GridManager->ReleaseIncrementalPlanner(this);
+		GridManager->OnGridRegionDirty.RemoveAll(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AGame_AIController::SetGridManager(AGridManager* gridManager)
+{
+	if (IsValid(GridManager)) GridManager->OnGridRegionDirty.RemoveAll(this);
+
+	GridManager = gridManager;
+	if (GridManager) GridManager->OnGridRegionDirty.AddUObject(this, &AGame_AIController::OnGridRegionDirty);
 }
 
 void AGame_AIController::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	double startTime = FPlatformTime::Seconds();
 	RotationRate = 0.0f;
 	if (!NearbyEnemies.Contains(TargetEnemy)) TargetEnemy = nullptr;
-	Act();
+	SecondsSinceDecision += DeltaTime;
+	Steer();
 	Character->SetActorRotation(Character->GetActorRotation() + FRotator(0.0f, FMath::Clamp(RotationRate, -1.0f, 1.0f) * Character->BaseTurnRate * DeltaTime, 0.0f));
-	PrintData();
+	FAISimulationStats::Get().DecisionSeconds += FPlatformTime::Seconds() - startTime;
 }
 
 void AGame_AIController::AddNearbyEnemy(AAI_GameCharacter* enemy)
 {
-	GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Green, FString::Printf(TEXT("Enemy Added!")));
-	if (!enemy) return;
-	if(enemy != Character) NearbyEnemies.Add(enemy);
+	//Kept so the Blueprints still compile, UAIAwarenessSubsystem replaces the list every frame
 }
 
 void AGame_AIController::RemoveNearbyEnemy(AAI_GameCharacter* enemy)
+{
+	//Kept so the Blueprints still compile, see ForgetNearbyEnemy
+}
+
+void AGame_AIController::ForgetNearbyEnemy(AAI_GameCharacter* enemy)
 {
 	if (!enemy) return;
 	if (enemy != Character) NearbyEnemies.Remove(enemy);
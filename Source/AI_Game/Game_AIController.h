@@ -24,6 +24,57 @@ enum AIState
 	LAST			UMETA(DisplayName = "LastState")
 };
 
+//What a decision reads of the world, copied on the game thread so the decisions can run on the worker threads
+struct FAIDecisionInput
+{
+	struct FEnemy
+	{
+		AAI_GameCharacter* Character;
+		FVector Location;
+		bool LowHealth;
+	};
+
+	TEnumAsByte<AIState> State;
+	FVector Location;
+	FVector Forward;
+	int32 Hp;
+	int32 MaxHp;
+	int32 Ammo;
+	bool LowHealth;
+	float WeaponRange;
+	float WeaponHitboxRadius;
+	//Nearest first, like NearbyEnemies
+	TArray<FEnemy, TInlineAllocator<8>> Enemies;
+	AAI_GameCharacter* TargetEnemy;
+	bool HasValidPickUp;
+	FVector PickUpLocation;
+	//Walking a path or waiting for one
+	bool HasPath;
+	//Time since the last decision
+	float DeltaSeconds;
+	//Walkable cell the paths the decision asks for start from, snapped for all due controllers at once by UAIDecisionScheduler
+	int32 CellIndex = INDEX_NONE;
+};
+
+//What a decision wants done, applied on the game thread
+struct FAIDecision
+{
+	TEnumAsByte<AIState> State;
+	AAI_GameCharacter* TargetEnemy = nullptr;
+	FVector TargetLocation;
+	float SecondsWandering = 0.0f;
+	float SecondsFled = 0.0f;
+	//Seek the nearest pick up with the tag, if there is one
+	FName PickUpTag;
+	//Walk to TargetLocation and pick the next random cell to wander to
+	bool NewWanderPath = false;
+	//Head for TargetEnemy, straight or over the grid
+	bool ChaseEnemy = false;
+	bool Fire = false;
+	//From the input, INDEX_NONE to snap the pawn's location when the path is requested
+	int32 StartCellIndex = INDEX_NONE;
+};
+
 UCLASS()
 class AI_GAME_API AGame_AIController : public AAIController
 {
@@ -85,36 +136,91 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 		FPath Path;
 
+	//Requests a path to destination from the grid manager, Path is replaced once the request completes
 	UFUNCTION(BlueprintCallable)
 		bool FindPath(FVector destination);
+	//FindPath from a cell already snapped to, INDEX_NONE for the pawn's location
+	bool FindPathFromCell(int32 startIndex, FVector destination);
+
+	//Replaces Path right away, repairing the previous search instead of queueing a new one. For targets that move every frame.
+	UFUNCTION(BlueprintCallable)
+		bool ReplanPath(FVector destination);
+
+	int32 PathRequestHandle = INDEX_NONE;
+	void OnPathRequestComplete(int32 requestHandle, bool pathFound, const FPath& path);
+	//Requests a new path to the same target when the cells ahead on Path changed
+	void OnGridRegionDirty(const FGridDirtyRegion& region);
+	inline bool IsWaitingForPath() const { return PathRequestHandle != INDEX_NONE; }
 
 	UFUNCTION(BlueprintCallable)
 		void FollowPathToTarget();
+	//Steers along the flow field the grid manager shares for destination, returns false once there is no next cell
+	UFUNCTION(BlueprintCallable)
+		bool FollowFlowField(FVector destination);
+	//Goal cell of the flow field followed last, a path query is counted when it changes
+	int32 FlowFieldGoalIndex = INDEX_NONE;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
 		float CellReachDistance = 80.0f;
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
 		float PathfindMaxMoveAngle = 1.0f;
+	//Hierarchical paths get their next leg once fewer cells than this are left to walk
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+		int32 PathRefineCellsAhead = 4;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
 		float SecondsWandering = 10.0f;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
 		float SecondsFleeing = 2.0f;
-
-	void Act();
-
-	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Decision")
-		TSet<AAI_GameCharacter*> NearbyEnemies;
-
-	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Decision")
+	float SecondsFled = 0.0f;
+
+	//Every random decision of the controller draws from it, so a seeded run always plays out the same way
+	FRandomStream Random;
+
+	//The state timers count the time between decisions, not frames
+	float SecondsSinceDecision = 0.0f;
+
+	//Decides and commits right away on the game thread, starting from state
+	TEnumAsByte<AIState> RunDecision(TEnumAsByte<AIState> state);
+	//Keeps moving the way the last decision chose, every frame, without changing state, targets or paths
+	void Steer();
+
+	void DecideWander(const FAIDecisionInput& input, FAIDecision& decision);
+	void DecideChase(const FAIDecisionInput& input, FAIDecision& decision) const;
+	void DecideFlee(const FAIDecisionInput& input, FAIDecision& decision) const;
+	void DecideFire(const FAIDecisionInput& input, FAIDecision& decision);
+	void DecideSeek(const FAIDecisionInput& input, FAIDecision& decision) const;
+	//Flee, fight or chase the enemies around
+	void DecideOnEnemies(const FAIDecisionInput& input, FAIDecision& decision) const;
+	static AAI_GameCharacter* GetClosestEnemy(const FAIDecisionInput& input);
+	//Signed angle in radians from forward to the direction of target on the XY plane
+	static float GetAngleTo(const FVector& location, const FVector& forward, const FVector& target);
+
+	//Enemies within NearbyEnemyRange, nearest first, kept up to date by UAIAwarenessSubsystem
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Decision")
+		TArray<AAI_GameCharacter*> NearbyEnemies;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Decision")
 		float NearbyEnemyRange = 10000;
 
+	//How many of the nearest enemies the character flees from
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Decision")
+		int32 FleeEnemyCount = 3;
+
 	UFUNCTION(BlueprintCallable)
 		AActor* FindClosestActor(TArray<AActor*>& actors);
 
+	//Nearest pick up with the tag that can be picked up, from UPickUpSubsystem
+	UFUNCTION(BlueprintCallable)
+		ABasePickUp* FindClosestPickUp(FName tag) const;
+
+	//Whether the closest pick up is the one nearest over the grid or in a straight line
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Decision")
+		bool PickUpsByPathDistance = true;
+
 	UFUNCTION(BlueprintCallable)
-		AAI_GameCharacter* FindClosestEnemy(TSet<AAI_GameCharacter*>& enemies);
+		AAI_GameCharacter* FindClosestEnemy() const;
 
 	//Behaviour methods
 
@@ -136,24 +242,40 @@ protected:
 	UFUNCTION(BlueprintCallable)
 		TEnumAsByte<AIState> Seek();
 
-	UFUNCTION(BlueprintCallable)
-		TEnumAsByte<AIState> HasEnemyInSight();
-
 public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 		AGridManager* GridManager;
+	//Also follows the grid changes of the manager
+	void SetGridManager(AGridManager* gridManager);
 
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaTime) override;
 
-	UFUNCTION(BlueprintCallable)
+	//The decision is split in three so UAIDecisionScheduler can run the Decide of many controllers at once on the worker threads.
+	//Copies what Decide reads, game thread only.
+	FAIDecisionInput GatherDecisionInput() const;
+	//The state machine. Only reads input and the controller's settings and draws from its own random stream.
+	FAIDecision Decide(const FAIDecisionInput& input);
+	//Applies the decision: state, targets, pick up queries, path requests and firing. Game thread only.
+	void CommitDecision(const FAIDecision& decision);
+
+	UFUNCTION(BlueprintCallable, meta = (DeprecatedFunction, DeprecationMessage = "Nearby enemies come from UAIAwarenessSubsystem, the overlap events are no longer needed"))
 	void AddNearbyEnemy(AAI_GameCharacter* enemy);
 
-	UFUNCTION(BlueprintCallable)
+	UFUNCTION(BlueprintCallable, meta = (DeprecatedFunction, DeprecationMessage = "Nearby enemies come from UAIAwarenessSubsystem, the overlap events are no longer needed"))
 	void RemoveNearbyEnemy(AAI_GameCharacter* enemy);
+	//Called by UAIAwarenessSubsystem when the enemy leaves play, so it is not targeted until the next Update
+	void ForgetNearbyEnemy(AAI_GameCharacter* enemy);
+	inline void SetNearbyEnemies(const TArray<AAI_GameCharacter*>& enemies) { NearbyEnemies = enemies; }
 
 	void PrintData();
 
+	inline void SetRandomSeed(int32 seed) { Random.Initialize(seed); }
+	inline TEnumAsByte<AIState> GetCurrentState() const { return CurrentState; }
+	inline float GetNearbyEnemyRange() const { return NearbyEnemyRange; }
+	inline AAI_GameCharacter* GetCharacter() const { return Character; }
+
 	//For Testing
 
 	UFUNCTION(BlueprintCallable)
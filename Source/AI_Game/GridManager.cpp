@@ -11,122 +11,387 @@
 #include "GenericPlatform/GenericPlatformMath.h"
 #include "Game_AIController.h"
 #include "DrawDebugHelpers.h"
-#include "Algo/Reverse.h"
+#include "GridPathfinder.h"
+#include "JumpPointSearch.h"
+#include "PathSmoother.h"
+#include "Async/ParallelFor.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Misc/ScopedSlowTask.h"
 #include "AI_GameCharacter.h"
+#include "NavGridAsset.h"
+#include "AISimulationStats.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/App.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "Serialization/ArchiveSaveCompressedProxy.h"
+#include "Serialization/ArchiveLoadCompressedProxy.h"
 
 #define ECC_GridTracer ECC_GameTraceChannel1
-
-UCell* AGridManager::GetCellFromCoordinates(int32 x, int32 y) const
+//Side in cells of the tiles the grid wide passes are split into for the worker threads
+#define GRID_TILE_SIZE 32
+//Random draws GetRandomCellIndex makes before it looks through the cells in order
+#define RANDOM_CELL_DRAWS 64
+//Cell views kept before the first prune of the ones no longer used
+#define MIN_CELL_VIEWS_PRUNE_COUNT 1024
+
+UCell* AGridManager::GetCellFromCoordinates(int32 x, int32 y, int32 layer)
 {
-	if (GridCells.Num() == int32(0)) return nullptr;
+	int32 index;
+	if (!Grid.GetIndex(x, y, layer, index)) return nullptr;
+
+	return GetCell(index);
+}
 
-	if (x >= CellCount.X || y >= CellCount.Y)
+bool AGridManager::GetCellIndexFromGridPosition(int32& index, int32 x, int32 y) const
+{
+	if (Grid.Num() == int32(0))
 	{
-		return nullptr;
+		UE_LOG(LogTemp, Warning, TEXT("Grid is empty."));
+		return false;
 	}
 
-	int index = 0;
-	index += x * CellCount.Y;
-	index += y;
+	return Grid.GetIndex(x, y, index);
+}
+
+UCell* AGridManager::GetCell(int32 cellIndex)
+{
+	if (!Grid.IsValidIndex(cellIndex)) return nullptr;
 
-	if (index < GridCells.Num())
+	UCell* cell = CellViews.FindRef(cellIndex).Get();
+	if (!cell)
 	{
-		return GridCells[index];
+		if (CellViews.Num() >= CellViewsPruneCount)
+		{
+			for (auto it = CellViews.CreateIterator(); it; ++it)
+			{
+				if (!it.Value().IsValid()) it.RemoveCurrent();
+			}
+			CellViewsPruneCount = FMath::Max(CellViews.Num() * 2, MIN_CELL_VIEWS_PRUNE_COUNT);
+		}
+
+		cell = NewObject<UCell>(this);
+		cell->Index = cellIndex;
+		cell->Coordinates = Grid.GetCoordinates(cellIndex);
+		cell->Coordinates.Z = Grid.GetLayer(cellIndex);
+		CellViews.Add(cellIndex, cell);
 	}
+	UpdateCellView(cellIndex);
 
-	return nullptr;
+	return cell;
 }
 
-bool AGridManager::GetCellIndexFromGridPosition(int32& index, int32 x, int32 y) const
+void AGridManager::UpdateCellView(int32 index)
 {
-	if (GridCells.Num() == int32(0))
+	UCell* cell = CellViews.FindRef(index).Get();
+	if (!cell) return;
+
+	cell->Location = Grid.GetLocation(index);
+	cell->State = Grid.GetState(index);
+	cell->MoveCost = Grid.GetMoveCost(index);
+	cell->ModifierPriority = Grid.GetModifierPriority(index);
+	cell->Color = Grid.GetColor(index);
+}
+
+TArray<UCell*> AGridManager::GetGridCells()
+{
+	TArray<UCell*> cells;
+	cells.Reserve(Grid.Num());
+	for (int32 index = 0; index < Grid.Num(); index++) cells.Add(GetCell(index));
+
+	return cells;
+}
+
+void AGridManager::SetAIControllerReferences()
+{
+	TArray<AActor*> controllers;
+	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AGame_AIController::StaticClass(), controllers);
+	for (const auto& controller : controllers)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("GridCells is empty."));
-		return false;
+		Cast<AGame_AIController>(controller)->SetGridManager(this);
 	}
-	if (x >= CellCount.X || x < 0 || y >= CellCount.Y || y < 0)
+}
+
+void AGridManager::DrawCells()
+{
+	auto world = GetWorld();
+	for (int32 index = 0; index < Grid.Num(); index++)
 	{
-		return false;
+		world->ForegroundLineBatcher->DrawPoint(Grid.GetLocation(index), Grid.GetColor(index), 50, 0.0f);
 	}
+}
 
-	int position = 0;
-	position += x * CellCount.Y;
-	position += y;
+void AGridManager::ProcessTiles(const TCHAR* stageName, const FIntPoint& regionMin, const FIntPoint& regionMax, TFunctionRef<void(const FIntPoint&, const FIntPoint&)> tileFunction)
+{
+	const FIntVector& cellCount = Grid.GetCellCount();
+	FIntPoint min(FMath::Max(regionMin.X, 0), FMath::Max(regionMin.Y, 0));
+	FIntPoint max(FMath::Min(regionMax.X, cellCount.X - 1), FMath::Min(regionMax.Y, cellCount.Y - 1));
+	if (min.X > max.X || min.Y > max.Y) return;
+
+	int32 tilesX = FMath::DivideAndRoundUp(max.X - min.X + 1, GRID_TILE_SIZE);
+	int32 tilesY = FMath::DivideAndRoundUp(max.Y - min.Y + 1, GRID_TILE_SIZE);
+	int32 tileCount = tilesX * tilesY;
+	auto runTile = [&](int32 tile)
+	{
+		FIntPoint tileMin(min.X + (tile / tilesY) * GRID_TILE_SIZE, min.Y + (tile % tilesY) * GRID_TILE_SIZE);
+		FIntPoint tileMax(FMath::Min(tileMin.X + GRID_TILE_SIZE - 1, max.X), FMath::Min(tileMin.Y + GRID_TILE_SIZE - 1, max.Y));
+		tileFunction(tileMin, tileMax);
+	};
 
-	if (position < GridCells.Num())
+	if (!stageName)
 	{
-		index = position;
-		return true;
+		ParallelFor(tileCount, runTile);
+		return;
 	}
 
-	UE_LOG(LogTemp, Warning, TEXT("position was bigger then GridCells size."));
-	return false;
+	//Tiles go to the workers in batches so progress can be reported from the game thread between them
+	int32 batchSize = FMath::Max(1, tileCount / 10);
+	FScopedSlowTask slowTask(tileCount, FText::FromString(stageName));
+	for (int32 firstTile = 0; firstTile < tileCount; firstTile += batchSize)
+	{
+		int32 batchCount = FMath::Min(batchSize, tileCount - firstTile);
+		slowTask.EnterProgressFrame(batchCount);
+
+		ParallelFor(batchCount, [&](int32 batchIndex) { runTile(firstTile + batchIndex); });
+
+		UE_LOG(LogTemp, Log, TEXT("%s: %d%%"), stageName, (firstTile + batchCount) * 100 / tileCount);
+	}
 }
 
-void AGridManager::SetAIControllerReferences()
+void AGridManager::ProcessCellsInTiles(const TCHAR* stageName, const FIntPoint& regionMin, const FIntPoint& regionMax, TFunctionRef<void(int32)> cellFunction)
 {
-	TArray<AActor*> controllers;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AGame_AIController::StaticClass(), controllers);
-	for (const auto& controller : controllers)
+	ProcessTiles(stageName, regionMin, regionMax, [&](const FIntPoint& tileMin, const FIntPoint& tileMax)
+	{
+		int32 index;
+		for (int32 x = tileMin.X; x <= tileMax.X; x++)
+		{
+			for (int32 y = tileMin.Y; y <= tileMax.Y; y++)
+			{
+				if (Grid.GetIndex(x, y, index)) cellFunction(index);
+			}
+		}
+	});
+}
+
+void AGridManager::CalculateCellsHeights()
+{
+	PrepareGridChange();
+	OnGridRebuilt();
+	if (MaxCellLayers > 1 && !Grid.IsChunked())
+	{
+		TraceCellLayers();
+		return;
+	}
+	if (Grid.IsLayered())
 	{
-		Cast<AGame_AIController>(controller)->GridManager = this;
+		DropObstacleStamps();
+		CellViews.Empty();
+		SlopeCutCells.Empty();
+		TArray<uint8> extraLayerCounts;
+		extraLayerCounts.SetNumZeroed(Grid.GetColumnCount());
+		Grid.SetColumnLayers(extraLayerCounts);
 	}
+	TraceCellHeights(FIntPoint(0, 0), FIntPoint(Grid.GetCellCount().X - 1, Grid.GetCellCount().Y - 1), true);
 }
 
-void AGridManager::DrawCells()
+void AGridManager::TraceCellHeights(const FIntPoint& min, const FIntPoint& max, bool logProgress)
 {
+	double startTime = FPlatformTime::Seconds();
 	auto world = GetWorld();
-	for (auto const& cell : GridCells)
+	FCollisionQueryParams params;
+	//The arrays only cover the box, a cell's slot is its position in it
+	int32 width = max.Y - min.Y + 1;
+	int32 cellCount = (max.X - min.X + 1) * width;
+	auto getSlot = [&](int32 index)
+	{
+		FIntVector coordinates = Grid.GetCoordinates(index);
+		return (coordinates.X - min.X) * width + coordinates.Y - min.Y;
+	};
+	auto isInBox = [&](int32 index)
+	{
+		FIntVector coordinates = Grid.GetCoordinates(index);
+		return coordinates.X >= min.X && coordinates.X <= max.X && coordinates.Y >= min.Y && coordinates.Y <= max.Y;
+	};
+
+	//Scene queries take the physics scene read lock themselves, so the traces can run on the worker threads.
+	//Every trace keeps the exact start and end it had when this ran cell by cell, and the results are only written to the grid at the end.
+	TArray<bool> centerHits;
+	TArray<float> centerHeights;
+	TArray<bool> unsafeCells;
+	centerHits.Init(false, cellCount);
+	centerHeights.Init(0.0f, cellCount);
+	unsafeCells.Init(false, cellCount);
+
+	ProcessCellsInTiles(logProgress ? TEXT("Tracing cell heights") : nullptr, min, max, [&](int32 index)
+	{
+		FVector location = Grid.GetLocation(index);
+		FVector start = FVector(location.X, location.Y, GetActorLocation().Z + LinceTraceHeight);
+		FVector end = FVector(location.X, location.Y, GetActorLocation().Z - LinceTraceHeight);
+		FHitResult outResult;
+		int32 slot = getSlot(index);
+		centerHits[slot] = world->LineTraceSingleByChannel(outResult, start, end, ECC_Visibility, params);
+		centerHeights[slot] = outResult.ImpactPoint.Z;
+	});
+
+	FThreadSafeCounter safetyTraces;
+	FThreadSafeCounter reusedTraces;
+	float safetyDistance = CellRadius + SafetyRadius;
+	int32 cellsPerSafetyDistance = FMath::RoundToInt(safetyDistance / Grid.GetCellSize());
+
+	ProcessCellsInTiles(logProgress ? TEXT("Tracing cell slopes") : nullptr, min, max, [&](int32 index)
+	{
+		int32 slot = getSlot(index);
+		if (!centerHits[slot]) return;
+
+		FVector location = Grid.GetLocation(index);
+		FIntVector coordinates = Grid.GetCoordinates(index);
+		FVector start = FVector(location.X, location.Y, GetActorLocation().Z + LinceTraceHeight);
+		FVector end = FVector(location.X, location.Y, GetActorLocation().Z - LinceTraceHeight);
+		FHitResult outResult;
+		FVector safetyAjust;
+		int32 neighborIndex;
+
+		for (float i = -1.0f; i <= 1.0f; i++)
+		{
+			for (float j = -1.0f; j <= 1.0f; j++)
+			{
+				if (i == 0 && j == 0) continue;
+				safetyAjust = FVector(i * safetyDistance, j * safetyDistance, 0.0f);
+				FVector sampleStart = start + safetyAjust;
+
+				bool hit;
+				float height;
+				//A sample that lands exactly where a neighbor's center was traced reuses that trace
+				if (Grid.GetIndex(coordinates.X + (int32)i * cellsPerSafetyDistance, coordinates.Y + (int32)j * cellsPerSafetyDistance, neighborIndex) && isInBox(neighborIndex)
+					&& Grid.GetLocation(neighborIndex).X == sampleStart.X && Grid.GetLocation(neighborIndex).Y == sampleStart.Y)
+				{
+					hit = centerHits[getSlot(neighborIndex)];
+					height = centerHeights[getSlot(neighborIndex)];
+					reusedTraces.Increment();
+				}
+				else
+				{
+					hit = world->LineTraceSingleByChannel(outResult, sampleStart, end + safetyAjust, ECC_Visibility, params);
+					height = outResult.ImpactPoint.Z;
+					safetyTraces.Increment();
+				}
+
+				//One unsafe sample is enough, the remaining ones can't change the outcome
+				if (!hit || abs(height - centerHeights[slot]) > MaxTraversableSlope)
+				{
+					unsafeCells[slot] = true;
+					return;
+				}
+			}
+		}
+	});
+
+	int32 index;
+	for (int32 x = min.X; x <= max.X; x++)
 	{
-		GetWorld()->ForegroundLineBatcher->DrawPoint(cell->Location, cell->Color, 50, 0.0f);
+		for (int32 y = min.Y; y <= max.Y; y++)
+		{
+			if (!Grid.GetIndex(x, y, index)) continue;
+
+			int32 slot = getSlot(index);
+			if (centerHits[slot]) Grid.SetHeight(index, centerHeights[slot]);
+			if (!centerHits[slot] || unsafeCells[slot]) Grid.SetState(index, BLOCKED);
+		}
 	}
+
+	if (logProgress) UE_LOG(LogTemp, Log, TEXT("Cell heights traced: %d cells, %d safety traces, %d reused center traces in %.2f s"),
+		cellCount, safetyTraces.GetValue(), reusedTraces.GetValue(), FPlatformTime::Seconds() - startTime);
 }
 
-void AGridManager::CalculateCellsHeights()
+void AGridManager::TraceCellLayers()
 {
+	double startTime = FPlatformTime::Seconds();
 	auto world = GetWorld();
-	FHitResult outResult;
 	FCollisionQueryParams params;
-	FVector start;
-	FVector end;
-	FVector safetyAjust;
+	int32 columnCount = Grid.GetColumnCount();
+	int32 maxLayers = FMath::Clamp(MaxCellLayers, 1, MAX_CELL_LAYERS);
+	float clearance = FMath::Max(MinLayerClearance, 1.0f);
+	FIntPoint min(0, 0);
+	FIntPoint max(Grid.GetCellCount().X - 1, Grid.GetCellCount().Y - 1);
+
+	//Each trace goes on from clearance under the last surface found, a surface closer under another one has no room to stand on
+	TArray<float> surfaceHeights;
+	TArray<uint8> surfaceCounts;
+	surfaceHeights.Init(0.0f, columnCount * maxLayers);
+	surfaceCounts.Init(0, columnCount);
+	FThreadSafeCounter surfaceTraces;
+	ProcessCellsInTiles(TEXT("Tracing cell layers"), min, max, [&](int32 column)
+	{
+		FVector location = Grid.GetLocation(column);
+		FVector start = FVector(location.X, location.Y, GetActorLocation().Z + LinceTraceHeight);
+		FVector end = FVector(location.X, location.Y, GetActorLocation().Z - LinceTraceHeight);
+		FHitResult outResult;
+		while (surfaceCounts[column] < maxLayers && start.Z > end.Z)
+		{
+			surfaceTraces.Increment();
+			if (!world->LineTraceSingleByChannel(outResult, start, end, ECC_Visibility, params)) break;
+
+			//A trace starting inside a floor hits it right away, that is no surface
+			if (!outResult.bStartPenetrating) surfaceHeights[column * maxLayers + surfaceCounts[column]++] = outResult.ImpactPoint.Z;
+			start.Z = FMath::Min(outResult.ImpactPoint.Z, start.Z) - clearance;
+		}
+	});
+
+	//Layer 0 is the top surface, the one a flat grid has. The stamps and views of the old cells are dropped.
+	DropObstacleStamps();
+	CellViews.Empty();
+	SlopeCutCells.Empty();
+	TArray<uint8> extraLayerCounts;
+	extraLayerCounts.SetNumUninitialized(columnCount);
+	for (int32 column = 0; column < columnCount; column++) extraLayerCounts[column] = FMath::Max(surfaceCounts[column] - 1, 0);
+	Grid.SetColumnLayers(extraLayerCounts);
+	for (int32 column = 0; column < columnCount; column++)
+	{
+		if (surfaceCounts[column] == 0) Grid.SetState(column, BLOCKED);
+		for (int32 layer = 0; layer < surfaceCounts[column]; layer++) Grid.SetHeight(Grid.GetLayerCell(column, layer), surfaceHeights[column * maxLayers + layer]);
+	}
 
-	for (auto const& cell : GridCells)
+	//The slope samples only look around the height of their surface, so the floors above it don't hide it
+	TArray<bool> unsafeCells;
+	unsafeCells.Init(false, Grid.Num());
+	FThreadSafeCounter safetyTraces;
+	float safetyDistance = CellRadius + SafetyRadius;
+	FVector slopeReach(0.0f, 0.0f, MaxTraversableSlope);
+	ProcessCellsInTiles(TEXT("Tracing cell slopes"), min, max, [&](int32 column)
 	{
-		start = FVector(cell->Location.X, cell->Location.Y, GetActorLocation().Z + LinceTraceHeight);
-		end = FVector(cell->Location.X, cell->Location.Y, GetActorLocation().Z - LinceTraceHeight);
-		if (world->LineTraceSingleByChannel(outResult, start, end, ECC_Visibility, params))
+		FHitResult outResult;
+		for (int32 layer = 0; layer < surfaceCounts[column]; layer++)
 		{
-			cell->Location = FVector(outResult.ImpactPoint);
-			for (float i = -1.0f; i <= 1.0f; i++)
+			int32 index = Grid.GetLayerCell(column, layer);
+			FVector location = Grid.GetLocation(index);
+			for (float i = -1.0f; i <= 1.0f && !unsafeCells[index]; i++)
 			{
 				for (float j = -1.0f; j <= 1.0f; j++)
 				{
 					if (i == 0 && j == 0) continue;
-					safetyAjust = FVector(i * (CellRadius + SafetyRadius), j * (CellRadius + SafetyRadius), 0.0f);
-					if (world->LineTraceSingleByChannel(outResult, start + safetyAjust, end + safetyAjust, ECC_Visibility, params))
-					{
-						if (abs(outResult.ImpactPoint.Z - cell->Location.Z) > MaxTraversableSlope)
-						{
-							cell->State = BLOCKED;
-							cell->SetColorByState();
-							i = j = 2.0f;
-						}
-					}
-					else
+					FVector sample = location + FVector(i * safetyDistance, j * safetyDistance, 0.0f);
+					safetyTraces.Increment();
+					//A sample starting inside geometry is against a wall
+					if (!world->LineTraceSingleByChannel(outResult, sample + slopeReach, sample - slopeReach, ECC_Visibility, params) || outResult.bStartPenetrating)
 					{
-						cell->State = BLOCKED;
-						cell->SetColorByState();
+						unsafeCells[index] = true;
+						break;
 					}
 				}
 			}
 		}
-		else
-		{
-			cell->State = BLOCKED;
-			cell->SetColorByState();
-		}
+	});
+
+	for (int32 index = 0; index < Grid.Num(); index++)
+	{
+		if (unsafeCells[index]) Grid.SetState(index, BLOCKED);
 	}
+
+	UE_LOG(LogTemp, Log, TEXT("Cell layers traced: %d columns, %d cells in up to %d layers, %d surface traces, %d safety traces in %.2f s"),
+		columnCount, Grid.Num(), Grid.GetCellCount().Z, surfaceTraces.GetValue(), safetyTraces.GetValue(), FPlatformTime::Seconds() - startTime);
 }
 
 void AGridManager::SetGridSize(float x, float y, float z)
@@ -150,45 +415,218 @@ void AGridManager::SetCellRadius(float radius)
 
 void AGridManager::CreateCells()
 {
-	FVector SpawnLocation;
 	FVector StartLocation = GetActorLocation() - CollisionBox->GetScaledBoxExtent();
 
-	for (int i = 0; i < CellCount.X; i++)
+	DiscardCells();
+	if (StreamChunks && MaxCellLayers > 1) UE_LOG(LogTemp, Warning, TEXT("%s streams its grid in chunks, which only hold the top surface of each column"), *GetName());
+	Grid.Init(CellCount, StartLocation, CellRadius, BaseMoveCost, StreamChunks ? ChunkSize : 0);
+	ResetChunkStreaming();
+}
+
+void AGridManager::DiscardCells()
+{
+	//Pending requests refer to cells of the old grid
+	PathRequests.CancelAll();
+	PathRequestCallbacks.Empty();
+	PrepareGridChange();
+	CellViews.Empty();
+	SlopeCutCells.Empty();
+	DropObstacleStamps();
+	OnGridRebuilt();
+}
+
+bool AGridManager::LoadBakedGrid()
+{
+	if (!BakedGrid) return false;
+
+	const FNavGrid& bakedGrid = BakedGrid->Grid;
+	FVector startLocation = GetActorLocation() - CollisionBox->GetScaledBoxExtent();
+	bool chunksMatch = StreamChunks ? bakedGrid.IsChunked() && bakedGrid.GetChunkSize() == (int32)FMath::RoundUpToPowerOfTwo(FMath::Max(ChunkSize, 2)) : !bakedGrid.IsChunked();
+	if (bakedGrid.Num() == 0 || !chunksMatch || bakedGrid.GetCellCount().X != CellCount.X || bakedGrid.GetCellCount().Y != CellCount.Y
+		|| !bakedGrid.GetOrigin().Equals(startLocation) || bakedGrid.GetCellSize() != CellRadius || bakedGrid.GetBaseMoveCost() != BaseMoveCost
+		|| BakedGrid->SafetyRadius != SafetyRadius || BakedGrid->LineTraceHeight != LinceTraceHeight
+		|| BakedGrid->MaxTraversableSlope != MaxTraversableSlope || BakedGrid->CanMoveOnDiagonals != CanMoveOnDiagonals
+		|| BakedGrid->MaxCellLayers != MaxCellLayers || BakedGrid->MinLayerClearance != MinLayerClearance)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s does not match the settings of %s, building the grid from the level. Bake it again to load it."), *BakedGrid->GetName(), *GetName());
+		return false;
+	}
+
+	double startTime = FPlatformTime::Seconds();
+	DiscardCells();
+	//A streamed grid only takes the layout here, its chunks are read from the asset as they are needed
+	Grid = bakedGrid;
+	ResetChunkStreaming();
+	//The links come baked, the cells they miss because of the slope are found again from them
+	for (int32 index = 0; index < Grid.Num(); index++)
+	{
+		if (HasSlopeCutLinks(index)) SlopeCutCells.Add(index);
+	}
+	RestampObstacles();
+	UE_LOG(LogTemp, Log, TEXT("Baked grid %s loaded in %.2f ms"), *BakedGrid->GetName(), (FPlatformTime::Seconds() - startTime) * 1000.0);
+	return true;
+}
+
+#if WITH_EDITOR
+void AGridManager::BakeGrid()
+{
+	if (!BakedGrid)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s has no BakedGrid asset to bake into"), *GetName());
+		return;
+	}
+
+	CalculateSizes();
+	CreateCells();
+	BakedGrid->ChunkData.Empty();
+	SIZE_T bakedBytes = 0;
+	if (Grid.IsChunked())
 	{
-		for (int j = 0; j < CellCount.Y; j++)
+		//Chunks are built and compressed one at a time, the bake never holds more than one of them
+		int32 chunkCount = Grid.GetChunkCount().X * Grid.GetChunkCount().Y;
+		BakedGrid->ChunkData.SetNum(chunkCount);
+		FScopedSlowTask slowTask(chunkCount, FText::FromString(TEXT("Baking grid chunks")));
+		FIntPoint min, max;
+		for (int32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
 		{
-			SpawnLocation = StartLocation + FVector(CellRadius * i, CellRadius * j, StartLocation.Z);
-			UCell* SpawnedCell = NewObject<UCell>();
-			SpawnedCell->Coordinates = FIntVector(i, j, 0);
-			SpawnedCell->Index = GridCells.Num();
-			SpawnedCell->Location = SpawnLocation;
-			GridCells.Add(SpawnedCell);
+			slowTask.EnterProgressFrame();
+			Grid.LoadChunk(chunkIndex);
+			Grid.GetChunkBounds(chunkIndex, min, max);
+			TraceCellHeights(min, max, false);
+			if (CheckChunkBlocks) TraceCellBlocks(min, max, false);
+			//The links into the other chunks are made when the chunks meet at runtime
+			UpdateNeighborMasks(min, max);
+
+			FArchiveSaveCompressedProxy compressor(BakedGrid->ChunkData[chunkIndex], NAME_Zlib);
+			Grid.SerializeChunk(chunkIndex, compressor);
+			compressor.Flush();
+			Grid.UnloadChunk(chunkIndex);
+			bakedBytes += BakedGrid->ChunkData[chunkIndex].Num();
 		}
 	}
+	else
+	{
+		CalculateCellsHeights();
+		SetAllCellNeighbors();
+		bakedBytes = Grid.GetAllocatedSize();
+	}
+
+	BakedGrid->Grid = Grid;
+	BakedGrid->SafetyRadius = SafetyRadius;
+	BakedGrid->LineTraceHeight = LinceTraceHeight;
+	BakedGrid->MaxTraversableSlope = MaxTraversableSlope;
+	BakedGrid->CanMoveOnDiagonals = CanMoveOnDiagonals;
+	BakedGrid->MaxCellLayers = MaxCellLayers;
+	BakedGrid->MinLayerClearance = MinLayerClearance;
+	BakedGrid->CellCount = Grid.Num();
+	BakedGrid->MarkPackageDirty();
+	UE_LOG(LogTemp, Log, TEXT("Grid baked into %s: %d cells, %.1f KB. Save the asset to keep it."), *BakedGrid->GetName(), Grid.Num(), bakedBytes / 1024.0f);
 }
+#endif
 
 void AGridManager::CheckCellBlocks()
 {
-	for (auto& cell : GridCells)
+	if (!CollisionChecker) return;
+
+	PrepareGridChange();
+	OnGridRebuilt();
+	TraceCellBlocks(FIntPoint(0, 0), FIntPoint(Grid.GetCellCount().X - 1, Grid.GetCellCount().Y - 1), true);
+}
+
+void AGridManager::TraceCellBlocks(const FIntPoint& min, const FIntPoint& max, bool logProgress)
+{
+	if (!CollisionChecker) return;
+
+	double startTime = FPlatformTime::Seconds();
+	auto world = GetWorld();
+	//Cells are tested with the sphere of the checker at the point it used to be moved to
+	float radius = CollisionChecker->GetScaledSphereRadius();
+	FCollisionShape sphere = FCollisionShape::MakeSphere(radius);
+	FVector testOffset(0.0f, 0.0f, CellRadius * 0.5f);
+	FCollisionObjectQueryParams objectParams(ECC_WorldStatic);
+	FCollisionQueryParams params(SCENE_QUERY_STAT(CheckCellBlocks), false, this);
+	const FVector& origin = Grid.GetOrigin();
+	float cellSize = Grid.GetCellSize();
+
+	//Like the traces of CalculateCellsHeights, the queries run on the worker threads and the results are only written to the grid at the end
+	int32 width = max.Y - min.Y + 1;
+	int32 layers = Grid.GetCellCount().Z;
+	auto getSlot = [&](int32 x, int32 y, int32 layer) { return ((x - min.X) * width + y - min.Y) * layers + layer; };
+	TArray<bool> blockedCells;
+	blockedCells.Init(false, (max.X - min.X + 1) * width * layers);
+	FThreadSafeCounter tileQueries;
+	FThreadSafeCounter cellTests;
+
+	ProcessTiles(logProgress ? TEXT("Checking cell blocks") : nullptr, min, max, [&](const FIntPoint& tileMin, const FIntPoint& tileMax)
 	{
-		if (CollisionChecker)
+		int32 index;
+		FBox tileBounds(ForceInit);
+		for (int32 x = tileMin.X; x <= tileMax.X; x++)
+		{
+			for (int32 y = tileMin.Y; y <= tileMax.Y; y++)
+			{
+				for (int32 layer = 0; Grid.GetIndex(x, y, layer, index); layer++) tileBounds += Grid.GetLocation(index) + testOffset;
+			}
+		}
+		tileBounds = tileBounds.ExpandBy(radius);
+
+		//One query finds the static obstacles around the tile, each is then only tested against the cells inside its bounds
+		TArray<FOverlapResult> overlaps;
+		world->OverlapMultiByObjectType(overlaps, tileBounds.GetCenter(), FQuat::Identity, objectParams, FCollisionShape::MakeBox(tileBounds.GetExtent()), params);
+		tileQueries.Increment();
+
+		//The checker only saw the components that generate overlap events in its overlap list, so only those can block
+		TArray<UPrimitiveComponent*, TInlineAllocator<16>> components;
+		for (const FOverlapResult& overlap : overlaps)
 		{
-			FVector location = cell->Location + FVector(0.0f, 0.0f, CellRadius * 0.5f);
-			CollisionChecker->SetWorldLocation(location);
-			TArray<UPrimitiveComponent*> overlappingComponents;
-			CollisionChecker->GetOverlappingComponents(overlappingComponents);
+			UPrimitiveComponent* component = overlap.GetComponent();
+			if (component && component->GetGenerateOverlapEvents() && component->GetCollisionResponseToChannel(ECC_Pawn) == ECR_Block) components.AddUnique(component);
+		}
 
-			for (auto& component : overlappingComponents)
+		for (UPrimitiveComponent* component : components)
+		{
+			FBox bounds = component->Bounds.GetBox().ExpandBy(radius);
+			int32 minX = FMath::Max(FMath::CeilToInt((bounds.Min.X - origin.X) / cellSize), tileMin.X);
+			int32 maxX = FMath::Min(FMath::FloorToInt((bounds.Max.X - origin.X) / cellSize), tileMax.X);
+			int32 minY = FMath::Max(FMath::CeilToInt((bounds.Min.Y - origin.Y) / cellSize), tileMin.Y);
+			int32 maxY = FMath::Min(FMath::FloorToInt((bounds.Max.Y - origin.Y) / cellSize), tileMax.Y);
+			for (int32 x = minX; x <= maxX; x++)
 			{
-				if (component->GetCollisionObjectType() == ECC_WorldStatic && component->GetCollisionResponseToChannel(ECC_Pawn) == ECR_Block)
+				for (int32 y = minY; y <= maxY; y++)
 				{
-					cell->State = BLOCKED;
-					cell->SetColorByState();
-					break;
+					for (int32 layer = 0; Grid.GetIndex(x, y, layer, index); layer++)
+					{
+						if (blockedCells[getSlot(x, y, layer)]) continue;
+
+						FVector location = Grid.GetLocation(index) + testOffset;
+						if (!bounds.IsInside(location)) continue;
+
+						cellTests.Increment();
+						if (component->OverlapComponent(location, FQuat::Identity, sphere)) blockedCells[getSlot(x, y, layer)] = true;
+					}
 				}
 			}
 		}
+	});
+
+	int32 blockedCount = 0;
+	int32 index;
+	for (int32 x = min.X; x <= max.X; x++)
+	{
+		for (int32 y = min.Y; y <= max.Y; y++)
+		{
+			for (int32 layer = 0; Grid.GetIndex(x, y, layer, index); layer++)
+			{
+				if (!blockedCells[getSlot(x, y, layer)]) continue;
+
+				Grid.SetState(index, BLOCKED);
+				blockedCount++;
+			}
+		}
 	}
+
+	if (logProgress) UE_LOG(LogTemp, Log, TEXT("Cell blocks checked: %d cells, %d blocked, %d tile queries, %d cell tests in %.2f s"),
+		blockedCells.Num(), blockedCount, tileQueries.GetValue(), cellTests.GetValue(), FPlatformTime::Seconds() - startTime);
 }
 
 void AGridManager::CalculateSizes()
@@ -211,247 +649,1692 @@ void AGridManager::CalculateSizes()
 
 void AGridManager::SetCell(int32 cellIndex, TEnumAsByte<ECellState> state, float moveCost, int32 modifierPriority)
 {
-	GridCells[cellIndex]->SetCellParameters(state, moveCost, modifierPriority);
+	if (!Grid.IsValidIndex(cellIndex)) return;
+
+	PrepareGridChange();
+	if (FGridObstacleCell* obstacleCell = ObstacleCells.Find(cellIndex))
+	{
+		if (modifierPriority < obstacleCell->ModifierPriority) return;
+
+		obstacleCell->State = state;
+		obstacleCell->MoveCost = moveCost;
+		obstacleCell->ModifierPriority = modifierPriority;
+		if (UpdateObstacleCell(cellIndex)) OnCellChanged(cellIndex);
+		return;
+	}
+
+	if (Grid.SetCellParameters(cellIndex, state, moveCost, modifierPriority))
+	{
+		UpdateCellView(cellIndex);
+		OnCellChanged(cellIndex);
+	}
 }
 
-UCell* AGridManager::GetClosestCellFromLocation(const FVector& location) const
+int32 AGridManager::RegisterObstacle(const FGridObstacle& obstacle)
 {
-	FVector relativeLocation = location - GetActorLocation();
+	//Without a grid the obstacle is only kept, it is stamped once the grid is built
+	PrepareGridChange();
+	int32 obstacleHandle = Obstacles.Add(FStampedGridObstacle());
+	Obstacles[obstacleHandle].Obstacle = obstacle;
+	StampObstacle(obstacleHandle);
+	ApplyObstacleChange();
+	return obstacleHandle;
+}
 
-	float percentX = FMath::Clamp(((relativeLocation.X + GridSize.X / 2) / GridSize.X), 0.0f, 1.0f);
-	float percentY = FMath::Clamp(((relativeLocation.Y + GridSize.Y / 2) / GridSize.Y), 0.0f, 1.0f);
+bool AGridManager::UpdateObstacle(int32 obstacleHandle, const FTransform& transform)
+{
+	if (!Obstacles.IsValidIndex(obstacleHandle)) return false;
 
-	int x = FMath::RoundToInt((CellCount.X - 1) * percentX);
-	int y = FMath::RoundToInt((CellCount.Y - 1) * percentY);
+	PrepareGridChange();
+	UnstampObstacle(obstacleHandle);
+	Obstacles[obstacleHandle].Obstacle.Transform = transform;
+	StampObstacle(obstacleHandle);
+	ApplyObstacleChange();
+	return true;
+}
 
+bool AGridManager::UnregisterObstacle(int32 obstacleHandle)
+{
+	if (!Obstacles.IsValidIndex(obstacleHandle)) return false;
 
-	return GetCellFromCoordinates(x, y);
+	PrepareGridChange();
+	UnstampObstacle(obstacleHandle);
+	Obstacles.RemoveAt(obstacleHandle);
+	ApplyObstacleChange();
+	return true;
 }
 
-float AGridManager::GetDistanceBetweenCells(const UCell* cellA, const UCell* cellB, const bool& diagonal, const bool& vertical) const
+void AGridManager::StampObstacle(int32 obstacleHandle)
 {
-	FIntVector distance = cellA->Coordinates - cellB->Coordinates;
-	distance.X = abs(distance.X);
-	distance.Y = abs(distance.Y);
-	distance.Z = abs(distance.Z);
-
-	if (diagonal)
+	FStampedGridObstacle& stamped = Obstacles[obstacleHandle];
+	if (Grid.Num() == 0) return;
+
+	//Cells are tested at the point CheckCellBlocks tests them at, against the footprint grown by half a cell so the cells it reaches into are covered
+	float margin = Grid.GetCellSize() * 0.5f;
+	FVector testOffset(0.0f, 0.0f, CellRadius * 0.5f);
+	FIntPoint min, max;
+	if (!GetObstacleCellBounds(stamped.Obstacle, min, max)) return;
+
+	//Cells of unloaded chunks are covered once their chunk is loaded
+	int32 index;
+	for (int32 x = min.X; x <= max.X; x++)
 	{
-		int32 bigger, middle, smaller;
-
-		if (distance.X > distance.Y)
-		{
-			if (distance.X > distance.Z)
-			{
-				bigger = distance.X;
-				if (distance.Y > distance.Z)
-				{
-					middle = distance.Y;
-					smaller = distance.Z;
-				}
-				else
-				{
-					middle = distance.Z;
-					smaller = distance.Y;
-				}
-			}
-			else
-			{
-				bigger = distance.Z;
-				middle = distance.X;
-				smaller = distance.Y;
-			}
-		}
-		else
+		for (int32 y = min.Y; y <= max.Y; y++)
 		{
-			if (distance.X < distance.Z)
+			//Every layer of the column is tested, the footprint only covers the floors it reaches
+			for (int32 layer = 0; Grid.GetIndex(x, y, layer, index); layer++)
 			{
-				smaller = distance.X;
-				if (distance.Y > distance.Z)
-				{
-					bigger = distance.Y;
-					middle = distance.Z;
-				}
-				else
+				if (!Grid.IsLoaded(index) || !stamped.Obstacle.Overlaps(Grid.GetLocation(index) + testOffset, margin)) continue;
+
+				FGridObstacleCell* obstacleCell = ObstacleCells.Find(index);
+				if (!obstacleCell)
 				{
-					bigger = distance.Z;
-					middle = distance.Y;
+					obstacleCell = &ObstacleCells.Add(index);
+					obstacleCell->State = Grid.GetState(index);
+					obstacleCell->MoveCost = Grid.GetMoveCost(index);
+					obstacleCell->ModifierPriority = Grid.GetModifierPriority(index);
 				}
-			}
-			else
-			{
-				bigger = distance.Y;
-				middle = distance.X;
-				smaller = distance.Z;
+				obstacleCell->Obstacles.Add(obstacleHandle);
+				stamped.Cells.Add(index);
+				ObstacleTouchedCells.Add(index);
 			}
 		}
-
-		return (smaller * Diagonal3DCostMultiplier) + ((middle - smaller) * DiagonalCostMultiplier) + (bigger - middle);
 	}
-	else
+}
+
+void AGridManager::UnstampObstacle(int32 obstacleHandle)
+{
+	FStampedGridObstacle& stamped = Obstacles[obstacleHandle];
+	for (int32 index : stamped.Cells)
 	{
-		return distance.X + distance.Y + distance.Z;
+		if (FGridObstacleCell* obstacleCell = ObstacleCells.Find(index)) obstacleCell->Obstacles.RemoveSingle(obstacleHandle);
+		ObstacleTouchedCells.Add(index);
 	}
+	stamped.Cells.Reset();
 }
 
-void AGridManager::SetCellNeighbors(UCell* cell)
+bool AGridManager::UpdateObstacleCell(int32 cellIndex)
 {
-	int32 index = 0;
-
-	for (int i = -1; i <= 1; i += 2)
+	FGridObstacleCell* obstacleCell = ObstacleCells.Find(cellIndex);
+	if (!obstacleCell) return false;
+
+	ECellState state = obstacleCell->State;
+	float moveCost = obstacleCell->MoveCost;
+	int32 modifierPriority = obstacleCell->ModifierPriority;
+	//Each obstacle goes on top of the ones stamped before it, as if it had called SetCell
+	for (int32 obstacleHandle : obstacleCell->Obstacles)
 	{
-		if (GetCellIndexFromGridPosition(index, cell->Coordinates.X + i, cell->Coordinates.Y))
-		{
-			if(abs(GridCells[index]->Location.Z - cell->Location.Z) < MaxTraversableSlope) cell->Neighbors.Add(GridCells[index]);
-		}
-		if (GetCellIndexFromGridPosition(index, cell->Coordinates.X, cell->Coordinates.Y + i))
-		{
-			if (abs(GridCells[index]->Location.Z - cell->Location.Z) < MaxTraversableSlope) cell->Neighbors.Add(GridCells[index]);
-		}
-
-		if (CanMoveOnDiagonals)
-		{
-			if (GetCellIndexFromGridPosition(index, cell->Coordinates.X + i, cell->Coordinates.Y + i))
-			{
-				if (abs(GridCells[index]->Location.Z - cell->Location.Z) < MaxTraversableSlope) cell->Neighbors.Add(GridCells[index]);
+		const FGridObstacle& obstacle = Obstacles[obstacleHandle].Obstacle;
+		if (obstacle.ModifierPriority < modifierPriority) continue;
 
-			}
-			if (GetCellIndexFromGridPosition(index, cell->Coordinates.X - i, cell->Coordinates.Y + i))
-			{
-				if (abs(GridCells[index]->Location.Z - cell->Location.Z) < MaxTraversableSlope) cell->Neighbors.Add(GridCells[index]);
-			}
-		}
+		state = obstacle.State;
+		moveCost = obstacle.MoveCost;
+		modifierPriority = obstacle.ModifierPriority;
 	}
+	if (obstacleCell->Obstacles.Num() == 0) ObstacleCells.Remove(cellIndex);
+
+	bool changed = Grid.GetState(cellIndex) != state || Grid.GetMoveCost(cellIndex) != moveCost;
+	if (!changed && Grid.GetModifierPriority(cellIndex) == modifierPriority) return false;
+
+	Grid.ResetCellParameters(cellIndex, state, moveCost, modifierPriority);
+	UpdateCellView(cellIndex);
+	return changed;
 }
 
-void AGridManager::SetAllCellNeighbors()
+void AGridManager::ApplyObstacleChange()
 {
-	for (auto& cell : GridCells)
+	//A cell both uncovered and covered again is touched twice, it can only change the first time
+	FGridDirtyRegion region;
+	for (int32 index : ObstacleTouchedCells)
 	{
-		SetCellNeighbors(cell);
+		if (UpdateObstacleCell(index)) region.Add(index, Grid.GetCoordinates(index));
 	}
+	ObstacleTouchedCells.Reset();
+
+	if (!region.IsEmpty()) OnRegionChanged(region);
 }
 
-bool AGridManager::FindPathByCell(FPath& outPath, UCell* startCell, UCell* targetCell)
+void AGridManager::RestampObstacles()
 {
-	TSet<UCell*> openSet;
-	TSet<UCell*> closedSet;
-	TSet<UCell*> searchedCells;
+	//Everything is taken off first so the cells get the obstacles back in handle order
+	PrepareGridChange();
+	for (auto it = Obstacles.CreateIterator(); it; ++it) UnstampObstacle(it.GetIndex());
+	for (auto it = Obstacles.CreateIterator(); it; ++it) StampObstacle(it.GetIndex());
+	ApplyObstacleChange();
+}
 
-	openSet.Add(startCell);
+void AGridManager::DropObstacleStamps()
+{
+	//The cells keep what the obstacles made them until the grid is replaced
+	for (auto& stamped : Obstacles) stamped.Cells.Reset();
+	ObstacleCells.Empty();
+	ObstacleTouchedCells.Reset();
+}
 
-	while (openSet.Num() > 0)
+void AGridManager::DropObstacleStamps(int32 chunkIndex)
+{
+	for (auto& stamped : Obstacles)
+	{
+		stamped.Cells.RemoveAll([&](int32 index) { return Grid.GetChunkIndex(index) == chunkIndex; });
+	}
+	for (auto it = ObstacleCells.CreateIterator(); it; ++it)
 	{
-		UCell* currentCell = NewObject<UCell>();
-		for (const auto& cell : openSet) { currentCell = cell; break; }
+		if (Grid.GetChunkIndex(it.Key()) == chunkIndex) it.RemoveCurrent();
+	}
+}
 
-		for (const auto& cell : openSet)
-		{
-			if (cell->FCost() < currentCell->FCost() || (cell->FCost() == currentCell->FCost() && cell->HCost < currentCell->HCost))
-			{
-				currentCell = cell;
-			}
-		}
+bool AGridManager::GetObstacleCellBounds(const FGridObstacle& obstacle, FIntPoint& outMin, FIntPoint& outMax) const
+{
+	float cellSize = Grid.GetCellSize();
+	FBox bounds = obstacle.GetBounds(cellSize * 0.5f);
+	const FVector& origin = Grid.GetOrigin();
+	const FIntVector& cellCount = Grid.GetCellCount();
+	outMin = FIntPoint(FMath::Max(FMath::CeilToInt((bounds.Min.X - origin.X) / cellSize), 0), FMath::Max(FMath::CeilToInt((bounds.Min.Y - origin.Y) / cellSize), 0));
+	outMax = FIntPoint(FMath::Min(FMath::FloorToInt((bounds.Max.X - origin.X) / cellSize), cellCount.X - 1), FMath::Min(FMath::FloorToInt((bounds.Max.Y - origin.Y) / cellSize), cellCount.Y - 1));
+	return outMin.X <= outMax.X && outMin.Y <= outMax.Y;
+}
 
-		openSet.Remove(currentCell);
-		closedSet.Add(currentCell);
+void AGridManager::ResetChunkStreaming()
+{
+	LoadedChunks.Reset();
+	ChunkLastUsedFrames.Init(0, Grid.IsChunked() ? Grid.GetChunkCount().X * Grid.GetChunkCount().Y : 0);
+	//The chunks held requests waited for are gone with the old grid
+	for (const auto& pair : PathRequestChunks) PathRequests.Release(pair.Key);
+	PathRequestChunks.Reset();
+	RequestedChunks.Reset();
+}
 
-		if (currentCell == targetCell)
-		{
-			while (currentCell != startCell)
-			{
-				outPath.CellsInPath.Add(currentCell);
-				outPath.CellCosts.Add(currentCell->GCost);
-				currentCell = GridCells[currentCell->ParentIndex];
-			}
+void AGridManager::UpdateChunkStreaming(int32 maxLoads)
+{
+	if (!Grid.IsChunked()) return;
+
+	//Chunks path requests wait for come first, without them the requests can't go on
+	TArray<int32> requestChunks;
+	for (int32 chunkIndex : RequestedChunks) requestChunks.AddUnique(chunkIndex);
+	for (const auto& pair : PathRequestChunks)
+	{
+		for (int32 chunkIndex : pair.Value.Missing) requestChunks.AddUnique(chunkIndex);
+	}
+	int32 loads = 0;
+	for (int32 chunkIndex : requestChunks)
+	{
+		ChunkLastUsedFrames[chunkIndex] = GFrameCounter;
+		if (loads >= maxLoads || Grid.IsChunkLoaded(chunkIndex)) continue;
+
+		LoadChunk(chunkIndex);
+		loads++;
+	}
+
+	//Chunks whose box is in reach of a pawn, nearest first
+	const FIntPoint& chunkCount = Grid.GetChunkCount();
+	int32 chunkSize = Grid.GetChunkSize();
+	float cellSize = Grid.GetCellSize();
+	const FVector& origin = Grid.GetOrigin();
+	int32 chunkRadius = FMath::CeilToInt(ChunkLoadRadius / (chunkSize * cellSize));
+	TArray<TPair<float, int32>> missingChunks;
+	FIntPoint min, max;
+	for (TActorIterator<APawn> it(GetWorld()); it; ++it)
+	{
+		FVector location = it->GetActorLocation();
+		int32 cellIndex = GetClosestCellIndexFromLocation(location);
+		if (cellIndex == INDEX_NONE) continue;
+
+		FIntVector coordinates = Grid.GetCoordinates(cellIndex);
+		int32 pawnChunkX = coordinates.X / chunkSize;
+		int32 pawnChunkY = coordinates.Y / chunkSize;
+		for (int32 x = FMath::Max(pawnChunkX - chunkRadius, 0); x <= FMath::Min(pawnChunkX + chunkRadius, chunkCount.X - 1); x++)
+		{
+			for (int32 y = FMath::Max(pawnChunkY - chunkRadius, 0); y <= FMath::Min(pawnChunkY + chunkRadius, chunkCount.Y - 1); y++)
+			{
+				int32 chunkIndex = x * chunkCount.Y + y;
+				Grid.GetChunkBounds(chunkIndex, min, max);
+				float dx = FMath::Max3(origin.X + min.X * cellSize - location.X, location.X - origin.X - max.X * cellSize, 0.0f);
+				float dy = FMath::Max3(origin.Y + min.Y * cellSize - location.Y, location.Y - origin.Y - max.Y * cellSize, 0.0f);
+				float distanceSquared = dx * dx + dy * dy;
+				if (distanceSquared > ChunkLoadRadius * ChunkLoadRadius) continue;
+
+				ChunkLastUsedFrames[chunkIndex] = GFrameCounter;
+				if (!Grid.IsChunkLoaded(chunkIndex)) missingChunks.Add(TPair<float, int32>(distanceSquared, chunkIndex));
+			}
+		}
+	}
+
+	missingChunks.Sort([](const TPair<float, int32>& a, const TPair<float, int32>& b) { return a.Key < b.Key; });
+	for (const auto& missingChunk : missingChunks)
+	{
+		if (loads >= maxLoads) break;
+		//A chunk near several pawns is in the list once for each
+		if (Grid.IsChunkLoaded(missingChunk.Value)) continue;
+
+		LoadChunk(missingChunk.Value);
+		loads++;
+	}
+
+	SIZE_T budget = (SIZE_T)FMath::Max(ChunkMemoryBudgetKB, 0) * 1024;
+	SIZE_T usedBytes = 0;
+	for (int32 chunkIndex : LoadedChunks) usedBytes += Grid.GetChunkAllocatedSize(chunkIndex);
+	while (usedBytes > budget)
+	{
+		int32 oldestChunk = INDEX_NONE;
+		uint64 oldestFrame = GFrameCounter;
+		for (int32 chunkIndex : LoadedChunks)
+		{
+			if (ChunkLastUsedFrames[chunkIndex] < oldestFrame)
+			{
+				oldestChunk = chunkIndex;
+				oldestFrame = ChunkLastUsedFrames[chunkIndex];
+			}
+		}
+		//Everything left is needed this frame
+		if (oldestChunk == INDEX_NONE) break;
+
+		usedBytes -= Grid.GetChunkAllocatedSize(oldestChunk);
+		UnloadChunk(oldestChunk);
+	}
+
+	RequestedChunks.RemoveAll([this](int32 chunkIndex) { return Grid.IsChunkLoaded(chunkIndex); });
+	for (auto it = PathRequestChunks.CreateIterator(); it; ++it)
+	{
+		if (!PathRequests.IsPending(it.Key()))
+		{
+			it.RemoveCurrent();
+			continue;
+		}
+
+		TArray<int32>& missing = it.Value().Missing;
+		if (missing.Num() == 0) continue;
+
+		missing.RemoveAll([this](int32 chunkIndex) { return Grid.IsChunkLoaded(chunkIndex); });
+		if (missing.Num() == 0) PathRequests.Release(it.Key());
+	}
+}
+
+void AGridManager::LoadChunk(int32 chunkIndex)
+{
+	if (Grid.IsChunkLoaded(chunkIndex)) return;
+
+	PrepareGridChange();
+	double startTime = FPlatformTime::Seconds();
+	FIntPoint min, max;
+	Grid.GetChunkBounds(chunkIndex, min, max);
+	bool baked = false;
+	if (BakedGrid && BakedGrid->Grid.IsChunked() && BakedGrid->ChunkData.IsValidIndex(chunkIndex) && BakedGrid->ChunkData[chunkIndex].Num() > 0)
+	{
+		FArchiveLoadCompressedProxy decompressor(BakedGrid->ChunkData[chunkIndex], NAME_Zlib);
+		baked = Grid.SerializeChunk(chunkIndex, decompressor);
+	}
+	if (!baked)
+	{
+		Grid.LoadChunk(chunkIndex);
+		TraceCellHeights(min, max, false);
+		if (CheckChunkBlocks) TraceCellBlocks(min, max, false);
+	}
+	//The links across the chunk's edges need the heights on both sides
+	UpdateNeighborMasks(min - FIntPoint(1, 1), max + FIntPoint(1, 1));
+	LoadedChunks.Add(chunkIndex);
+	ChunkLastUsedFrames[chunkIndex] = GFrameCounter;
+	OnChunkChanged(chunkIndex);
+
+	//The obstacles reaching into the chunk cover its cells again
+	FIntPoint obstacleMin, obstacleMax;
+	for (auto it = Obstacles.CreateIterator(); it; ++it)
+	{
+		if (!GetObstacleCellBounds(it->Obstacle, obstacleMin, obstacleMax)) continue;
+		if (obstacleMax.X < min.X || obstacleMin.X > max.X || obstacleMax.Y < min.Y || obstacleMin.Y > max.Y) continue;
+
+		UnstampObstacle(it.GetIndex());
+		StampObstacle(it.GetIndex());
+	}
+	ApplyObstacleChange();
+
+	UE_LOG(LogTemp, Verbose, TEXT("Grid chunk %d %s in %.2f ms, %d chunks loaded"), chunkIndex, baked ? TEXT("read") : TEXT("built"),
+		(FPlatformTime::Seconds() - startTime) * 1000.0, LoadedChunks.Num());
+}
+
+void AGridManager::UnloadChunk(int32 chunkIndex)
+{
+	if (!Grid.IsChunkLoaded(chunkIndex)) return;
+
+	PrepareGridChange();
+	//Cell changes made with SetCell are lost with the chunk, it is built or read again as it was
+	DropObstacleStamps(chunkIndex);
+	Grid.UnloadChunk(chunkIndex);
+	LoadedChunks.RemoveSwap(chunkIndex);
+	FIntPoint min, max;
+	Grid.GetChunkBounds(chunkIndex, min, max);
+	UpdateNeighborMasks(min - FIntPoint(1, 1), max + FIntPoint(1, 1));
+	OnChunkChanged(chunkIndex);
+}
+
+void AGridManager::GetUnloadedChunksBetween(int32 startIndex, int32 targetIndex, TArray<int32>& outChunks)
+{
+	if (!Grid.IsChunked() || !Grid.IsValidIndex(startIndex) || !Grid.IsValidIndex(targetIndex)) return;
+
+	//Samples half a chunk apart can't jump over a chunk
+	FIntVector start = Grid.GetCoordinates(startIndex);
+	FIntVector target = Grid.GetCoordinates(targetIndex);
+	int32 distance = FMath::Max(FMath::Abs(target.X - start.X), FMath::Abs(target.Y - start.Y));
+	int32 samples = distance * 2 / Grid.GetChunkSize() + 1;
+	int32 index;
+	for (int32 sample = 0; sample <= samples; sample++)
+	{
+		float alpha = (float)sample / samples;
+		if (!Grid.GetIndex(FMath::RoundToInt(FMath::Lerp((float)start.X, (float)target.X, alpha)), FMath::RoundToInt(FMath::Lerp((float)start.Y, (float)target.Y, alpha)), index)) continue;
+
+		int32 chunkIndex = Grid.GetChunkIndex(index);
+		ChunkLastUsedFrames[chunkIndex] = GFrameCounter;
+		if (!Grid.IsChunkLoaded(chunkIndex)) outChunks.AddUnique(chunkIndex);
+	}
+}
+
+void AGridManager::FindMissingChunks(FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outChunks) const
+{
+	outChunks.Reset();
+	if (!Grid.IsChunked() || !Grid.IsValidIndex(startIndex) || !Grid.IsLoaded(startIndex) || !Grid.IsValidIndex(targetIndex)) return;
+	//No chunk makes a blocked target reachable
+	if (Grid.IsLoaded(targetIndex) && Grid.GetState(targetIndex) == ECellState::BLOCKED) return;
+
+	//Flood the cells the start reaches, the search went through the same ones
+	TArray<int32> openCells;
+	context.BeginQuery(Grid.Num());
+	context.Visit(startIndex, 0.0f, 0.0f, INDEX_NONE);
+	openCells.Add(startIndex);
+	int32 neighborIndex;
+	while (openCells.Num() > 0)
+	{
+		int32 index = openCells.Pop(false);
+		FIntVector coordinates = Grid.GetCoordinates(index);
+		for (int32 direction = 0; direction < NEIGHBOR_DIRECTIONS; direction++)
+		{
+			const FIntPoint& offset = FNavGrid::GetDirectionOffset(direction);
+			if (Grid.GetIndex(coordinates.X + offset.X, coordinates.Y + offset.Y, neighborIndex) && !Grid.IsLoaded(neighborIndex)) outChunks.AddUnique(Grid.GetChunkIndex(neighborIndex));
+		}
+		for (int32 neighbor : Grid.GetNeighbors(index))
+		{
+			if (context.IsVisited(neighbor) || Grid.GetState(neighbor) == ECellState::BLOCKED) continue;
+
+			context.Visit(neighbor, 0.0f, 0.0f, index);
+			openCells.Add(neighbor);
+		}
+	}
+
+	FIntVector target = Grid.GetCoordinates(targetIndex);
+	auto getDistanceSquared = [this, &target](int32 chunkIndex)
+	{
+		FIntPoint min, max;
+		Grid.GetChunkBounds(chunkIndex, min, max);
+		return FMath::Square((min.X + max.X) / 2 - target.X) + FMath::Square((min.Y + max.Y) / 2 - target.Y);
+	};
+	outChunks.Sort([&getDistanceSquared](int32 a, int32 b) { return getDistanceSquared(a) < getDistanceSquared(b); });
+}
+
+bool AGridManager::AddPathRequestChunks(int32 requestHandle, const TArray<int32>& chunks)
+{
+	FPathRequestChunks& requestChunks = PathRequestChunks.FindOrAdd(requestHandle);
+	if (requestChunks.Loads >= MaxPathChunkLoads) return false;
+
+	for (int32 chunkIndex : chunks) requestChunks.Missing.AddUnique(chunkIndex);
+	requestChunks.Loads += chunks.Num();
+	return true;
+}
+
+void AGridManager::RequestMissingChunks(int32 startIndex, int32 targetIndex)
+{
+	if (!Grid.IsChunked()) return;
+
+	TArray<int32> missingChunks;
+	FindMissingChunks(FPathSearchContext::GetThreadContext(), startIndex, targetIndex, missingChunks);
+	for (int32 i = 0; i < FMath::Min(missingChunks.Num(), MaxChunkLoadsPerTick); i++) RequestedChunks.AddUnique(missingChunks[i]);
+}
+
+void AGridManager::UpdateNeighborMasks(const FIntPoint& min, const FIntPoint& max)
+{
+	int32 index;
+	for (int32 x = FMath::Max(min.X, 0); x <= FMath::Min(max.X, Grid.GetCellCount().X - 1); x++)
+	{
+		for (int32 y = FMath::Max(min.Y, 0); y <= FMath::Min(max.Y, Grid.GetCellCount().Y - 1); y++)
+		{
+			for (int32 layer = 0; Grid.GetIndex(x, y, layer, index); layer++) UpdateNeighborMask(index);
+		}
+	}
+}
+
+void AGridManager::OnChunkChanged(int32 chunkIndex)
+{
+	FIntPoint min, max;
+	Grid.GetChunkBounds(chunkIndex, min, max);
+	FGridDirtyRegion region;
+	int32 index;
+	for (int32 x = min.X - 1; x <= max.X + 1; x++)
+	{
+		for (int32 y = min.Y - 1; y <= max.Y + 1; y++)
+		{
+			if (!Grid.GetIndex(x, y, index)) continue;
+
+			UpdateCellView(index);
+			region.Add(index, FIntVector(x, y, 0));
+		}
+	}
+	OnRegionChanged(region);
+}
+
+UCell* AGridManager::GetClosestCellFromLocation(const FVector& location)
+{
+	return GetCell(GetClosestCellIndexFromLocation(location));
+}
+
+UCell* AGridManager::GetClosestWalkableCellFromLocation(const FVector& location)
+{
+	return GetCell(GetClosestWalkableCellIndex(location));
+}
+
+int32 AGridManager::GetClosestWalkableCellIndex(const FVector& location)
+{
+	UpdateNearestCells();
+	int32 index = GetClosestCellIndexFromLocation(location);
+	//Cells of unloaded chunks are kept so the path loads them instead of stopping short of them
+	if (!NearestCells.IsBuilt() || index == INDEX_NONE || !Grid.IsLoaded(index)) return index;
+
+	int32 nearestIndex = NearestCells.GetNearestCell(index);
+	return nearestIndex != INDEX_NONE ? nearestIndex : index;
+}
+
+void AGridManager::GetClosestWalkableCellIndices(TArrayView<const FVector> locations, TArray<int32>& outIndices)
+{
+	UpdateNearestCells();
+	outIndices.SetNumUninitialized(locations.Num());
+	for (int32 i = 0; i < locations.Num(); i++)
+	{
+		int32 index = GetClosestCellIndexFromLocation(locations[i]);
+		int32 nearestIndex = NearestCells.IsBuilt() && index != INDEX_NONE && Grid.IsLoaded(index) ? NearestCells.GetNearestCell(index) : INDEX_NONE;
+		outIndices[i] = nearestIndex != INDEX_NONE ? nearestIndex : index;
+	}
+}
+
+void AGridManager::UpdateNearestCells()
+{
+	if (WalkableSnapRadius <= 0 || Grid.Num() == 0)
+	{
+		NearestCells.Empty();
+		return;
+	}
+
+	if (NearestCells.Num() != Grid.Num() || NearestCells.GetRadius() != WalkableSnapRadius)
+	{
+		double startTime = FPlatformTime::Seconds();
+		NearestCells.Build(Grid, WalkableSnapRadius);
+		UE_LOG(LogTemp, Log, TEXT("Nearest walkable cells indexed: %d cells, %.1f KB in %.2f ms"),
+			NearestCells.Num(), NearestCells.GetAllocatedSize() / 1024.0f, (FPlatformTime::Seconds() - startTime) * 1000.0);
+	}
+	else if (NearestCells.HasDirtyCells())
+	{
+		NearestCells.RebuildDirtyCells(Grid);
+	}
+}
+
+int32 AGridManager::GetClosestCellIndexFromLocation(const FVector& location) const
+{
+	FVector relativeLocation = location - GetActorLocation();
+
+	float percentX = FMath::Clamp(((relativeLocation.X + GridSize.X / 2) / GridSize.X), 0.0f, 1.0f);
+	float percentY = FMath::Clamp(((relativeLocation.Y + GridSize.Y / 2) / GridSize.Y), 0.0f, 1.0f);
+
+	int x = FMath::RoundToInt((CellCount.X - 1) * percentX);
+	int y = FMath::RoundToInt((CellCount.Y - 1) * percentY);
+
+	int32 index = INDEX_NONE;
+	if (!Grid.GetIndex(x, y, index) || !Grid.IsLayered()) return index;
+
+	//The highest surface the location stands on, the layers go down from the top one
+	int32 layerCount = Grid.GetLayerCount(index);
+	for (int32 layer = 0; layer < layerCount; layer++)
+	{
+		int32 layerIndex = Grid.GetLayerCell(index, layer);
+		if (Grid.GetHeight(layerIndex) <= location.Z + MaxTraversableSlope) return layerIndex;
+	}
+	return Grid.GetLayerCell(index, layerCount - 1);
+}
+
+float AGridManager::GetDistanceBetweenCells(const UCell* cellA, const UCell* cellB, const bool& diagonal, const bool& vertical) const
+{
+	return GetDistanceBetweenCoordinates(cellA->Coordinates, cellB->Coordinates, diagonal);
+}
+
+float AGridManager::GetDistanceBetweenCoordinates(const FIntVector& coordinatesA, const FIntVector& coordinatesB, bool diagonal) const
+{
+	FIntVector distance = coordinatesA - coordinatesB;
+	distance.X = abs(distance.X);
+	distance.Y = abs(distance.Y);
+	distance.Z = abs(distance.Z);
+
+	if (diagonal)
+	{
+		int32 bigger, middle, smaller;
+
+		if (distance.X > distance.Y)
+		{
+			if (distance.X > distance.Z)
+			{
+				bigger = distance.X;
+				if (distance.Y > distance.Z)
+				{
+					middle = distance.Y;
+					smaller = distance.Z;
+				}
+				else
+				{
+					middle = distance.Z;
+					smaller = distance.Y;
+				}
+			}
+			else
+			{
+				bigger = distance.Z;
+				middle = distance.X;
+				smaller = distance.Y;
+			}
+		}
+		else
+		{
+			if (distance.X < distance.Z)
+			{
+				smaller = distance.X;
+				if (distance.Y > distance.Z)
+				{
+					bigger = distance.Y;
+					middle = distance.Z;
+				}
+				else
+				{
+					bigger = distance.Z;
+					middle = distance.Y;
+				}
+			}
+			else
+			{
+				bigger = distance.Y;
+				middle = distance.X;
+				smaller = distance.Z;
+			}
+		}
+
+		return (smaller * Diagonal3DCostMultiplier) + ((middle - smaller) * DiagonalCostMultiplier) + (bigger - middle);
+	}
+	else
+	{
+		return distance.X + distance.Y + distance.Z;
+	}
+}
+
+uint8 AGridManager::CalculateNeighborMask(int32 cellIndex, uint16& outNeighborLayers) const
+{
+	FIntVector coordinates = Grid.GetCoordinates(cellIndex);
+	float height = Grid.GetHeight(cellIndex);
+	uint8 mask = 0;
+	outNeighborLayers = 0;
+	int32 index;
+	for (int32 direction = 0; direction < NEIGHBOR_DIRECTIONS; direction++)
+	{
+		const FIntPoint& offset = FNavGrid::GetDirectionOffset(direction);
+		if (!CanMoveOnDiagonals && offset.X != 0 && offset.Y != 0) continue;
+
+		//Cells of unloaded chunks get their links once they are loaded
+		if (!GetCellIndexFromGridPosition(index, coordinates.X + offset.X, coordinates.Y + offset.Y) || !Grid.IsLoaded(index)) continue;
+
+		//The surface of the neighbor column closest in height, if it can be stepped to
+		int32 layer = INDEX_NONE;
+		float closestSlope = MaxTraversableSlope;
+		for (int32 candidate = 0; candidate < Grid.GetLayerCount(index); candidate++)
+		{
+			float slope = abs(Grid.GetHeight(Grid.GetLayerCell(index, candidate)) - height);
+			if (slope < closestSlope)
+			{
+				layer = candidate;
+				closestSlope = slope;
+			}
+		}
+		if (layer == INDEX_NONE) continue;
+
+		mask |= 1 << direction;
+		outNeighborLayers |= layer << (direction * 2);
+	}
+	return mask;
+}
+
+void AGridManager::UpdateNeighborMask(int32 cellIndex)
+{
+	uint16 neighborLayers;
+	Grid.SetNeighborMask(cellIndex, CalculateNeighborMask(cellIndex, neighborLayers));
+	Grid.SetNeighborLayers(cellIndex, neighborLayers);
+	if (HasSlopeCutLinks(cellIndex)) SlopeCutCells.Add(cellIndex);
+	else SlopeCutCells.Remove(cellIndex);
+}
+
+bool AGridManager::HasSlopeCutLinks(int32 cellIndex) const
+{
+	if (!Grid.IsLoaded(cellIndex)) return false;
+
+	//Every other link a cell misses leads out of the grid, into an unloaded chunk or along a diagonal it may not take
+	FIntVector coordinates = Grid.GetCoordinates(cellIndex);
+	uint8 mask = Grid.GetNeighborMask(cellIndex);
+	int32 index;
+	for (int32 direction = 0; direction < NEIGHBOR_DIRECTIONS; direction++)
+	{
+		const FIntPoint& offset = FNavGrid::GetDirectionOffset(direction);
+		if (mask & (1 << direction) || (!CanMoveOnDiagonals && offset.X != 0 && offset.Y != 0)) continue;
+		if (GetCellIndexFromGridPosition(index, coordinates.X + offset.X, coordinates.Y + offset.Y) && Grid.IsLoaded(index)) return true;
+	}
+	return false;
+}
+
+void AGridManager::SetCellNeighbors(int32 cellIndex)
+{
+	if (!Grid.IsValidIndex(cellIndex)) return;
+
+	PrepareGridChange();
+	UpdateNeighborMask(cellIndex);
+	OnCellChanged(cellIndex);
+}
+
+void AGridManager::SetAllCellNeighbors()
+{
+	PrepareGridChange();
+	for (int32 index = 0; index < Grid.Num(); index++) UpdateNeighborMask(index);
+	//Every cell changed, dropping the derived data is cheaper than updating it cell by cell
+	OnGridRebuilt();
+	RestampObstacles();
+}
+
+bool AGridManager::FindPathByCell(FPath& outPath, UCell* startCell, UCell* targetCell)
+{
+	if (!startCell || !targetCell)
+	{
+		outPath.Empty();
+		return false;
+	}
+
+	return FindPathByIndex(outPath, startCell->Index, targetCell->Index);
+}
+
+bool AGridManager::FindPathByIndex(FPath& outPath, int32 startIndex, int32 targetIndex)
+{
+	//Only the loaded chunks are searched, the ones the path needs are loaded by the next ticks for the next try
+	GetUnloadedChunksBetween(startIndex, targetIndex, RequestedChunks);
+	UpdateHierarchy();
+	outPath.Empty();
+	uint32 cacheFlags = GetPathCacheFlags();
+	if (!UsePathCache || !PathCache.Find(startIndex, targetIndex, cacheFlags, outPath.Cells, outPath.CellCosts))
+	{
+		if (!FindPathIndices(FPathSearchContext::GetThreadContext(), startIndex, targetIndex, outPath.Cells, outPath.CellCosts))
+		{
+			RequestMissingChunks(startIndex, targetIndex);
+			outPath.Empty();
+			return false;
+		}
+		if (UsePathCache) PathCache.Add(Grid, startIndex, targetIndex, cacheFlags, outPath.Cells, outPath.CellCosts);
+	}
+
+	SmoothPath(startIndex, outPath);
+	return true;
+}
+
+void AGridManager::SmoothPath(int32 startIndex, FPath& path, int32 firstCell) const
+{
+	//The cache keeps every cell, a smoothed path can't be cut short for another start
+	if (SmoothPaths) FPathSmoother::Smooth(Grid, startIndex, path.Cells, path.CellCosts, firstCell);
+}
+
+TArray<UCell*> AGridManager::GetPathCells(const FPath& path)
+{
+	TArray<UCell*> cells;
+	cells.Reserve(path.Num());
+	for (int32 i = path.Cursor; i < path.Cells.Num(); i++) cells.Add(GetCell(path.Cells[i]));
+	return cells;
+}
+
+int32 AGridManager::RequestPathByLocation(const UObject* requester, const FVector& start, const FVector& end, FOnPathRequestComplete onComplete)
+{
+	return RequestPathByIndex(requester, GetClosestWalkableCellIndex(start), GetClosestWalkableCellIndex(end), onComplete);
+}
+
+int32 AGridManager::RequestPathByIndex(const UObject* requester, int32 startIndex, int32 targetIndex, FOnPathRequestComplete onComplete)
+{
+	if (!Grid.IsValidIndex(startIndex) || !Grid.IsValidIndex(targetIndex))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Path request with invalid cells!"));
+		return INDEX_NONE;
+	}
+
+	//A cached path still goes through the queue, the callback runs in the next tick like for any other request
+	UpdateHierarchy();
+	//A request the live one is kept for is not looked up, the cache would count a hit or a miss for nothing
+	bool keepsLiveRequest = PathRequests.HasLiveRequest(requester, targetIndex);
+	int32 handle;
+	if (UsePathCache && !keepsLiveRequest && PathCache.Find(startIndex, targetIndex, GetPathCacheFlags(), CachedRequestPath.Cells, CachedRequestPath.CellCosts))
+	{
+		handle = PathRequests.RequestFound(requester, startIndex, targetIndex, CachedRequestPath.Cells, CachedRequestPath.CellCosts);
+	}
+	else
+	{
+		//The search is held until UpdateChunkStreaming loaded the chunks on the line between the two cells
+		TArray<int32> missingChunks;
+		if (!keepsLiveRequest) GetUnloadedChunksBetween(startIndex, targetIndex, missingChunks);
+		handle = PathRequests.Request(requester, startIndex, targetIndex, missingChunks.Num() > 0);
+		if (missingChunks.Num() > 0) AddPathRequestChunks(handle, missingChunks);
+	}
+	PathRequestCallbacks.Add(handle, onComplete);
+
+	//Drop the callbacks of requests the new one replaced
+	for (auto it = PathRequestCallbacks.CreateIterator(); it; ++it)
+	{
+		if (!PathRequests.IsPending(it.Key()))
+		{
+			PathRequestChunks.Remove(it.Key());
+			it.RemoveCurrent();
+		}
+	}
+
+	return handle;
+}
+
+void AGridManager::CancelPathRequest(int32 requestHandle)
+{
+	PathRequests.Cancel(requestHandle);
+	PathRequestCallbacks.Remove(requestHandle);
+	PathRequestChunks.Remove(requestHandle);
+}
+
+bool AGridManager::IsPathRequestPending(int32 requestHandle) const
+{
+	return PathRequests.IsPending(requestHandle);
+}
+
+void AGridManager::ProcessPathRequests()
+{
+	UpdateHierarchy();
+	PathRequests.SetStepSearches(GetActiveAlgorithm() == A_STAR);
+	PathRequests.Tick(PathRequestMode, PathRequestBudgetMicroseconds, MaxPathWorkerTasks, PathRequestResults);
+
+	FPath& path = PathRequestPath;
+	uint32 cacheFlags = GetPathCacheFlags();
+	for (auto& result : PathRequestResults)
+	{
+		//Hierarchical paths only have their first leg refined yet. A path searched before cells changed may miss a shortcut
+		//they opened, and the cache already dropped the paths that shortcut makes longer when they changed.
+		if (UsePathCache && result.bFound && !result.bFromCache && result.Waypoints.Num() == 0 && PathRequests.IsOnCurrentGrid(result)) PathCache.Add(Grid, result.StartIndex, result.TargetIndex, cacheFlags, result.Cells, result.Costs);
+
+		//A search that ran into unloaded chunks is held again until the nearest of them are loaded
+		if (!result.bFound && result.MissingChunks.Num() > 0 && PathRequestCallbacks.Contains(result.Handle))
+		{
+			result.MissingChunks.SetNum(FMath::Min(result.MissingChunks.Num(), MaxChunkLoadsPerTick));
+			if (AddPathRequestChunks(result.Handle, result.MissingChunks) && PathRequests.Requeue(result)) continue;
+		}
+		PathRequestChunks.Remove(result.Handle);
+
+		FOnPathRequestComplete callback;
+		if (!PathRequestCallbacks.RemoveAndCopyValue(result.Handle, callback)) continue;
+
+		path.Empty();
+		if (result.bFound)
+		{
+			path.Cells.Append(result.Cells);
+			path.CellCosts.Append(result.Costs);
+			path.Waypoints.Append(result.Waypoints);
+			SmoothPath(result.StartIndex, path);
+		}
+		callback.ExecuteIfBound(result.Handle, result.bFound, path);
+	}
+	//Their buffers go to the next requests
+	PathRequests.Recycle(PathRequestResults);
+}
+
+void AGridManager::PrepareGridChange()
+{
+	PathRequests.WaitForWorkers();
+}
+
+void AGridManager::OnCellChanged(int32 cellIndex)
+{
+	FGridDirtyRegion region;
+	region.Add(cellIndex, Grid.GetCoordinates(cellIndex));
+	OnRegionChanged(region);
+}
 
-			Algo::Reverse(outPath.CellsInPath);
-			Algo::Reverse(outPath.CellCosts);
-			for (auto& cell : searchedCells) cell->GCost = 0;
-			return true;
-		}
+void AGridManager::OnRegionChanged(const FGridDirtyRegion& region)
+{
+	for (int32 cellIndex : region.Cells)
+	{
+		Hierarchy.MarkCellChanged(Grid, cellIndex);
+		NearestCells.MarkCellChanged(Grid, cellIndex);
 
-		for (auto& cell : currentCell->GetNeighbors(CanMoveOnDiagonals, CanMoveVertically))
+		for (auto it = FlowFields.CreateIterator(); it; ++it)
 		{
-			if (cell->State == ECellState::BLOCKED || closedSet.Contains(cell)) continue;
+			if (it.Value()->IsAffectedBy(Grid, cellIndex)) it.RemoveCurrent();
+		}
+		NearestGoalFlowFields.RemoveAll([this, cellIndex](const TSharedPtr<FFlowField>& flowField) { return flowField->IsAffectedBy(Grid, cellIndex); });
+
+		for (auto& planner : IncrementalPlanners) planner.Value->OnCellChanged(cellIndex);
+	}
+
+	PathCache.OnCellsChanged(Grid, region.Cells);
+	PathRequests.OnGridChanged();
+	OnGridRegionDirty.Broadcast(region);
+}
+
+void AGridManager::OnGridRebuilt()
+{
+	Hierarchy.Empty();
+	NearestCells.Empty();
+	FlowFields.Empty();
+	NearestGoalFlowFields.Empty();
+	for (auto& planner : IncrementalPlanners) planner.Value->Reset();
+	PathCache.Empty();
+	PathRequests.OnGridChanged();
+}
+
+uint32 AGridManager::GetPathCacheFlags() const
+{
+	return (CanMoveOnDiagonals ? 1 : 0) | (CanMoveVertically ? 2 : 0) | ((uint32)GetActiveAlgorithm() << 2);
+}
 
-			float newGCost = currentCell->GCost + GetDistanceBetweenCells(currentCell, cell) + cell->MoveCost;
-			if (!openSet.Contains(cell) || cell->GCost > newGCost)
+bool AGridManager::ReplanPath(const UObject* requester, const FVector& start, const FVector& end, FPath& outPath)
+{
+	outPath.Empty();
+	int32 startIndex = GetClosestWalkableCellIndex(start);
+	int32 targetIndex = GetClosestWalkableCellIndex(end);
+	if (startIndex == INDEX_NONE || targetIndex == INDEX_NONE) return false;
+
+	//Only the loaded chunks are searched, like with FindPathByIndex
+	GetUnloadedChunksBetween(startIndex, targetIndex, RequestedChunks);
+	TSharedPtr<FIncrementalPathfinder> planner = IncrementalPlanners.FindRef(requester);
+	if (!planner.IsValid())
+	{
+		planner = MakeShared<FIncrementalPathfinder>();
+		IncrementalPlanners.Add(requester, planner);
+
+		//Drop the least recently used planners over the limit
+		while (IncrementalPlanners.Num() > FMath::Max(MaxIncrementalPlanners, 1))
+		{
+			const UObject* oldestRequester = nullptr;
+			uint64 oldestFrame = MAX_uint64;
+			for (const auto& pair : IncrementalPlanners)
 			{
-				cell->GCost = newGCost;
-				cell->HCost = GetDistanceBetweenCells(cell, targetCell);
-				cell->ParentIndex = currentCell->Index;
+				if (pair.Key != requester && pair.Value->LastUsedFrame < oldestFrame)
+				{
+					oldestRequester = pair.Key;
+					oldestFrame = pair.Value->LastUsedFrame;
+				}
+			}
+			IncrementalPlanners.Remove(oldestRequester);
+		}
+	}
+	planner->LastUsedFrame = GFrameCounter;
+
+	//The planner keeps repairing its own search, a cache hit just skips it this time
+	uint32 cacheFlags = GetPathCacheFlags();
+	if (!UsePathCache || !PathCache.Find(startIndex, targetIndex, cacheFlags, outPath.Cells, outPath.CellCosts))
+	{
+		if (!planner->Replan(Grid, startIndex, targetIndex, outPath.Cells, outPath.CellCosts))
+		{
+			RequestMissingChunks(startIndex, targetIndex);
+			outPath.Empty();
+			return false;
+		}
+		if (UsePathCache) PathCache.Add(Grid, startIndex, targetIndex, cacheFlags, outPath.Cells, outPath.CellCosts);
+	}
+
+	SmoothPath(startIndex, outPath);
+	return true;
+}
+
+void AGridManager::ReleaseIncrementalPlanner(const UObject* requester)
+{
+	IncrementalPlanners.Remove(requester);
+}
+
+const FFlowField* AGridManager::GetFlowField(int32 goalIndex)
+{
+	if (!Grid.IsValidIndex(goalIndex)) return nullptr;
+
+	TSharedPtr<FFlowField> flowField = FlowFields.FindRef(goalIndex);
+	if (!flowField.IsValid())
+	{
+		flowField = MakeShared<FFlowField>();
+		flowField->Build(Grid, goalIndex);
+		FlowFields.Add(goalIndex, flowField);
 
-				if (!openSet.Contains(cell))
+		//Drop the least recently used fields over the limit
+		while (FlowFields.Num() > FMath::Max(MaxFlowFields, 1))
+		{
+			int32 oldestGoal = INDEX_NONE;
+			uint64 oldestFrame = MAX_uint64;
+			for (const auto& pair : FlowFields)
+			{
+				if (pair.Key != goalIndex && pair.Value->LastUsedFrame < oldestFrame)
 				{
-					openSet.Add(cell);
-					searchedCells.Add(cell);
+					oldestGoal = pair.Key;
+					oldestFrame = pair.Value->LastUsedFrame;
 				}
 			}
+			FlowFields.Remove(oldestGoal);
 		}
 	}
 
-	return false;
+	flowField->LastUsedFrame = GFrameCounter;
+	return flowField.Get();
 }
 
-bool AGridManager::FindPathByCoordinate(FPath& outPath, const FIntVector& start, const FIntVector& end)
+const FFlowField* AGridManager::GetFlowField(TArrayView<const int32> goalIndices)
+{
+	//The goals as the field keeps them
+	TArray<int32> goals;
+	for (int32 goalIndex : goalIndices)
+	{
+		if (Grid.IsValidIndex(goalIndex)) goals.AddUnique(goalIndex);
+	}
+	if (goals.Num() == 0) return nullptr;
+	goals.Sort();
+
+	TSharedPtr<FFlowField>* found = NearestGoalFlowFields.FindByPredicate([&goals](const TSharedPtr<FFlowField>& flowField) { return flowField->GetGoals() == goals; });
+	TSharedPtr<FFlowField> flowField = found ? *found : nullptr;
+	if (!flowField.IsValid())
+	{
+		flowField = MakeShared<FFlowField>();
+		flowField->Build(Grid, goals);
+		NearestGoalFlowFields.Add(flowField);
+
+		//Drop the least recently used fields over the limit
+		while (NearestGoalFlowFields.Num() > FMath::Max(MaxFlowFields, 1))
+		{
+			int32 oldest = 0;
+			for (int32 i = 1; i < NearestGoalFlowFields.Num() - 1; i++)
+			{
+				if (NearestGoalFlowFields[i]->LastUsedFrame < NearestGoalFlowFields[oldest]->LastUsedFrame) oldest = i;
+			}
+			NearestGoalFlowFields.RemoveAt(oldest);
+		}
+	}
+
+	flowField->LastUsedFrame = GFrameCounter;
+	return flowField.Get();
+}
+
+bool AGridManager::GetFlowFieldStep(const FVector& location, const FVector& destination, FVector& outNextLocation)
+{
+	int32 index = GetClosestWalkableCellIndex(location);
+	const FFlowField* flowField = GetFlowField(GetClosestWalkableCellIndex(destination));
+	if (!flowField || index == INDEX_NONE) return false;
+
+	int32 nextIndex = flowField->GetNextCell(index);
+	if (nextIndex == INDEX_NONE) return false;
+
+	outNextLocation = Grid.GetLocation(nextIndex);
+	return true;
+}
+
+bool AGridManager::GetPathDistance(const FVector& location, const FVector& destination, float& outDistance)
 {
+	int32 index = GetClosestWalkableCellIndex(location);
+	const FFlowField* flowField = GetFlowField(GetClosestWalkableCellIndex(destination));
+	if (!flowField || index == INDEX_NONE || !flowField->IsReachable(index)) return false;
 
-	UCell* startCell = GetCellFromCoordinates(start.X, start.Y);
-	if (!startCell)
+	outDistance = flowField->GetLength(index);
+	return true;
+}
+
+bool AGridManager::FindPathIndices(FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts, TArray<int32>* outWaypoints) const
+{
+	if (outWaypoints) outWaypoints->Reset();
+
+	switch (GetActiveAlgorithm())
+	{
+	case JUMP_POINT_SEARCH:
+		//Jump points are found from cell states only, so a link cut by a steep slope can hide a path. A* gets the last word.
+		if (FJumpPointSearch::FindPath(Grid, context, startIndex, targetIndex, outCells, outCosts)) return true;
+		break;
+	case HIERARCHICAL:
+	{
+		outCells.Reset();
+		outCosts.Reset();
+		TArray<int32> waypoints;
+		//Entrances only cover straight links across cluster borders, paths that only cross them diagonally are left to A*
+		if (Hierarchy.FindPath(Grid, context, startIndex, targetIndex, waypoints)
+			&& RefineWaypoints(context, waypoints, outWaypoints ? 1 : MAX_int32, 0.0f, outCells, outCosts))
+		{
+			if (outWaypoints) *outWaypoints = MoveTemp(waypoints);
+			return true;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	return FGridPathfinder::FindPath(Grid, context, startIndex, targetIndex, outCells, outCosts);
+}
+
+bool AGridManager::CanUseJumpPointSearch() const
+{
+	//Jumps are followed along the rows of the grid, which layered grids don't have.
+	//The pruning takes every walkable neighbor as reachable, a link cut by the slope would be jumped over.
+	return CanMoveOnDiagonals && Grid.HasUniformMoveCost() && !Grid.IsLayered() && SlopeCutCells.Num() == 0;
+}
+
+EPathfindingAlgorithm AGridManager::GetActiveAlgorithm() const
+{
+	if (PathfindingAlgorithm == JUMP_POINT_SEARCH && CanUseJumpPointSearch()) return JUMP_POINT_SEARCH;
+	if (PathfindingAlgorithm == HIERARCHICAL && Hierarchy.IsBuilt()) return HIERARCHICAL;
+	return A_STAR;
+}
+
+void AGridManager::UpdateHierarchy()
+{
+	//Clusters index their cells by coordinates, a layered grid is searched with A* instead
+	if (PathfindingAlgorithm != HIERARCHICAL || Grid.IsLayered()) return;
+
+	if (!Hierarchy.IsBuilt() || Hierarchy.GetClusterSize() != HierarchicalClusterSize)
+	{
+		if (Grid.Num() == 0) return;
+
+		PrepareGridChange();
+		double startTime = FPlatformTime::Seconds();
+		Hierarchy.Build(Grid, HierarchicalClusterSize);
+		UE_LOG(LogTemp, Log, TEXT("Hierarchical graph built: %d clusters, %d entrances, %.1f KB in %.2f ms"),
+			Hierarchy.GetClusterCount(), Hierarchy.GetNodeCount(), Hierarchy.GetAllocatedSize() / 1024.0f, (FPlatformTime::Seconds() - startTime) * 1000.0);
+	}
+	else if (Hierarchy.HasDirtyClusters())
+	{
+		PrepareGridChange();
+		Hierarchy.RebuildDirtyClusters(Grid);
+	}
+}
+
+bool AGridManager::RefineWaypoints(FPathSearchContext& context, TArray<int32>& waypoints, int32 legCount, float baseCost, TArray<int32>& outCells, TArray<float>& outCosts) const
+{
+	int32 legs = 0;
+	while (waypoints.Num() > 1 && legs++ < legCount)
+	{
+		if (!Hierarchy.RefineLeg(Grid, context, waypoints[0], waypoints[1], outCosts.Num() > 0 ? outCosts.Last() : baseCost, outCells, outCosts)) return false;
+		waypoints.RemoveAt(0);
+	}
+
+	//Nothing left to refine once only the target remains
+	if (waypoints.Num() <= 1) waypoints.Empty();
+	return true;
+}
+
+bool AGridManager::RefinePath(FPath& path)
+{
+	if (path.Waypoints.Num() < 2) return false;
+
+	UpdateHierarchy();
+	//The leg is refined straight into the path, where the reached cells were
+	path.Compact();
+	int32 cellCount = path.Cells.Num();
+	int32 legStartIndex = path.Waypoints[0];
+	float baseCost = path.CellCosts.Num() > 0 ? path.CellCosts.Last() : 0.0f;
+	if (!RefineWaypoints(FPathSearchContext::GetThreadContext(), path.Waypoints, 1, baseCost, path.Cells, path.CellCosts))
+	{
+		//The grid changed under the leg, the caller has to ask for a new path
+		path.Cells.SetNum(cellCount, false);
+		path.CellCosts.SetNum(cellCount, false);
+		path.Waypoints.Empty();
+		return false;
+	}
+
+	SmoothPath(legStartIndex, path, cellCount);
+	return true;
+}
+
+bool AGridManager::FindPathByCoordinate(FPath& outPath, const FIntVector& start, const FIntVector& end)
+{
+	int32 startIndex;
+	if (!Grid.GetIndex(start.X, start.Y, start.Z, startIndex))
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Start location not valid!"));
 		return false;
 	}
 
-	UCell* targetCell = GetCellFromCoordinates(end.X, end.Y);
-	if (!targetCell)
+	int32 targetIndex;
+	if (!Grid.GetIndex(end.X, end.Y, end.Z, targetIndex))
 	{
 		UE_LOG(LogTemp, Warning, TEXT("End location not valid!"));
 		return false;
 	}
 
-	return FindPathByCell(outPath, startCell, targetCell);
+	return FindPathByIndex(outPath, startIndex, targetIndex);
 }
 
 bool AGridManager::FindPathByLocation(FPath& outPath, const FVector& start, const FVector& end)
 {
-	UCell* startCell = GetClosestCellFromLocation(start);
-	if (!startCell)
+	int32 startIndex = GetClosestWalkableCellIndex(start);
+	if (startIndex == INDEX_NONE)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Start location not valid!"));
 		return false;
 	}
 
-	UCell* targetCell = GetClosestCellFromLocation(end);
-	if (!targetCell)
+	int32 targetIndex = GetClosestWalkableCellIndex(end);
+	if (targetIndex == INDEX_NONE)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("End location not valid!"));
 		return false;
 	}
-	return FindPathByCell(outPath, startCell, targetCell);
+	return FindPathByIndex(outPath, startIndex, targetIndex);
 }
 
 bool AGridManager::SetCellColor(int32 index, FColor color)
 {
-	if (!GridCells[index])
+	if (!Grid.IsValidIndex(index))
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Red, FString::Printf(TEXT("Invalid index: %f"), index));
+		GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Red, FString::Printf(TEXT("Invalid index: %d"), index));
 		return false;
 	}
 
-	//GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Green, FString::Printf(TEXT("Valid index: %f"), index));
-	GridCells[index]->Color = color;
+	Grid.SetColor(index, color);
+	UpdateCellView(index);
 	return true;
 }
 
 UCell* AGridManager::GetRandomCell()
 {
-	UCell* cell;
-	static FRandomStream random;
-	do { cell = GridCells[random.RandRange(0, GridCells.Num() - 1)]; } while (cell->State != ECellState::FREE);
-	return cell;
+	return GetCell(GetRandomCellIndex());
+}
+
+int32 AGridManager::GetRandomCellIndex()
+{
+	if (Grid.Num() == 0) return INDEX_NONE;
+
+	//Only the loaded chunks of a streamed grid have cells to go to
+	if (Grid.IsChunked() && LoadedChunks.Num() == 0) return INDEX_NONE;
+
+	int32 index;
+	FIntPoint min, max;
+	for (int32 draw = 0; draw < RANDOM_CELL_DRAWS; draw++)
+	{
+		if (!Grid.IsChunked())
+		{
+			index = Random.RandRange(0, Grid.Num() - 1);
+		}
+		else
+		{
+			Grid.GetChunkBounds(LoadedChunks[Random.RandRange(0, LoadedChunks.Num() - 1)], min, max);
+			if (!Grid.GetIndex(Random.RandRange(min.X, max.X), Random.RandRange(min.Y, max.Y), index)) continue;
+		}
+		if (Grid.GetState(index) == ECellState::FREE) return index;
+	}
+
+	//Few free cells, look through all of them from a random one. Unloaded cells are blocked.
+	int32 firstIndex = Random.RandRange(0, Grid.Num() - 1);
+	for (int32 i = 0; i < Grid.Num(); i++)
+	{
+		index = (firstIndex + i) % Grid.Num();
+		if (Grid.GetState(index) == ECellState::FREE) return index;
+	}
+	return INDEX_NONE;
+}
+
+void AGridManager::GenerateBenchmarkCells(int32 gridSize, EBenchmarkGridLayout layout, float obstacleDensity, int32 seed)
+{
+	FRandomStream random(seed);
+	DiscardCells();
+	CellCount = FIntVector(gridSize, gridSize, 1);
+	//Centered on the actor like the level grid, so locations map to cells the same way
+	GridSize = FVector(gridSize * CellRadius, gridSize * CellRadius, CellRadius);
+	Grid.Init(CellCount, GetActorLocation() - FVector(GridSize.X, GridSize.Y, 0.0f) * 0.5f, CellRadius, BaseMoveCost);
+	ResetChunkStreaming();
+	int32 index;
+
+	switch (layout)
+	{
+	case MAZE:
+	{
+		//Recursive backtracker over the odd coordinates, the even rows and columns are the walls between them
+		for (index = 0; index < Grid.Num(); index++) Grid.SetState(index, BLOCKED);
+
+		const FIntPoint steps[] = { FIntPoint(2, 0), FIntPoint(-2, 0), FIntPoint(0, 2), FIntPoint(0, -2) };
+		TArray<FIntPoint> stack;
+		if (Grid.GetIndex(1, 1, index))
+		{
+			Grid.SetState(index, FREE);
+			stack.Add(FIntPoint(1, 1));
+		}
+		while (stack.Num() > 0)
+		{
+			FIntPoint current = stack.Last();
+			TArray<FIntPoint, TInlineAllocator<4>> unvisited;
+			for (const FIntPoint& step : steps)
+			{
+				FIntPoint next = current + step;
+				if (next.X < gridSize - 1 && next.Y < gridSize - 1 && Grid.GetIndex(next.X, next.Y, index) && Grid.GetState(index) == BLOCKED) unvisited.Add(next);
+			}
+			if (unvisited.Num() == 0)
+			{
+				stack.Pop();
+				continue;
+			}
+
+			FIntPoint next = unvisited[random.RandRange(0, unvisited.Num() - 1)];
+			if (Grid.GetIndex((current.X + next.X) / 2, (current.Y + next.Y) / 2, index)) Grid.SetState(index, FREE);
+			if (Grid.GetIndex(next.X, next.Y, index)) Grid.SetState(index, FREE);
+			stack.Add(next);
+		}
+		break;
+	}
+	case ROOMS:
+	{
+		//Square rooms walled on every side with one door per wall, cluttered inside
+		const int32 roomSize = 16;
+		for (index = 0; index < Grid.Num(); index++)
+		{
+			FIntVector coordinates = Grid.GetCoordinates(index);
+			bool isWall = (coordinates.X > 0 && coordinates.X % roomSize == 0) || (coordinates.Y > 0 && coordinates.Y % roomSize == 0);
+			if (isWall || random.FRand() < obstacleDensity) Grid.SetState(index, BLOCKED);
+		}
+
+		auto openDoor = [&](int32 x, int32 y, int32 dx, int32 dy)
+		{
+			for (int32 side = -1; side <= 1; side++)
+			{
+				if (Grid.GetIndex(x + side * dx, y + side * dy, index)) Grid.SetState(index, FREE);
+			}
+		};
+		for (int32 wall = roomSize; wall < gridSize; wall += roomSize)
+		{
+			for (int32 room = 0; room < gridSize; room += roomSize)
+			{
+				int32 door = room + random.RandRange(1, roomSize - 1);
+				openDoor(wall, door, 1, 0);
+				door = room + random.RandRange(1, roomSize - 1);
+				openDoor(door, wall, 0, 1);
+			}
+		}
+		break;
+	}
+	default:
+		for (index = 0; index < Grid.Num(); index++)
+		{
+			if (random.FRand() < obstacleDensity) Grid.SetState(index, BLOCKED);
+		}
+		break;
+	}
+
+	SetAllCellNeighbors();
+}
+
+#if !UE_BUILD_SHIPPING
+TArray<TPair<int32, int32>> AGridManager::PickBenchmarkQueries(int32 queryCount, int32 seed) const
+{
+	FRandomStream random(seed);
+	TArray<TPair<int32, int32>> queries;
+	int32 attempts = 0;
+	while (queries.Num() < queryCount && attempts++ < queryCount * 100)
+	{
+		int32 start = random.RandRange(0, Grid.Num() - 1);
+		int32 end = random.RandRange(0, Grid.Num() - 1);
+		if (Grid.GetState(start) == BLOCKED || Grid.GetState(end) == BLOCKED) continue;
+		queries.Add(TPair<int32, int32>(start, end));
+	}
+	return queries;
+}
+
+void AGridManager::BenchmarkPathfinding(int32 queryCount, int32 seed, int32 generatedGridSize, float obstacleDensity)
+{
+	PrepareGridChange();
+	if (generatedGridSize > 0) GenerateBenchmarkCells(generatedGridSize, RANDOM_OBSTACLES, obstacleDensity, seed);
+
+	if (Grid.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("BenchmarkPathfinding: Grid is empty."));
+		return;
+	}
+
+	//Pick the queries up front so both open lists solve exactly the same problems
+	TArray<TPair<int32, int32>> queries = PickBenchmarkQueries(queryCount, seed);
+	FRandomStream random(seed);
+
+	auto logResults = [&](const TCHAR* name, int64 totalExpanded, int32 pathsFound, double seconds)
+	{
+		seconds = FMath::Max(seconds, 1e-9);
+		UE_LOG(LogTemp, Log, TEXT("BenchmarkPathfinding [%s]: %d queries (%d found) on %dx%d cells, %lld expansions in %.3f ms, %.0f expansions/s"),
+			name, queries.Num(), pathsFound, CellCount.X, CellCount.Y, totalExpanded, seconds * 1000.0, totalExpanded / seconds);
+	};
+
+	auto runQueries = [&](auto& openList, const TCHAR* name)
+	{
+		FPathSearchContext context;
+		TArray<int32> cells;
+		TArray<float> costs;
+		int64 totalExpanded = 0;
+		int32 pathsFound = 0;
+		double startTime = FPlatformTime::Seconds();
+		for (const auto& query : queries)
+		{
+			if (FGridPathfinder::FindPath(Grid, context, openList, query.Key, query.Value, cells, costs)) pathsFound++;
+			totalExpanded += context.ExpandedCells;
+		}
+		logResults(name, totalExpanded, pathsFound, FPlatformTime::Seconds() - startTime);
+	};
+
+	FCellLinearOpenList linearOpenList;
+	FCellHeap heap;
+	runQueries(linearOpenList, TEXT("Linear scan"));
+	runQueries(heap, TEXT("Binary heap"));
+
+	//Same queries spread over the task graph, each worker searching with its own context
+	FThreadSafeCounter64 parallelExpanded;
+	FThreadSafeCounter parallelFound;
+	double parallelStartTime = FPlatformTime::Seconds();
+	ParallelFor(queries.Num(), [&](int32 queryIndex)
+	{
+		FPathSearchContext& context = FPathSearchContext::GetThreadContext();
+		TArray<int32> cells;
+		TArray<float> costs;
+		if (FindPathIndices(context, queries[queryIndex].Key, queries[queryIndex].Value, cells, costs)) parallelFound.Increment();
+		parallelExpanded.Add(context.ExpandedCells);
+	});
+	logResults(TEXT("Binary heap, parallel"), parallelExpanded.GetValue(), parallelFound.GetValue(), FPlatformTime::Seconds() - parallelStartTime);
+
+	if (CanUseJumpPointSearch())
+	{
+		FPathSearchContext context;
+		TArray<int32> cells;
+		TArray<float> costs;
+		int64 totalExpanded = 0;
+		int32 pathsFound = 0;
+		double startTime = FPlatformTime::Seconds();
+		for (const auto& query : queries)
+		{
+			if (FJumpPointSearch::FindPath(Grid, context, query.Key, query.Value, cells, costs)) pathsFound++;
+			totalExpanded += context.ExpandedCells;
+		}
+		logResults(TEXT("Jump point search"), totalExpanded, pathsFound, FPlatformTime::Seconds() - startTime);
+	}
+
+	//Cells to steer through before and after string pulling, and what the pass costs
+	{
+		FPathSearchContext context;
+		TArray<int32> cells;
+		TArray<float> costs;
+		int64 pathCells = 0;
+		int64 waypoints = 0;
+		double smoothingSeconds = 0.0;
+		for (const auto& query : queries)
+		{
+			if (!FGridPathfinder::FindPath(Grid, context, query.Key, query.Value, cells, costs)) continue;
+
+			pathCells += cells.Num();
+			double startTime = FPlatformTime::Seconds();
+			FPathSmoother::Smooth(Grid, query.Key, cells, costs);
+			smoothingSeconds += FPlatformTime::Seconds() - startTime;
+			waypoints += cells.Num();
+		}
+		UE_LOG(LogTemp, Log, TEXT("BenchmarkPathfinding [Smoothing]: %lld path cells down to %lld waypoints in %.3f ms"), pathCells, waypoints, smoothingSeconds * 1000.0);
+	}
+
+	{
+		FHierarchicalPathfinder hierarchy;
+		double buildStartTime = FPlatformTime::Seconds();
+		hierarchy.Build(Grid, HierarchicalClusterSize);
+		UE_LOG(LogTemp, Log, TEXT("BenchmarkPathfinding [Hierarchical]: %d clusters of %d cells, %d entrances, built in %.3f ms"),
+			hierarchy.GetClusterCount(), HierarchicalClusterSize, hierarchy.GetNodeCount(), (FPlatformTime::Seconds() - buildStartTime) * 1000.0);
+
+		//Coarse search plus the first leg is what an agent waits for, the full refinement is spread over its walk
+		auto runHierarchical = [&](bool refineAllLegs, const TCHAR* name)
+		{
+			FPathSearchContext context;
+			TArray<int32> waypoints;
+			TArray<int32> cells;
+			TArray<float> costs;
+			int64 totalExpanded = 0;
+			int32 pathsFound = 0;
+			double startTime = FPlatformTime::Seconds();
+			for (const auto& query : queries)
+			{
+				cells.Reset();
+				costs.Reset();
+				bool found = hierarchy.FindPath(Grid, context, query.Key, query.Value, waypoints);
+				totalExpanded += context.ExpandedCells;
+				for (int32 i = 1; found && i < waypoints.Num() && (refineAllLegs || i == 1); i++)
+				{
+					found = hierarchy.RefineLeg(Grid, context, waypoints[i - 1], waypoints[i], costs.Num() > 0 ? costs.Last() : 0.0f, cells, costs);
+					totalExpanded += context.ExpandedCells;
+				}
+				if (found) pathsFound++;
+			}
+			logResults(name, totalExpanded, pathsFound, FPlatformTime::Seconds() - startTime);
+		};
+		runHierarchical(false, TEXT("Hierarchical, first leg"));
+		runHierarchical(true, TEXT("Hierarchical, all legs"));
+	}
+
+	{
+		//Each query target then walks a few cells away, replanning after every step like a chase does
+		FIncrementalPathfinder planner;
+		FPathSearchContext context;
+		TArray<int32> cells;
+		TArray<float> costs;
+		int64 incrementalExpanded = 0;
+		int64 fullExpanded = 0;
+		int32 pathsFound = 0;
+		double incrementalSeconds = 0.0;
+		for (const auto& query : queries)
+		{
+			planner.Reset();
+			int32 targetIndex = query.Value;
+			for (int32 step = 0; step <= 5; step++)
+			{
+				double startTime = FPlatformTime::Seconds();
+				if (planner.Replan(Grid, query.Key, targetIndex, cells, costs)) pathsFound++;
+				incrementalSeconds += FPlatformTime::Seconds() - startTime;
+				//The first search of each query is a full one, only the repairs are counted
+				if (step > 0) incrementalExpanded += planner.ExpandedCells;
+
+				if (step > 0)
+				{
+					FGridPathfinder::FindPath(Grid, context, query.Key, targetIndex, cells, costs);
+					fullExpanded += context.ExpandedCells;
+				}
+
+				FCellNeighbors neighbors = Grid.GetNeighbors(targetIndex);
+				if (neighbors.Num() > 0) targetIndex = neighbors[random.RandRange(0, neighbors.Num() - 1)];
+			}
+		}
+		logResults(TEXT("Incremental, moving target"), incrementalExpanded, pathsFound, incrementalSeconds);
+		UE_LOG(LogTemp, Log, TEXT("BenchmarkPathfinding [Incremental, moving target]: %lld cells repaired against %lld expanded by A* from scratch"), incrementalExpanded, fullExpanded);
+	}
+
+	if (queries.Num() > 0)
+	{
+		//Every query start heading to the first target: one sweep instead of one search per start
+		FFlowField flowField;
+		double startTime = FPlatformTime::Seconds();
+		flowField.Build(Grid, queries[0].Value);
+		int32 pathsFound = 0;
+		for (const auto& query : queries)
+		{
+			if (flowField.IsReachable(query.Key)) pathsFound++;
+		}
+		logResults(TEXT("Flow field, shared target"), Grid.Num(), pathsFound, FPlatformTime::Seconds() - startTime);
+	}
+}
+
+FString AGridManager::RunBenchmarkSuite(int32 queryCount, int32 seed, const FString& outputFile)
+{
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+	report->SetStringField(TEXT("build"), FApp::GetBuildVersion());
+	report->SetStringField(TEXT("configuration"), LexToString(FApp::GetBuildConfiguration()));
+	report->SetStringField(TEXT("cpu"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+	report->SetNumberField(TEXT("seed"), seed);
+	report->SetNumberField(TEXT("query_count"), queryCount);
+	report->SetBoolField(TEXT("diagonals"), CanMoveOnDiagonals);
+	TArray<TSharedPtr<FJsonValue>> results;
+
+	const int32 gridSizes[] = { 64, 128, 256, 512, 1024 };
+	const EBenchmarkGridLayout layouts[] = { RANDOM_OBSTACLES, MAZE, ROOMS };
+	const float obstacleDensity = 0.2f;
+	FScopedSlowTask slowTask(UE_ARRAY_COUNT(gridSizes) * UE_ARRAY_COUNT(layouts), FText::FromString(TEXT("Running the pathfinding benchmark suite")));
+
+	for (int32 gridSize : gridSizes)
+	{
+		for (EBenchmarkGridLayout layout : layouts)
+		{
+			slowTask.EnterProgressFrame();
+			GenerateBenchmarkCells(gridSize, layout, layout == MAZE ? 0.0f : obstacleDensity, seed);
+			CellViews.Empty();
+			TArray<TPair<int32, int32>> queries = PickBenchmarkQueries(queryCount, seed);
+			FString layoutName = UEnum::GetValueAsString(layout);
+			layoutName.RemoveFromStart(TEXT("EBenchmarkGridLayout::"));
+
+			//Times every query on its own for the percentiles, search returns whether a path was found and the cells it expanded
+			auto runEngine = [&](const TCHAR* engine, TFunctionRef<bool(int32, int32, int32&)> search, TFunctionRef<SIZE_T()> getEngineBytes, int32 engineQueryCount)
+			{
+				TArray<double> latencies;
+				int64 totalExpanded = 0;
+				int32 pathsFound = 0;
+				double totalSeconds = 0.0;
+				for (int32 queryIndex = 0; queryIndex < FMath::Min(engineQueryCount, queries.Num()); queryIndex++)
+				{
+					int32 expanded = 0;
+					double startTime = FPlatformTime::Seconds();
+					if (search(queries[queryIndex].Key, queries[queryIndex].Value, expanded)) pathsFound++;
+					double seconds = FPlatformTime::Seconds() - startTime;
+					latencies.Add(seconds * 1000.0);
+					totalSeconds += seconds;
+					totalExpanded += expanded;
+				}
+				if (latencies.Num() == 0) return;
+
+				latencies.Sort();
+				auto getPercentile = [&](double percentile) { return latencies[FMath::Clamp(FMath::CeilToInt(percentile * latencies.Num()) - 1, 0, latencies.Num() - 1)]; };
+
+				TSharedRef<FJsonObject> result = MakeShared<FJsonObject>();
+				result->SetNumberField(TEXT("grid_size"), gridSize);
+				result->SetStringField(TEXT("layout"), layoutName);
+				result->SetStringField(TEXT("engine"), engine);
+				result->SetNumberField(TEXT("queries"), latencies.Num());
+				result->SetNumberField(TEXT("paths_found"), pathsFound);
+				result->SetNumberField(TEXT("queries_per_second"), latencies.Num() / FMath::Max(totalSeconds, 1e-9));
+				result->SetNumberField(TEXT("expanded_cells"), totalExpanded);
+				result->SetNumberField(TEXT("expanded_cells_per_query"), (double)totalExpanded / latencies.Num());
+				result->SetNumberField(TEXT("latency_p50_ms"), getPercentile(0.5));
+				result->SetNumberField(TEXT("latency_p99_ms"), getPercentile(0.99));
+				result->SetNumberField(TEXT("latency_max_ms"), latencies.Last());
+				result->SetNumberField(TEXT("grid_bytes"), Grid.GetAllocatedSize());
+				result->SetNumberField(TEXT("engine_bytes"), getEngineBytes());
+				result->SetNumberField(TEXT("process_peak_bytes"), FPlatformMemory::GetStats().PeakUsedPhysical);
+				results.Add(MakeShared<FJsonValueObject>(result));
+
+				UE_LOG(LogTemp, Log, TEXT("RunBenchmarkSuite [%dx%d %s, %s]: %.0f queries/s, p50 %.3f ms, p99 %.3f ms, %lld expansions"),
+					gridSize, gridSize, *layoutName, engine, latencies.Num() / FMath::Max(totalSeconds, 1e-9), getPercentile(0.5), getPercentile(0.99), totalExpanded);
+			};
+
+			FPathSearchContext context;
+			TArray<int32> cells;
+			TArray<float> costs;
+			FPath path;
+
+			//The Blueprint entry points, with whatever algorithm the manager is set to and the cell views they create.
+			//The queries are all different, the cache would only be a cost, and it would answer the second run from the first.
+			TGuardValue<bool> disablePathCache(UsePathCache, false);
+			runEngine(TEXT("FindPathByLocation"), [&](int32 start, int32 target, int32& outExpanded)
+			{
+				bool found = FindPathByLocation(path, Grid.GetLocation(start), Grid.GetLocation(target));
+				outExpanded = FPathSearchContext::GetThreadContext().ExpandedCells;
+				return found;
+			}, [&]() { return FPathSearchContext::GetThreadContext().GetAllocatedSize() + Hierarchy.GetAllocatedSize(); }, queryCount);
+			CellViews.Empty();
+			runEngine(TEXT("FindPathByCell"), [&](int32 start, int32 target, int32& outExpanded)
+			{
+				bool found = FindPathByCell(path, GetCell(start), GetCell(target));
+				outExpanded = FPathSearchContext::GetThreadContext().ExpandedCells;
+				return found;
+			}, [&]() { return FPathSearchContext::GetThreadContext().GetAllocatedSize() + Hierarchy.GetAllocatedSize(); }, queryCount);
+			CellViews.Empty();
+
+			//Every query asked a second time, what a shared popular destination costs once it is cached
+			UsePathCache = true;
+			for (const auto& query : queries) FindPathByIndex(path, query.Key, query.Value);
+			PathCache.ResetStats();
+			runEngine(TEXT("FindPathByIndex (cached)"), [&](int32 start, int32 target, int32& outExpanded)
+			{
+				int64 misses = PathCache.GetStats().Misses;
+				bool found = FindPathByIndex(path, start, target);
+				outExpanded = PathCache.GetStats().Misses > misses ? FPathSearchContext::GetThreadContext().ExpandedCells : 0;
+				return found;
+			}, [&]() { return PathCache.GetUsedBytes(); }, queryCount);
+			UE_LOG(LogTemp, Log, TEXT("RunBenchmarkSuite [%dx%d %s]: path cache %lld hits, %lld misses, %d paths in %.1f KB"),
+				gridSize, gridSize, *layoutName, PathCache.GetStats().Hits + PathCache.GetStats().SuffixHits, PathCache.GetStats().Misses, PathCache.Num(), PathCache.GetUsedBytes() / 1024.0f);
+			PathCache.Empty();
+			UsePathCache = false;
+			CellViews.Empty();
+
+			runEngine(TEXT("A*"), [&](int32 start, int32 target, int32& outExpanded)
+			{
+				bool found = FGridPathfinder::FindPath(Grid, context, start, target, cells, costs);
+				outExpanded = context.ExpandedCells;
+				return found;
+			}, [&]() { return context.GetAllocatedSize(); }, queryCount);
+
+			if (CanUseJumpPointSearch())
+			{
+				runEngine(TEXT("Jump point search"), [&](int32 start, int32 target, int32& outExpanded)
+				{
+					bool found = FJumpPointSearch::FindPath(Grid, context, start, target, cells, costs);
+					outExpanded = context.ExpandedCells;
+					return found;
+				}, [&]() { return context.GetAllocatedSize(); }, queryCount);
+			}
+
+			//Coarse search plus the first leg, what an agent waits for before it starts walking
+			FHierarchicalPathfinder hierarchy;
+			hierarchy.Build(Grid, HierarchicalClusterSize);
+			TArray<int32> waypoints;
+			runEngine(TEXT("Hierarchical"), [&](int32 start, int32 target, int32& outExpanded)
+			{
+				cells.Reset();
+				costs.Reset();
+				bool found = hierarchy.FindPath(Grid, context, start, target, waypoints);
+				outExpanded = context.ExpandedCells;
+				if (found && waypoints.Num() > 1)
+				{
+					found = hierarchy.RefineLeg(Grid, context, waypoints[0], waypoints[1], 0.0f, cells, costs);
+					outExpanded += context.ExpandedCells;
+				}
+				return found;
+			}, [&]() { return context.GetAllocatedSize() + hierarchy.GetAllocatedSize(); }, queryCount);
+
+			//A whole grid sweep per target, only a few of them
+			FFlowField flowField;
+			runEngine(TEXT("Flow field build"), [&](int32 start, int32 target, int32& outExpanded)
+			{
+				flowField.Build(Grid, target);
+				outExpanded = Grid.Num();
+				return flowField.IsReachable(start);
+			}, [&]() { return flowField.GetAllocatedSize(); }, FMath::Min(queryCount, 10));
+
+			OnGridRebuilt();
+		}
+	}
+	report->SetArrayField(TEXT("results"), results);
+
+	FString json;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+	FJsonSerializer::Serialize(report, writer);
+
+	FString path = outputFile.IsEmpty()
+		? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), FString::Printf(TEXT("Pathfinding-%s.json"), *FDateTime::Now().ToString()))
+		: outputFile;
+	if (!FFileHelper::SaveStringToFile(json, *path))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("RunBenchmarkSuite: could not write %s"), *path);
+		return FString();
+	}
+	UE_LOG(LogTemp, Log, TEXT("RunBenchmarkSuite: %d results written to %s"), results.Num(), *path);
+	return path;
 }
+#endif
 
 
 // Sets default values
@@ -467,6 +2350,14 @@ AGridManager::AGridManager()
 
 	CollisionChecker = CreateDefaultSubobject<USphereComponent>(TEXT("Collision Checker"));
 	CollisionChecker->SetCollisionProfileName("OverlapAll");
+
+	PathRequests.Initialize(&Grid, [this](FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts, TArray<int32>& outWaypoints)
+	{
+		return FindPathIndices(context, startIndex, targetIndex, outCells, outCosts, &outWaypoints);
+	}, [this](FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outMissingChunks)
+	{
+		FindMissingChunks(context, startIndex, targetIndex, outMissingChunks);
+	});
 }
 
 // Called when the game starts or when spawned
@@ -475,16 +2366,42 @@ void AGridManager::BeginPlay()
 	Super::BeginPlay();
 
 	CalculateSizes();
-	CreateCells();
-	CalculateCellsHeights();
-	SetAllCellNeighbors();
+	if (!LoadBakedGrid())
+	{
+		CreateCells();
+		//A streamed grid is built chunk by chunk around the pawns
+		if (!Grid.IsChunked())
+		{
+			CalculateCellsHeights();
+			SetAllCellNeighbors();
+		}
+	}
+	//The pawns start with their chunks loaded, the first decisions already have cells to go to
+	UpdateChunkStreaming(MAX_int32);
+	UpdateHierarchy();
+	PathCache.SetMaxBytes((SIZE_T)FMath::Max(PathCacheBudgetKB, 0) * 1024);
 	SetAIControllerReferences();
+
+	UE_LOG(LogTemp, Log, TEXT("Grid built: %d cells, %.1f KB"), Grid.Num(), Grid.GetAllocatedSize() / 1024.0f);
+}
+
+void AGridManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	PathRequests.CancelAll();
+	PathRequests.WaitForWorkers();
+	PathRequestCallbacks.Empty();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
 void AGridManager::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	double startTime = FPlatformTime::Seconds();
+	UpdateChunkStreaming(MaxChunkLoadsPerTick);
+	ProcessPathRequests();
+	FAISimulationStats::Get().PathRequestSeconds += FPlatformTime::Seconds() - startTime;
 	//DrawCells();
 }
 
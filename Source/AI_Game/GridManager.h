@@ -8,6 +8,15 @@
 #include "Engine/DataTable.h"
 #include "Math/IntVector.h"
 #include "Cell.h"
+#include "NavGrid.h"
+#include "PathSearchContext.h"
+#include "PathRequestQueue.h"
+#include "HierarchicalPathfinder.h"
+#include "NearestCellIndex.h"
+#include "FlowField.h"
+#include "IncrementalPathfinder.h"
+#include "PathCache.h"
+#include "GridObstacle.h"
 
 #include "GridManager.generated.h"
 
@@ -15,25 +24,90 @@
 class UBoxComponent;
 class USphereComponent;
 class ATileMovementPlayerController;
+class UNavGridAsset;
 
+//Cell indices of a path, walked by advancing a cursor. Emptying and refilling it keeps its buffers, following and re-pathing don't allocate once they are big enough.
 USTRUCT(BlueprintType)
 struct FPath
 {
 	GENERATED_BODY()
 
-		UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
-		TArray<UCell*> CellsInPath;
+	//From the cell after the start to the target, the ones before Cursor were already reached
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		TArray<int32> Cells;
 
+	//Cost of reaching each cell from the start
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 		TArray<float> CellCosts;
 
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int32 Cursor = 0;
+
+	//Hierarchical paths are refined one leg at a time, the first waypoint is the last cell refined so far
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		TArray<int32> Waypoints;
+
+	//Cells left to walk
+	FORCEINLINE int32 Num() const { return Cells.Num() - Cursor; }
+	FORCEINLINE bool IsDone() const { return Cursor >= Cells.Num(); }
+	FORCEINLINE int32 GetNextCell() const { return Cells[Cursor]; }
+	FORCEINLINE void Advance() { Cursor++; }
+
 	void Empty()
 	{
-		CellsInPath.Empty();
-		CellCosts.Empty();
+		Cells.Reset();
+		CellCosts.Reset();
+		Waypoints.Reset();
+		Cursor = 0;
+	}
+
+	//Copies other into the buffers this path already has
+	void Assign(const FPath& other)
+	{
+		Empty();
+		Cells.Append(other.Cells.GetData() + other.Cursor, other.Num());
+		CellCosts.Append(other.CellCosts.GetData() + other.Cursor, other.Num());
+		Waypoints.Append(other.Waypoints);
+	}
+
+	//Drops the cells already reached, before appending more
+	void Compact()
+	{
+		if (Cursor == 0) return;
+
+		Cells.RemoveAt(0, Cursor, false);
+		CellCosts.RemoveAt(0, Cursor, false);
+		Cursor = 0;
 	}
 };
 
+UENUM()
+enum EPathfindingAlgorithm
+{
+	A_STAR				UMETA(DisplayName = "A*"),
+	JUMP_POINT_SEARCH	UMETA(DisplayName = "Jump Point Search"),
+	HIERARCHICAL		UMETA(DisplayName = "Hierarchical (HPA*)")
+};
+
+UENUM()
+enum EBenchmarkGridLayout
+{
+	RANDOM_OBSTACLES	UMETA(DisplayName = "Random obstacles"),
+	MAZE				UMETA(DisplayName = "Maze"),
+	ROOMS				UMETA(DisplayName = "Rooms")
+};
+
+//Chunks of a streamed grid a path request is held for
+struct FPathRequestChunks
+{
+	//Not loaded yet, the request is released once this is empty
+	TArray<int32> Missing;
+	//Chunks loaded for the request so far
+	int32 Loads = 0;
+};
+
+DECLARE_DELEGATE_ThreeParams(FOnPathRequestComplete, int32 /*requestHandle*/, bool /*pathFound*/, const FPath& /*path*/);
+
 UCLASS(ClassGroup = (Custom), Blueprintable)
 class AI_GAME_API AGridManager : public AActor
 {
@@ -48,6 +122,14 @@ protected:
 		float CellRadius = 30.0f;
 	UPROPERTY(EditAnywhere, Category = "Grid")
 		float SafetyRadius = 2.0f;
+	//Walkable surfaces kept per column, for bridges, floors and ramps above each other. 1 keeps a flat grid of the top surfaces.
+	//Layered grids are searched with A*, and are not streamed in chunks.
+	UPROPERTY(EditAnywhere, Category = "Cells", meta = (ClampMin = "1", ClampMax = "4"))
+		int32 MaxCellLayers = 1;
+	//Height an agent needs above a surface, the surfaces of a column are at least this far apart.
+	//Keep it over twice MaxTraversableSlope so a cell links to one layer of each neighbor column at most.
+	UPROPERTY(EditAnywhere, Category = "Cells")
+		float MinLayerClearance = 200.0f;
 
 	UPROPERTY(EditAnywhere, Category = "Movement")
 		float BaseMoveCost = 1.0f;
@@ -64,20 +146,202 @@ protected:
 		UBoxComponent* CollisionBox = nullptr;
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = "Grid")
 		USphereComponent* CollisionChecker = nullptr;
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cells")
-		TArray<UCell*> GridCells;
 
-	UCell* GetCellFromCoordinates(int32 x, int32 y) const;
+	FNavGrid Grid;
+	//Blueprint views of the cells that were asked for, created on demand by GetCell. Only what holds a view keeps it alive,
+	//the ones garbage collected are pruned from the map once it doubled in size.
+	TMap<int32, TWeakObjectPtr<UCell>> CellViews;
+	int32 CellViewsPruneCount = 0;
+	void UpdateCellView(int32 index);
+
+	//Null if the column has no cell on that layer
+	UCell* GetCellFromCoordinates(int32 x, int32 y, int32 layer = 0);
 	bool GetCellIndexFromGridPosition(int32& index, int32 x, int32 y) const;
 	void SetAIControllerReferences();
 	void DrawCells();
+	//Stream GetRandomCell draws from, seeded by SetRandomSeed
+	FRandomStream Random;
 	
+	//Runs tileFunction for every tile of the box of cell coordinates with the first and last coordinates in it, on the worker threads.
+	//Logs the progress of the stage unless stageName is null.
+	void ProcessTiles(const TCHAR* stageName, const FIntPoint& regionMin, const FIntPoint& regionMax, TFunctionRef<void(const FIntPoint&, const FIntPoint&)> tileFunction);
+	//Runs cellFunction for every cell of the box, tile by tile on the worker threads
+	void ProcessCellsInTiles(const TCHAR* stageName, const FIntPoint& regionMin, const FIntPoint& regionMax, TFunctionRef<void(int32)> cellFunction);
 	void CalculateCellsHeights();
+	//Traces the heights and slopes of the cells in the box of coordinates, which must be inside the grid
+	void TraceCellHeights(const FIntPoint& min, const FIntPoint& max, bool logProgress);
+	//Blocks the cells in the box the collision checker overlaps static obstacles at
+	void TraceCellBlocks(const FIntPoint& min, const FIntPoint& max, bool logProgress);
+	//Traces up to MaxCellLayers surfaces per column from the top down and turns the grid into a layered one
+	void TraceCellLayers();
+	//Directions of the neighbors a cell can step to, following CanMoveOnDiagonals and MaxTraversableSlope.
+	//On layered grids each link goes to the layer of the neighbor column closest in height, outNeighborLayers gets it for FNavGrid::SetNeighborLayers.
+	uint8 CalculateNeighborMask(int32 cellIndex, uint16& outNeighborLayers) const;
+	void UpdateNeighborMask(int32 cellIndex);
+	//True if the cell has no link to a loaded neighbor it could step to but for MaxTraversableSlope
+	bool HasSlopeCutLinks(int32 cellIndex) const;
+	//Loaded cells with links cut by the slope, Jump Point Search is only used while there are none
+	TSet<int32> SlopeCutCells;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Grid")
 		float LinceTraceHeight = 10000;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Grid")
 		float MaxTraversableSlope = 30.0f;
 
+	//Cancels the pending requests and drops the cell views and derived data of the current grid
+	void DiscardCells();
+
+	//Grid baked with BakeGrid, BeginPlay loads it instead of building the grid while it still matches the grid settings
+	UPROPERTY(EditAnywhere, Category = "Grid")
+		UNavGridAsset* BakedGrid = nullptr;
+	bool LoadBakedGrid();
+
+	//Jump Point Search is only used while diagonal movement is on, every cell has the same move cost and no link is cut by the slope, A* is used otherwise
+	UPROPERTY(EditAnywhere, Category = "Pathfinding")
+		TEnumAsByte<EPathfindingAlgorithm> PathfindingAlgorithm = A_STAR;
+	bool CanUseJumpPointSearch() const;
+	//The algorithm searches actually run with, falls back to A* when the selected one can't be used
+	EPathfindingAlgorithm GetActiveAlgorithm() const;
+
+	//Width in cells of the square clusters of the hierarchical graph
+	UPROPERTY(EditAnywhere, Category = "Pathfinding", meta = (ClampMin = "2"))
+		int32 HierarchicalClusterSize = 16;
+	FHierarchicalPathfinder Hierarchy;
+	//Builds the hierarchical graph or rebuilds the clusters that changed, only while it is the selected algorithm
+	void UpdateHierarchy();
+	//Locations of path queries on a blocked cell are moved to the nearest walkable cell up to this many cells away.
+	//0 keeps the cell under the location as it is.
+	UPROPERTY(EditAnywhere, Category = "Pathfinding", meta = (ClampMin = "0"))
+		int32 WalkableSnapRadius = 8;
+	FNearestCellIndex NearestCells;
+	//Builds the nearest walkable cell index or recomputes the cells around the ones that changed
+	void UpdateNearestCells();
+	//Refines up to legCount legs from the front of waypoints, dropping the waypoints that were reached
+	bool RefineWaypoints(FPathSearchContext& context, TArray<int32>& waypoints, int32 legCount, float baseCost, TArray<int32>& outCells, TArray<float>& outCosts) const;
+
+	UPROPERTY(EditAnywhere, Category = "Pathfinding")
+		TEnumAsByte<EPathRequestMode> PathRequestMode = WORKER_THREADS;
+	//Game thread time spent on path requests each frame when they are time sliced
+	UPROPERTY(EditAnywhere, Category = "Pathfinding")
+		float PathRequestBudgetMicroseconds = 1000.0f;
+	UPROPERTY(EditAnywhere, Category = "Pathfinding")
+		int32 MaxPathWorkerTasks = 8;
+
+	FPathRequestQueue PathRequests;
+	TMap<int32, FOnPathRequestComplete> PathRequestCallbacks;
+	//Kept between ticks so handing the finished requests out doesn't allocate
+	TArray<FPathRequestResult> PathRequestResults;
+	FPath PathRequestPath;
+	FPath CachedRequestPath;
+	void ProcessPathRequests();
+	//Waits for the worker searches, the grid must not change while they are running
+	void PrepareGridChange();
+	//Updates the data derived from the grid after one cell changed, or after the whole grid did
+	void OnCellChanged(int32 cellIndex);
+	void OnRegionChanged(const FGridDirtyRegion& region);
+	void OnGridRebuilt();
+
+	//Indexed by obstacle handle
+	TSparseArray<FStampedGridObstacle> Obstacles;
+	TMap<int32, FGridObstacleCell> ObstacleCells;
+	//Cells that were covered or uncovered by the obstacle change being applied
+	TArray<int32> ObstacleTouchedCells;
+	void StampObstacle(int32 obstacleHandle);
+	void UnstampObstacle(int32 obstacleHandle);
+	//Works out what the cell is under the obstacles covering it and writes it to the grid, returns true if its state or move cost changed
+	bool UpdateObstacleCell(int32 cellIndex);
+	//Updates the touched cells and tells everything that depends on them about the ones that changed
+	void ApplyObstacleChange();
+	//Stamps every obstacle again, once the cells of a rebuilt grid have their heights and links
+	void RestampObstacles();
+	//Forgets which cells the obstacles cover, before the grid is replaced
+	void DropObstacleStamps();
+	//Forgets which cells of the chunk the obstacles cover, before it is unloaded
+	void DropObstacleStamps(int32 chunkIndex);
+	//First and last coordinates of the cells the obstacle can cover, false if it is outside the grid
+	bool GetObstacleCellBounds(const FGridObstacle& obstacle, FIntPoint& outMin, FIntPoint& outMax) const;
+
+	//Splits the grid in chunks that are only built, or read from BakedGrid, around the pawns and unloaded again when the memory budget runs out.
+	//For levels too big to keep the whole grid in memory.
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+		bool StreamChunks = false;
+	//Cells a side of a chunk, rounded up to a power of two
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ClampMin = "2"))
+		int32 ChunkSize = 64;
+	//Chunks closer than this to a pawn are kept loaded
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+		float ChunkLoadRadius = 5000.0f;
+	//Least recently needed chunks are unloaded while the loaded ones take more than this, the chunks around the pawns stay
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ClampMin = "0"))
+		int32 ChunkMemoryBudgetKB = 16 * 1024;
+	//Chunks loaded each tick, the ones path requests wait for first and then the ones around the pawns, nearest first
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ClampMin = "1"))
+		int32 MaxChunkLoadsPerTick = 2;
+	//Chunks a path request can have loaded, on the line between its ends and then where its search ran into unloaded chunks.
+	//Past it the request fails like on a grid that is fully loaded.
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ClampMin = "1"))
+		int32 MaxPathChunkLoads = 32;
+	//Chunks built from the level also go through CheckCellBlocks, which the whole grid only does when it is called
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+		bool CheckChunkBlocks = false;
+	//Frame each chunk was last needed on, for the least recently used eviction
+	TArray<uint64> ChunkLastUsedFrames;
+	TArray<int32> LoadedChunks;
+	void ResetChunkStreaming();
+	//Loads the chunks path requests wait for and the ones around the pawns, up to maxLoads of them, and unloads the ones over the memory budget
+	void UpdateChunkStreaming(int32 maxLoads);
+	//Reads the chunk from BakedGrid or builds it from the level, then links it to the loaded chunks around it
+	void LoadChunk(int32 chunkIndex);
+	void UnloadChunk(int32 chunkIndex);
+	//Adds the unloaded chunks the straight line between the two cells crosses to outChunks, a path can only go through loaded chunks
+	void GetUnloadedChunksBetween(int32 startIndex, int32 targetIndex, TArray<int32>& outChunks);
+	//Unloaded chunks next to the loaded cells the start reaches, the ones a failed search could have gone on into, nearest to
+	//targetIndex first. Only reads the grid, safe on the worker threads.
+	void FindMissingChunks(FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outChunks) const;
+	//Held path requests by handle, released by UpdateChunkStreaming once their chunks are loaded
+	TMap<int32, FPathRequestChunks> PathRequestChunks;
+	//Chunks synchronous searches were missing, loaded by the next ticks
+	TArray<int32> RequestedChunks;
+	//Adds the chunks to the ones the request waits for, false once it had MaxPathChunkLoads of them
+	bool AddPathRequestChunks(int32 requestHandle, const TArray<int32>& chunks);
+	//Adds the nearest chunks a failed synchronous search between the two cells was missing to RequestedChunks
+	void RequestMissingChunks(int32 startIndex, int32 targetIndex);
+	//Recomputes the neighbor masks of the cells in the box, clamped to the grid
+	void UpdateNeighborMasks(const FIntPoint& min, const FIntPoint& max);
+	//Tells everything that depends on the grid that the cells of the chunk and the links into it changed
+	void OnChunkChanged(int32 chunkIndex);
+
+	//Flow fields kept at once, one per goal cell
+	UPROPERTY(EditAnywhere, Category = "Pathfinding")
+		int32 MaxFlowFields = 8;
+	TMap<int32, TSharedPtr<FFlowField>> FlowFields;
+	//Fields towards the nearest of several goals, MaxFlowFields of them too
+	TArray<TSharedPtr<FFlowField>> NearestGoalFlowFields;
+
+	//Incremental planners kept at once, one per agent replanning with ReplanPath
+	UPROPERTY(EditAnywhere, Category = "Pathfinding")
+		int32 MaxIncrementalPlanners = 16;
+	TMap<const UObject*, TSharedPtr<FIncrementalPathfinder>> IncrementalPlanners;
+
+	//Drops the cells an agent can skip by walking straight to a later one, so it steers towards fewer waypoints
+	UPROPERTY(EditAnywhere, Category = "Pathfinding")
+		bool SmoothPaths = true;
+	//Smooths the cells of path from firstCell on, the ones before come from startIndex
+	void SmoothPath(int32 startIndex, FPath& path, int32 firstCell = 0) const;
+
+	//Found paths are kept for the next queries between the same cells, or from a cell further along the same path
+	UPROPERTY(EditAnywhere, Category = "Pathfinding")
+		bool UsePathCache = true;
+	UPROPERTY(EditAnywhere, Category = "Pathfinding", meta = (ClampMin = "0"))
+		int32 PathCacheBudgetKB = 256;
+	FPathCache PathCache;
+	//What the cached paths depend on besides the grid: the movement rules and the active algorithm
+	uint32 GetPathCacheFlags() const;
+
+#if !UE_BUILD_SHIPPING
+	//Start and target cells of queryCount random queries, both walkable
+	TArray<TPair<int32, int32>> PickBenchmarkQueries(int32 queryCount, int32 seed) const;
+#endif
+
 public:
 	UFUNCTION(BlueprintPure)
 		inline float GetBaseMoveCost() { return BaseMoveCost; }
@@ -85,8 +349,12 @@ public:
 		inline FVector GetGridSize() { return GridSize; };
 	UFUNCTION(BlueprintPure)
 		inline FIntVector GetCellCount() { return CellCount; };
+	//Creates a view for every cell, prefer GetCell or the FNavGrid from GetNavGrid
 	UFUNCTION(BlueprintPure)
-		inline TArray<UCell*> GetGridCells() { return GridCells; };
+		TArray<UCell*> GetGridCells();
+	UFUNCTION(BlueprintCallable)
+		UCell* GetCell(int32 cellIndex);
+	inline const FNavGrid& GetNavGrid() const { return Grid; }
 	UFUNCTION(BlueprintPure)
 		inline float GetCellRadius() { return CellRadius; }
 
@@ -103,22 +371,83 @@ public:
 		void CheckCellBlocks();
 	UFUNCTION(BlueprintCallable)
 		void CalculateSizes();
+	//On a cell obstacles cover, changes the cell under them
 	UFUNCTION(BlueprintCallable)
 		void SetCell(int32 cellIndex, TEnumAsByte<ECellState> state, float moveCost, int32 modifierPriority);
 
+	//Stamps the footprint on the cells it covers and returns the handle to move or remove it with.
+	//Covered cells follow the modifier priority rules of SetCell, and get back what they were once no obstacle covers them.
+	//Obstacles registered before the grid is built, or while it is rebuilt, are stamped once its cells are ready.
+	UFUNCTION(BlueprintCallable)
+		int32 RegisterObstacle(const FGridObstacle& obstacle);
+	//Moves the footprint, only the cells it covered or covers now are updated
+	UFUNCTION(BlueprintCallable)
+		bool UpdateObstacle(int32 obstacleHandle, const FTransform& transform);
+	UFUNCTION(BlueprintCallable)
+		bool UnregisterObstacle(int32 obstacleHandle);
+
+	//Broadcast on the game thread after cells changed state or move cost, once per SetCell and once per obstacle change.
+	//Agents walking a path across the region request a new one.
+	FOnGridRegionDirty OnGridRegionDirty;
+
+	UFUNCTION(BlueprintCallable)
+		UCell* GetClosestCellFromLocation(const FVector& location);
+	int32 GetClosestCellIndexFromLocation(const FVector& location) const;
+	//Like GetClosestCellFromLocation, but a blocked cell is replaced by the nearest walkable cell within WalkableSnapRadius
 	UFUNCTION(BlueprintCallable)
-		UCell* GetClosestCellFromLocation(const FVector& location) const;
+		UCell* GetClosestWalkableCellFromLocation(const FVector& location);
+	int32 GetClosestWalkableCellIndex(const FVector& location);
+	//GetClosestWalkableCellIndex for many agents at once, the index is only brought up to date once for the whole batch
+	void GetClosestWalkableCellIndices(TArrayView<const FVector> locations, TArray<int32>& outIndices);
 
 	UFUNCTION(BlueprintCallable)
 		float GetDistanceBetweenCells(const UCell* cellA, const UCell* cellB, const bool& diagonal = false, const bool& vertical = false) const;
+	float GetDistanceBetweenCoordinates(const FIntVector& coordinatesA, const FIntVector& coordinatesB, bool diagonal = false) const;
+
+#if WITH_EDITOR
+	//Builds the grid from the level and stores it in BakedGrid, bake again after the level changes
+	UFUNCTION(CallInEditor, Category = "Grid")
+		void BakeGrid();
+#endif
 
 	UFUNCTION(BlueprintCallable)
-		void SetCellNeighbors(UCell* cell);
+		void SetCellNeighbors(int32 cellIndex);
 	UFUNCTION(BlueprintCallable)
 		void SetAllCellNeighbors();
 
 	UFUNCTION(BlueprintCallable)
 		bool FindPathByCell(FPath& outPath, UCell* start, UCell* end);
+	//Views of the cells left to walk on the path
+	UFUNCTION(BlueprintPure)
+		TArray<UCell*> GetPathCells(const FPath& path);
+	bool FindPathByIndex(FPath& outPath, int32 startIndex, int32 targetIndex);
+	inline const FPathCacheStats& GetPathCacheStats() const { return PathCache.GetStats(); }
+	//Queues a search and returns its handle, onComplete runs on the game thread once the path is ready.
+	//A requester only has one live request, a new request from it replaces the previous one unless the target cell is the same.
+	int32 RequestPathByLocation(const UObject* requester, const FVector& start, const FVector& end, FOnPathRequestComplete onComplete);
+	int32 RequestPathByIndex(const UObject* requester, int32 startIndex, int32 targetIndex, FOnPathRequestComplete onComplete);
+	void CancelPathRequest(int32 requestHandle);
+	bool IsPathRequestPending(int32 requestHandle) const;
+
+	//Does not touch the grid or the manager, safe to call from any thread as long as each caller uses its own context.
+	//With outWaypoints, hierarchical paths only get their first leg refined and the remaining waypoints are returned for RefinePath.
+	bool FindPathIndices(FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts, TArray<int32>* outWaypoints = nullptr) const;
+	//For agents that replan often towards a moving target: repairs the requester's last search instead of starting a new one.
+	//Runs on the game thread right away, unlike RequestPathByLocation.
+	bool ReplanPath(const UObject* requester, const FVector& start, const FVector& end, FPath& outPath);
+	void ReleaseIncrementalPlanner(const UObject* requester);
+	//Flow field towards goalIndex, built on first use and shared by every agent heading to that cell until the cells it reached change
+	const FFlowField* GetFlowField(int32 goalIndex);
+	//Flow field towards the nearest of the goal cells, one sweep for all of them. Kept like the single goal fields, for the same goals in any order.
+	const FFlowField* GetFlowField(TArrayView<const int32> goalIndices);
+	//Location of the next cell on the way from location to destination, false if there is none or destination is already reached
+	bool GetFlowFieldStep(const FVector& location, const FVector& destination, FVector& outNextLocation);
+	//Length of the walk from location to destination over the grid in world units, read from the flow field towards destination
+	bool GetPathDistance(const FVector& location, const FVector& destination, float& outDistance);
+	//Appends the next leg of a hierarchical path, returns false if nothing was left to refine or the leg can no longer be walked
+	UFUNCTION(BlueprintCallable)
+		bool RefinePath(FPath& path);
+	//Z of the coordinates is the layer of the cell in its column, 0 for the lowest one
 	UFUNCTION(BlueprintCallable)
 		bool FindPathByCoordinate(FPath& outPath, const FIntVector& start, const FIntVector& end);
 	UFUNCTION(BlueprintCallable)
@@ -128,6 +457,28 @@ public:
 
 	UFUNCTION(BlueprintCallable)
 		UCell* GetRandomCell();
+	//A random free cell without a Blueprint view, INDEX_NONE if there is none
+	int32 GetRandomCellIndex();
+	inline void SetRandomSeed(int32 seed) { Random.Initialize(seed); }
+	inline void SetPathRequestMode(EPathRequestMode mode) { PathRequestMode = mode; }
+	//Replaces the grid with a generated gridSize x gridSize one, obstacleDensity is the chance of a blocked cell outside the maze walls.
+	//Pending path requests and the cells changed with SetCell are dropped like when the grid is built again.
+	void GenerateBenchmarkCells(int32 gridSize, EBenchmarkGridLayout layout, float obstacleDensity, int32 seed);
+
+#if !UE_BUILD_SHIPPING
+	//The benchmarks replace the grid and leave the last one they searched, they run on a manager of their own spawned by
+	//UPathfindingBenchmarkCommandlet, never on the one of a level.
+
+	//Runs the same random queries with the heap open list, with the old linear scan, with the heap on all worker threads,
+	//with Jump Point Search and with the hierarchical graph, and logs expansions per second.
+	//Also times one flow field shared by every query start towards the first target, and incremental repairs while each target moves.
+	//If generatedGridSize > 0 the queries run on a generated gridSize x gridSize grid instead of the current one.
+	void BenchmarkPathfinding(int32 queryCount = 100, int32 seed = 0, int32 generatedGridSize = 0, float obstacleDensity = 0.2f);
+	//Runs queryCount fixed seed queries on generated 64x64 to 1024x1024 grids of random obstacles, mazes and rooms with every engine,
+	//and writes queries per second, expanded cells, p50/p99 latency and memory to outputFile as JSON (Saved/Benchmarks by default).
+	//Returns the path of the file written, empty if it could not be written.
+	FString RunBenchmarkSuite(int32 queryCount = 100, int32 seed = 0, const FString& outputFile = TEXT(""));
+#endif
 
 	// Sets default values for this actor's properties
 	AGridManager();
@@ -135,6 +486,7 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	// Called every frame
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridObstacle.h"
+
+FBox FGridObstacle::GetBounds(float margin) const
+{
+	FVector scale = Transform.GetScale3D().GetAbs();
+	FVector extent;
+	switch (Shape)
+	{
+	case SPHERE:
+		extent = FVector(Radius * scale.GetMax());
+		break;
+	case CAPSULE:
+		extent = FVector(Radius * FMath::Min(scale.X, scale.Y));
+		extent.Z = FMath::Max(HalfHeight * scale.Z, extent.Z);
+		break;
+	default:
+		extent = BoxExtent * scale;
+		break;
+	}
+
+	FTransform rotation(Transform.GetRotation(), Transform.GetLocation());
+	return FBox(-extent, extent).TransformBy(rotation).ExpandBy(margin);
+}
+
+bool FGridObstacle::Overlaps(const FVector& location, float margin) const
+{
+	FVector scale = Transform.GetScale3D().GetAbs();
+	FVector local = Transform.InverseTransformPositionNoScale(location);
+	switch (Shape)
+	{
+	case SPHERE:
+		return local.SizeSquared() <= FMath::Square(Radius * scale.GetMax() + margin);
+	case CAPSULE:
+	{
+		float radius = Radius * FMath::Min(scale.X, scale.Y);
+		float segmentHalfHeight = FMath::Max(HalfHeight * scale.Z - radius, 0.0f);
+		local.Z -= FMath::Clamp(local.Z, -segmentHalfHeight, segmentHalfHeight);
+		return local.SizeSquared() <= FMath::Square(radius + margin);
+	}
+	default:
+	{
+		FVector outside = (local.GetAbs() - BoxExtent * scale).ComponentMax(FVector::ZeroVector);
+		return outside.SizeSquared() <= FMath::Square(margin);
+	}
+	}
+}
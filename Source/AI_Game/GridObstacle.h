@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Cell.h"
+#include "GridObstacle.generated.h"
+
+UENUM(BlueprintType)
+enum EGridObstacleShape
+{
+	BOX			UMETA(DisplayName = "Box"),
+	SPHERE		UMETA(DisplayName = "Sphere"),
+	//Upright along the Z axis of the transform, like UCapsuleComponent
+	CAPSULE		UMETA(DisplayName = "Capsule")
+};
+
+//Footprint an actor stamps on the grid with AGridManager::RegisterObstacle, the cells it covers get its state and move cost
+USTRUCT(BlueprintType)
+struct AI_GAME_API FGridObstacle
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Obstacle")
+		TEnumAsByte<EGridObstacleShape> Shape = BOX;
+	//Scaled by the transform like the extent of a UBoxComponent
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Obstacle")
+		FVector BoxExtent = FVector(50.0f);
+	//Sphere and capsule radius
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Obstacle")
+		float Radius = 50.0f;
+	//Half the height of the capsule, the caps included
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Obstacle")
+		float HalfHeight = 100.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Obstacle")
+		FTransform Transform;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Obstacle")
+		TEnumAsByte<ECellState> State = BLOCKED;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Obstacle")
+		float MoveCost = 1.0f;
+	//Only covers the cells whose priority is not higher, the same rule AGridManager::SetCell follows
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Obstacle")
+		int32 ModifierPriority = 0;
+
+	//World box around the shape grown by margin
+	FBox GetBounds(float margin) const;
+	//True if the shape grown by margin contains location
+	bool Overlaps(const FVector& location, float margin) const;
+};
+
+struct FStampedGridObstacle
+{
+	FGridObstacle Obstacle;
+	//Cells the footprint covers
+	TArray<int32> Cells;
+};
+
+//What a cell covered by obstacles is under them, put back once none covers it
+struct FGridObstacleCell
+{
+	TEnumAsByte<ECellState> State;
+	float MoveCost;
+	int32 ModifierPriority;
+	//Handles of the obstacles covering the cell, in the order they were stamped
+	TArray<int32, TInlineAllocator<2>> Obstacles;
+};
+
+//Cells whose state or move cost changed, with the box of cell coordinates around them and one more cell on each side for the links into them.
+//The box can hold cells that did not change.
+struct FGridDirtyRegion
+{
+	FIntPoint Min = FIntPoint(MAX_int32, MAX_int32);
+	FIntPoint Max = FIntPoint(MIN_int32, MIN_int32);
+	TArray<int32> Cells;
+
+	FORCEINLINE bool IsEmpty() const { return Cells.Num() == 0; }
+	void Add(int32 cellIndex, const FIntVector& coordinates)
+	{
+		Cells.Add(cellIndex);
+		Min = FIntPoint(FMath::Min(Min.X, coordinates.X - 1), FMath::Min(Min.Y, coordinates.Y - 1));
+		Max = FIntPoint(FMath::Max(Max.X, coordinates.X + 1), FMath::Max(Max.Y, coordinates.Y + 1));
+	}
+	FORCEINLINE bool Contains(const FIntVector& coordinates) const
+	{
+		return coordinates.X >= Min.X && coordinates.X <= Max.X && coordinates.Y >= Min.Y && coordinates.Y <= Max.Y;
+	}
+	//True if the box of cells between the two coordinates overlaps the region, which is the case for every cell a straight walk between them touches
+	FORCEINLINE bool Intersects(const FIntVector& from, const FIntVector& to) const
+	{
+		return FMath::Max(from.X, to.X) >= Min.X && FMath::Min(from.X, to.X) <= Max.X && FMath::Max(from.Y, to.Y) >= Min.Y && FMath::Min(from.Y, to.Y) <= Max.Y;
+	}
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnGridRegionDirty, const FGridDirtyRegion& /*region*/);
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridPathfinder.h"
+
+void FGridPathfinder::BuildPath(const FPathSearchContext& context, TArray<int32>& outCells, TArray<float>& outCosts)
+{
+	//Count the cells first, then write them from the back so the path comes out in walking order
+	int32 cellCount = 0;
+	for (int32 index = context.TargetIndex; index != context.StartIndex; index = context.GetParentIndex(index)) cellCount++;
+
+	outCells.SetNumUninitialized(cellCount, false);
+	outCosts.SetNumUninitialized(cellCount, false);
+	int32 currentIndex = context.TargetIndex;
+	for (int32 i = cellCount - 1; i >= 0; i--)
+	{
+		outCells[i] = currentIndex;
+		outCosts[i] = context.GetGCost(currentIndex);
+		currentIndex = context.GetParentIndex(currentIndex);
+	}
+}
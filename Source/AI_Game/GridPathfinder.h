@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavGrid.h"
+#include "PathSearchContext.h"
+#include "Algo/Reverse.h"
+
+enum class EPathSearchStatus : uint8
+{
+	InProgress,
+	Found,
+	NotFound
+};
+
+/**
+ * A* over an FNavGrid.
+ * The grid is only read and every per-query value is written to the FPathSearchContext,
+ * so searches can run concurrently as long as each one uses its own context.
+ * A search can also be run a few expansions at a time with BeginSearch and Step.
+ */
+class AI_GAME_API FGridPathfinder
+{
+public:
+	//Grid distance used both as step cost and as heuristic
+	static FORCEINLINE float GetDistance(const FIntVector& coordinatesA, const FIntVector& coordinatesB)
+	{
+		return FMath::Abs(coordinatesA.X - coordinatesB.X) + FMath::Abs(coordinatesA.Y - coordinatesB.Y) + FMath::Abs(coordinatesA.Z - coordinatesB.Z);
+	}
+
+	//Fills outCells with the path from startIndex (excluded) to targetIndex and outCosts with the cost to reach each of them
+	static bool FindPath(const FNavGrid& grid, FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts)
+	{
+		return FindPath(grid, context, context.OpenCells, startIndex, targetIndex, outCells, outCosts);
+	}
+
+	template<typename OpenListType>
+	static bool FindPath(const FNavGrid& grid, FPathSearchContext& context, OpenListType& openList, int32 startIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts);
+
+	template<typename OpenListType>
+	static void BeginSearch(const FNavGrid& grid, FPathSearchContext& context, OpenListType& openList, int32 startIndex, int32 targetIndex);
+
+	//Expands at most maxExpansions cells of a search started with BeginSearch
+	template<typename OpenListType>
+	static EPathSearchStatus Step(const FNavGrid& grid, FPathSearchContext& context, OpenListType& openList, int32 maxExpansions);
+
+	//Walks the parents of a finished search back from the target
+	static void BuildPath(const FPathSearchContext& context, TArray<int32>& outCells, TArray<float>& outCosts);
+};
+
+template<typename OpenListType>
+bool FGridPathfinder::FindPath(const FNavGrid& grid, FPathSearchContext& context, OpenListType& openList, int32 startIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts)
+{
+	outCells.Reset();
+	outCosts.Reset();
+
+	BeginSearch(grid, context, openList, startIndex, targetIndex);
+	if (Step(grid, context, openList, MAX_int32) != EPathSearchStatus::Found) return false;
+
+	BuildPath(context, outCells, outCosts);
+	return true;
+}
+
+template<typename OpenListType>
+void FGridPathfinder::BeginSearch(const FNavGrid& grid, FPathSearchContext& context, OpenListType& openList, int32 startIndex, int32 targetIndex)
+{
+	context.BeginQuery(grid.Num());
+	openList.Reset(grid.Num());
+	context.StartIndex = startIndex;
+	context.TargetIndex = targetIndex;
+	if (!grid.IsValidIndex(startIndex) || !grid.IsValidIndex(targetIndex)) return;
+
+	context.TargetCoordinates = grid.GetCoordinates(targetIndex);
+	float startHCost = GetDistance(grid.GetCoordinates(startIndex), context.TargetCoordinates);
+	context.Visit(startIndex, 0.0f, startHCost, startIndex);
+	openList.Push(startIndex, startHCost, startHCost);
+}
+
+template<typename OpenListType>
+EPathSearchStatus FGridPathfinder::Step(const FNavGrid& grid, FPathSearchContext& context, OpenListType& openList, int32 maxExpansions)
+{
+	for (int32 expansion = 0; expansion < maxExpansions; expansion++)
+	{
+		if (openList.IsEmpty()) return EPathSearchStatus::NotFound;
+
+		int32 currentIndex = openList.Pop();
+		context.Close(currentIndex);
+		context.ExpandedCells++;
+
+		if (currentIndex == context.TargetIndex) return EPathSearchStatus::Found;
+
+		float currentGCost = context.GetGCost(currentIndex);
+		for (FCellNeighbors::FIterator it = grid.GetNeighbors(currentIndex).CreateIterator(); it; ++it)
+		{
+			int32 index = it.GetIndex();
+			if (grid.GetState(index) == ECellState::BLOCKED || context.IsClosed(index)) continue;
+
+			float newGCost = currentGCost + it.GetDistance() + grid.GetMoveCost(index);
+			bool isOpen = context.IsVisited(index);
+			if (!isOpen || context.GetGCost(index) > newGCost)
+			{
+				float hCost = isOpen ? context.GetHCost(index) : GetDistance(grid.GetCoordinates(index), context.TargetCoordinates);
+				context.Visit(index, newGCost, hCost, currentIndex);
+
+				if (isOpen) openList.Update(index, newGCost + hCost, hCost);
+				else openList.Push(index, newGCost + hCost, hCost);
+			}
+		}
+	}
+
+	return openList.IsEmpty() ? EPathSearchStatus::NotFound : EPathSearchStatus::InProgress;
+}
@@ -0,0 +1,429 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HierarchicalPathfinder.h"
+#include "GridPathfinder.h"
+
+//Linked runs along a border at least this long get an entrance at each end instead of one in the middle
+#define LONG_ENTRANCE_LENGTH 6
+
+void FHierarchicalPathfinder::Build(const FNavGrid& grid, int32 clusterSize)
+{
+	Empty();
+	ClusterSize = FMath::Max(clusterSize, 2);
+
+	const FIntVector& cellCount = grid.GetCellCount();
+	ClusterCount = FIntPoint(FMath::DivideAndRoundUp(cellCount.X, ClusterSize), FMath::DivideAndRoundUp(cellCount.Y, ClusterSize));
+	Clusters.SetNum(ClusterCount.X * ClusterCount.Y);
+	for (int32 x = 0; x < ClusterCount.X; x++)
+	{
+		for (int32 y = 0; y < ClusterCount.Y; y++)
+		{
+			FCluster& cluster = Clusters[x * ClusterCount.Y + y];
+			cluster.Min = FIntPoint(x * ClusterSize, y * ClusterSize);
+			cluster.Max = FIntPoint(FMath::Min(cluster.Min.X + ClusterSize, cellCount.X), FMath::Min(cluster.Min.Y + ClusterSize, cellCount.Y));
+		}
+	}
+
+	for (int32 clusterIndex = 0; clusterIndex < Clusters.Num(); clusterIndex++)
+	{
+		RebuildBorder(grid, clusterIndex, 0);
+		RebuildBorder(grid, clusterIndex, 1);
+	}
+	for (int32 clusterIndex = 0; clusterIndex < Clusters.Num(); clusterIndex++)
+	{
+		RebuildEdges(grid, clusterIndex);
+	}
+}
+
+void FHierarchicalPathfinder::Empty()
+{
+	ClusterSize = 0;
+	ClusterCount = FIntPoint::ZeroValue;
+	Clusters.Empty();
+	Nodes.Empty();
+	FreeNodes.Empty();
+	DirtyClusters.Empty();
+}
+
+void FHierarchicalPathfinder::MarkCellChanged(const FNavGrid& grid, int32 cellIndex)
+{
+	if (!IsBuilt() || !grid.IsValidIndex(cellIndex)) return;
+
+	DirtyClusters.Add(GetClusterIndex(grid, cellIndex));
+}
+
+void FHierarchicalPathfinder::RebuildDirtyClusters(const FNavGrid& grid)
+{
+	//Borders are keyed clusterIndex * 2 + axis
+	TSet<int32> borders;
+	TSet<int32> clusters;
+	for (int32 clusterIndex : DirtyClusters)
+	{
+		int32 x = clusterIndex / ClusterCount.Y;
+		int32 y = clusterIndex % ClusterCount.Y;
+
+		borders.Add(clusterIndex * 2);
+		borders.Add(clusterIndex * 2 + 1);
+		if (x > 0) borders.Add((clusterIndex - ClusterCount.Y) * 2);
+		if (y > 0) borders.Add((clusterIndex - 1) * 2 + 1);
+
+		clusters.Add(clusterIndex);
+		if (x > 0) clusters.Add(clusterIndex - ClusterCount.Y);
+		if (x < ClusterCount.X - 1) clusters.Add(clusterIndex + ClusterCount.Y);
+		if (y > 0) clusters.Add(clusterIndex - 1);
+		if (y < ClusterCount.Y - 1) clusters.Add(clusterIndex + 1);
+	}
+	DirtyClusters.Empty();
+
+	for (int32 border : borders) RebuildBorder(grid, border / 2, border % 2);
+	for (int32 clusterIndex : clusters) RebuildEdges(grid, clusterIndex);
+}
+
+bool FHierarchicalPathfinder::FindPath(const FNavGrid& grid, FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outWaypoints) const
+{
+	outWaypoints.Reset();
+	if (!IsBuilt() || !grid.IsValidIndex(startIndex) || !grid.IsValidIndex(targetIndex)) return false;
+	if (startIndex == targetIndex)
+	{
+		outWaypoints.Add(startIndex);
+		return true;
+	}
+	if (grid.GetState(targetIndex) == ECellState::BLOCKED) return false;
+
+	int32 startCluster = GetClusterIndex(grid, startIndex);
+	int32 targetCluster = GetClusterIndex(grid, targetIndex);
+	int32 startNode = Nodes.Num();
+	int32 targetNode = Nodes.Num() + 1;
+	int32 expandedCells = 0;
+
+	//The start and the target are linked to the entrances of their clusters for this query only
+	TArray<FEdge, TInlineAllocator<32>> startEdges;
+	SearchCluster(grid, context, Clusters[startCluster], startIndex, INDEX_NONE, false);
+	expandedCells += context.ExpandedCells;
+	for (int32 node : Clusters[startCluster].Nodes)
+	{
+		int32 localIndex = GetLocalIndex(grid, Clusters[startCluster], Nodes[node].CellIndex);
+		if (context.IsVisited(localIndex)) startEdges.Add({ node, context.GetGCost(localIndex), true });
+	}
+	if (startCluster == targetCluster)
+	{
+		int32 localIndex = GetLocalIndex(grid, Clusters[startCluster], targetIndex);
+		if (context.IsVisited(localIndex)) startEdges.Add({ targetNode, context.GetGCost(localIndex), true });
+	}
+
+	TArray<FEdge, TInlineAllocator<32>> targetEdges;
+	SearchCluster(grid, context, Clusters[targetCluster], targetIndex, INDEX_NONE, true);
+	expandedCells += context.ExpandedCells;
+	for (int32 node : Clusters[targetCluster].Nodes)
+	{
+		int32 localIndex = GetLocalIndex(grid, Clusters[targetCluster], Nodes[node].CellIndex);
+		if (context.IsVisited(localIndex)) targetEdges.Add({ node, context.GetGCost(localIndex), true });
+	}
+
+	//A* over the entrances, the start and the target
+	FIntVector targetCoordinates = grid.GetCoordinates(targetIndex);
+	auto getNodeCell = [&](int32 node) { return node == startNode ? startIndex : (node == targetNode ? targetIndex : Nodes[node].CellIndex); };
+
+	context.BeginQuery(Nodes.Num() + 2);
+	context.StartIndex = startNode;
+	context.TargetIndex = targetNode;
+	float startHCost = FGridPathfinder::GetDistance(grid.GetCoordinates(startIndex), targetCoordinates);
+	context.Visit(startNode, 0.0f, startHCost, startNode);
+	context.OpenCells.Push(startNode, startHCost, startHCost);
+
+	auto relax = [&](int32 fromNode, int32 toNode, float gCost)
+	{
+		if (context.IsClosed(toNode)) return;
+
+		bool isOpen = context.IsVisited(toNode);
+		if (!isOpen || context.GetGCost(toNode) > gCost)
+		{
+			float hCost = isOpen ? context.GetHCost(toNode) : FGridPathfinder::GetDistance(grid.GetCoordinates(getNodeCell(toNode)), targetCoordinates);
+			context.Visit(toNode, gCost, hCost, fromNode);
+
+			if (isOpen) context.OpenCells.Update(toNode, gCost + hCost, hCost);
+			else context.OpenCells.Push(toNode, gCost + hCost, hCost);
+		}
+	};
+
+	while (!context.OpenCells.IsEmpty())
+	{
+		int32 currentNode = context.OpenCells.Pop();
+		context.Close(currentNode);
+		context.ExpandedCells++;
+
+		if (currentNode == targetNode)
+		{
+			for (int32 node = targetNode; node != startNode; node = context.GetParentIndex(node))
+			{
+				//Entrances on two borders of a corner share their cell
+				int32 cellIndex = getNodeCell(node);
+				if (outWaypoints.Num() == 0 || outWaypoints.Last() != cellIndex) outWaypoints.Add(cellIndex);
+			}
+			if (outWaypoints.Last() != startIndex) outWaypoints.Add(startIndex);
+			Algo::Reverse(outWaypoints);
+
+			context.ExpandedCells += expandedCells;
+			return true;
+		}
+
+		float currentGCost = context.GetGCost(currentNode);
+		if (currentNode == startNode)
+		{
+			for (const auto& edge : startEdges) relax(currentNode, edge.Node, currentGCost + edge.Cost);
+			continue;
+		}
+
+		for (const auto& edge : Nodes[currentNode].Edges) relax(currentNode, edge.Node, currentGCost + edge.Cost);
+		if (Nodes[currentNode].Cluster == targetCluster)
+		{
+			for (const auto& edge : targetEdges)
+			{
+				if (edge.Node == currentNode) relax(currentNode, targetNode, currentGCost + edge.Cost);
+			}
+		}
+	}
+
+	context.ExpandedCells += expandedCells;
+	return false;
+}
+
+bool FHierarchicalPathfinder::RefineLeg(const FNavGrid& grid, FPathSearchContext& context, int32 fromIndex, int32 toIndex, float baseCost, TArray<int32>& outCells, TArray<float>& outCosts) const
+{
+	if (!IsBuilt() || !grid.IsValidIndex(fromIndex) || !grid.IsValidIndex(toIndex)) return false;
+	if (fromIndex == toIndex) return true;
+
+	int32 clusterIndex = GetClusterIndex(grid, fromIndex);
+	if (clusterIndex != GetClusterIndex(grid, toIndex))
+	{
+		//Legs between two clusters are the single step across their border
+		if (grid.GetState(toIndex) == ECellState::BLOCKED || !grid.GetNeighbors(fromIndex).Contains(toIndex)) return false;
+
+		outCells.Add(toIndex);
+		outCosts.Add(baseCost + FGridPathfinder::GetDistance(grid.GetCoordinates(fromIndex), grid.GetCoordinates(toIndex)) + grid.GetMoveCost(toIndex));
+		return true;
+	}
+
+	const FCluster& cluster = Clusters[clusterIndex];
+	if (!SearchCluster(grid, context, cluster, fromIndex, toIndex, false)) return false;
+
+	//Appended in walking order, written from the back after counting the cells
+	int32 cellCount = 0;
+	for (int32 localIndex = context.TargetIndex; localIndex != context.StartIndex; localIndex = context.GetParentIndex(localIndex)) cellCount++;
+
+	int32 firstCell = outCells.Num();
+	outCells.AddUninitialized(cellCount);
+	outCosts.AddUninitialized(cellCount);
+	int32 localIndex = context.TargetIndex;
+	for (int32 i = firstCell + cellCount - 1; i >= firstCell; i--)
+	{
+		outCells[i] = GetCellIndex(grid, cluster, localIndex);
+		outCosts[i] = baseCost + context.GetGCost(localIndex);
+		localIndex = context.GetParentIndex(localIndex);
+	}
+	return true;
+}
+
+SIZE_T FHierarchicalPathfinder::GetAllocatedSize() const
+{
+	SIZE_T size = Clusters.GetAllocatedSize() + Nodes.GetAllocatedSize() + FreeNodes.GetAllocatedSize() + DirtyClusters.GetAllocatedSize();
+	for (const auto& cluster : Clusters)
+	{
+		size += cluster.Nodes.GetAllocatedSize() + cluster.BorderNodes[0].GetAllocatedSize() + cluster.BorderNodes[1].GetAllocatedSize();
+	}
+	for (const auto& node : Nodes) size += node.Edges.GetAllocatedSize();
+
+	return size;
+}
+
+int32 FHierarchicalPathfinder::GetClusterIndex(const FNavGrid& grid, int32 cellIndex) const
+{
+	FIntVector coordinates = grid.GetCoordinates(cellIndex);
+	return (coordinates.X / ClusterSize) * ClusterCount.Y + coordinates.Y / ClusterSize;
+}
+
+int32 FHierarchicalPathfinder::GetLocalIndex(const FNavGrid& grid, const FCluster& cluster, int32 cellIndex) const
+{
+	FIntVector coordinates = grid.GetCoordinates(cellIndex);
+	return (coordinates.X - cluster.Min.X) * ClusterSize + coordinates.Y - cluster.Min.Y;
+}
+
+int32 FHierarchicalPathfinder::GetCellIndex(const FNavGrid& grid, const FCluster& cluster, int32 localIndex) const
+{
+	int32 cellIndex = INDEX_NONE;
+	grid.GetIndex(cluster.Min.X + localIndex / ClusterSize, cluster.Min.Y + localIndex % ClusterSize, cellIndex);
+	return cellIndex;
+}
+
+bool FHierarchicalPathfinder::SearchCluster(const FNavGrid& grid, FPathSearchContext& context, const FCluster& cluster, int32 startIndex, int32 targetIndex, bool reverse) const
+{
+	context.BeginQuery(ClusterSize * ClusterSize);
+	context.StartIndex = GetLocalIndex(grid, cluster, startIndex);
+	context.TargetIndex = targetIndex == INDEX_NONE ? INDEX_NONE : GetLocalIndex(grid, cluster, targetIndex);
+	if (targetIndex != INDEX_NONE) context.TargetCoordinates = grid.GetCoordinates(targetIndex);
+
+	auto getHCost = [&](const FIntVector& coordinates) { return targetIndex == INDEX_NONE ? 0.0f : FGridPathfinder::GetDistance(coordinates, context.TargetCoordinates); };
+
+	float startHCost = getHCost(grid.GetCoordinates(startIndex));
+	context.Visit(context.StartIndex, 0.0f, startHCost, context.StartIndex);
+	context.OpenCells.Push(context.StartIndex, startHCost, startHCost);
+
+	while (!context.OpenCells.IsEmpty())
+	{
+		int32 currentLocal = context.OpenCells.Pop();
+		context.Close(currentLocal);
+		context.ExpandedCells++;
+
+		if (currentLocal == context.TargetIndex) return true;
+
+		int32 currentIndex = GetCellIndex(grid, cluster, currentLocal);
+		float currentGCost = context.GetGCost(currentLocal);
+		for (FCellNeighbors::FIterator it = grid.GetNeighbors(currentIndex).CreateIterator(); it; ++it)
+		{
+			int32 index = it.GetIndex();
+			if (grid.GetState(index) == ECellState::BLOCKED) continue;
+
+			FIntVector coordinates = grid.GetCoordinates(index);
+			if (!ContainsCoordinates(cluster, coordinates)) continue;
+
+			int32 localIndex = GetLocalIndex(grid, cluster, index);
+			if (context.IsClosed(localIndex)) continue;
+
+			//Walking back from the start, the cell entered is the current one
+			float newGCost = currentGCost + it.GetDistance() + grid.GetMoveCost(reverse ? currentIndex : index);
+			bool isOpen = context.IsVisited(localIndex);
+			if (!isOpen || context.GetGCost(localIndex) > newGCost)
+			{
+				float hCost = isOpen ? context.GetHCost(localIndex) : getHCost(coordinates);
+				context.Visit(localIndex, newGCost, hCost, currentLocal);
+
+				if (isOpen) context.OpenCells.Update(localIndex, newGCost + hCost, hCost);
+				else context.OpenCells.Push(localIndex, newGCost + hCost, hCost);
+			}
+		}
+	}
+
+	return false;
+}
+
+bool FHierarchicalPathfinder::IsBorderLinked(const FNavGrid& grid, int32 insideIndex, int32 outsideIndex) const
+{
+	return grid.GetState(insideIndex) != ECellState::BLOCKED && grid.GetState(outsideIndex) != ECellState::BLOCKED
+		&& grid.GetNeighbors(insideIndex).Contains(outsideIndex) && grid.GetNeighbors(outsideIndex).Contains(insideIndex);
+}
+
+void FHierarchicalPathfinder::GetBorderCells(const FNavGrid& grid, const FCluster& cluster, int32 axis, int32 offset, int32& outInsideIndex, int32& outOutsideIndex) const
+{
+	if (axis == 0)
+	{
+		grid.GetIndex(cluster.Max.X - 1, cluster.Min.Y + offset, outInsideIndex);
+		grid.GetIndex(cluster.Max.X, cluster.Min.Y + offset, outOutsideIndex);
+	}
+	else
+	{
+		grid.GetIndex(cluster.Min.X + offset, cluster.Max.Y - 1, outInsideIndex);
+		grid.GetIndex(cluster.Min.X + offset, cluster.Max.Y, outOutsideIndex);
+	}
+}
+
+void FHierarchicalPathfinder::RebuildBorder(const FNavGrid& grid, int32 clusterIndex, int32 axis)
+{
+	for (int32 node : Clusters[clusterIndex].BorderNodes[axis]) RemoveNode(node);
+	Clusters[clusterIndex].BorderNodes[axis].Reset();
+
+	int32 neighborX = clusterIndex / ClusterCount.Y + (axis == 0 ? 1 : 0);
+	int32 neighborY = clusterIndex % ClusterCount.Y + (axis == 1 ? 1 : 0);
+	if (neighborX >= ClusterCount.X || neighborY >= ClusterCount.Y) return;
+	int32 neighborIndex = neighborX * ClusterCount.Y + neighborY;
+
+	const FCluster& cluster = Clusters[clusterIndex];
+	int32 borderLength = axis == 0 ? cluster.Max.Y - cluster.Min.Y : cluster.Max.X - cluster.Min.X;
+	int32 runStart = INDEX_NONE;
+	for (int32 offset = 0; offset <= borderLength; offset++)
+	{
+		bool linked = false;
+		if (offset < borderLength)
+		{
+			int32 insideIndex, outsideIndex;
+			GetBorderCells(grid, cluster, axis, offset, insideIndex, outsideIndex);
+			linked = IsBorderLinked(grid, insideIndex, outsideIndex);
+		}
+
+		if (linked && runStart == INDEX_NONE)
+		{
+			runStart = offset;
+		}
+		else if (!linked && runStart != INDEX_NONE)
+		{
+			int32 runEnd = offset - 1;
+			if (runEnd - runStart + 1 < LONG_ENTRANCE_LENGTH)
+			{
+				AddEntrance(grid, clusterIndex, neighborIndex, axis, (runStart + runEnd) / 2);
+			}
+			else
+			{
+				AddEntrance(grid, clusterIndex, neighborIndex, axis, runStart);
+				AddEntrance(grid, clusterIndex, neighborIndex, axis, runEnd);
+			}
+			runStart = INDEX_NONE;
+		}
+	}
+}
+
+void FHierarchicalPathfinder::RebuildEdges(const FNavGrid& grid, int32 clusterIndex)
+{
+	const FCluster& cluster = Clusters[clusterIndex];
+	for (int32 node : cluster.Nodes)
+	{
+		Nodes[node].Edges.RemoveAll([](const FEdge& edge) { return edge.bIntra; });
+	}
+
+	//Only runs on the game thread while no query is running, so the thread context is free
+	FPathSearchContext& context = FPathSearchContext::GetThreadContext();
+	for (int32 node : cluster.Nodes)
+	{
+		SearchCluster(grid, context, cluster, Nodes[node].CellIndex, INDEX_NONE, false);
+		for (int32 otherNode : cluster.Nodes)
+		{
+			if (otherNode == node) continue;
+
+			int32 localIndex = GetLocalIndex(grid, cluster, Nodes[otherNode].CellIndex);
+			if (context.IsVisited(localIndex)) Nodes[node].Edges.Add({ otherNode, context.GetGCost(localIndex), true });
+		}
+	}
+}
+
+void FHierarchicalPathfinder::AddEntrance(const FNavGrid& grid, int32 clusterIndex, int32 neighborIndex, int32 axis, int32 offset)
+{
+	int32 insideIndex, outsideIndex;
+	GetBorderCells(grid, Clusters[clusterIndex], axis, offset, insideIndex, outsideIndex);
+
+	int32 insideNode = AddNode(insideIndex, clusterIndex);
+	int32 outsideNode = AddNode(outsideIndex, neighborIndex);
+	Clusters[clusterIndex].BorderNodes[axis].Add(insideNode);
+	Clusters[clusterIndex].BorderNodes[axis].Add(outsideNode);
+
+	//One straight step, paying for the cell entered
+	Nodes[insideNode].Edges.Add({ outsideNode, 1.0f + grid.GetMoveCost(outsideIndex), false });
+	Nodes[outsideNode].Edges.Add({ insideNode, 1.0f + grid.GetMoveCost(insideIndex), false });
+}
+
+int32 FHierarchicalPathfinder::AddNode(int32 cellIndex, int32 clusterIndex)
+{
+	int32 node = FreeNodes.Num() > 0 ? FreeNodes.Pop(false) : Nodes.AddDefaulted();
+	Nodes[node].CellIndex = cellIndex;
+	Nodes[node].Cluster = clusterIndex;
+	Clusters[clusterIndex].Nodes.Add(node);
+	return node;
+}
+
+void FHierarchicalPathfinder::RemoveNode(int32 node)
+{
+	//Intra edges pointing here are dropped when the cluster edges are rebuilt, the only other edge comes from the node across the border
+	Clusters[Nodes[node].Cluster].Nodes.Remove(node);
+	Nodes[node].CellIndex = INDEX_NONE;
+	Nodes[node].Cluster = INDEX_NONE;
+	Nodes[node].Edges.Reset();
+	FreeNodes.Add(node);
+}
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavGrid.h"
+#include "PathSearchContext.h"
+
+/**
+ * HPA* over an FNavGrid.
+ * The grid is split in square clusters, entrances are placed where two clusters are linked across their border and the
+ * costs between the entrances of each cluster are precomputed. A query only searches that graph and returns the waypoints
+ * of the coarse path, each leg between two waypoints is turned into cells by RefineLeg when it is needed.
+ * Queries only read the graph and can run concurrently, Build and RebuildDirtyClusters must not run while a query is running.
+ */
+class AI_GAME_API FHierarchicalPathfinder
+{
+public:
+	void Build(const FNavGrid& grid, int32 clusterSize);
+	void Empty();
+
+	FORCEINLINE bool IsBuilt() const { return Clusters.Num() > 0; }
+	FORCEINLINE int32 GetClusterSize() const { return ClusterSize; }
+	FORCEINLINE int32 GetClusterCount() const { return Clusters.Num(); }
+	FORCEINLINE int32 GetNodeCount() const { return Nodes.Num() - FreeNodes.Num(); }
+
+	//The cluster of the cell and the clusters sharing a border with it are rebuilt by the next RebuildDirtyClusters
+	void MarkCellChanged(const FNavGrid& grid, int32 cellIndex);
+	FORCEINLINE bool HasDirtyClusters() const { return DirtyClusters.Num() > 0; }
+	void RebuildDirtyClusters(const FNavGrid& grid);
+
+	//Fills outWaypoints with the start, the entrances the coarse path goes through and the target
+	bool FindPath(const FNavGrid& grid, FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outWaypoints) const;
+	//Appends the cells from fromIndex (excluded) to toIndex, two consecutive waypoints, with costs carrying on from baseCost
+	bool RefineLeg(const FNavGrid& grid, FPathSearchContext& context, int32 fromIndex, int32 toIndex, float baseCost, TArray<int32>& outCells, TArray<float>& outCosts) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	struct FEdge
+	{
+		int32 Node = INDEX_NONE;
+		float Cost = 0.0f;
+		//Intra edges link entrances of the same cluster and are recomputed with the cluster, the others cross a border
+		bool bIntra = false;
+	};
+
+	struct FNode
+	{
+		int32 CellIndex = INDEX_NONE;
+		int32 Cluster = INDEX_NONE;
+		TArray<FEdge, TInlineAllocator<8>> Edges;
+	};
+
+	struct FCluster
+	{
+		//Cell coordinates covered by the cluster, Max excluded
+		FIntPoint Min = FIntPoint::ZeroValue;
+		FIntPoint Max = FIntPoint::ZeroValue;
+		TArray<int32> Nodes;
+		//Entrance nodes on both sides of the +X and +Y borders, each border belongs to the cluster before it
+		TArray<int32> BorderNodes[2];
+	};
+
+	int32 GetClusterIndex(const FNavGrid& grid, int32 cellIndex) const;
+	FORCEINLINE bool ContainsCoordinates(const FCluster& cluster, const FIntVector& coordinates) const
+	{
+		return coordinates.X >= cluster.Min.X && coordinates.X < cluster.Max.X && coordinates.Y >= cluster.Min.Y && coordinates.Y < cluster.Max.Y;
+	}
+	//Searches inside a cluster use local indices, so the context only needs ClusterSize * ClusterSize entries
+	int32 GetLocalIndex(const FNavGrid& grid, const FCluster& cluster, int32 cellIndex) const;
+	int32 GetCellIndex(const FNavGrid& grid, const FCluster& cluster, int32 localIndex) const;
+
+	//A* to targetIndex, or Dijkstra over the whole cluster if targetIndex is INDEX_NONE.
+	//In reverse the costs are the ones of walking from each cell to startIndex instead.
+	bool SearchCluster(const FNavGrid& grid, FPathSearchContext& context, const FCluster& cluster, int32 startIndex, int32 targetIndex, bool reverse) const;
+
+	bool IsBorderLinked(const FNavGrid& grid, int32 insideIndex, int32 outsideIndex) const;
+	void GetBorderCells(const FNavGrid& grid, const FCluster& cluster, int32 axis, int32 offset, int32& outInsideIndex, int32& outOutsideIndex) const;
+	void RebuildBorder(const FNavGrid& grid, int32 clusterIndex, int32 axis);
+	void RebuildEdges(const FNavGrid& grid, int32 clusterIndex);
+	void AddEntrance(const FNavGrid& grid, int32 clusterIndex, int32 neighborIndex, int32 axis, int32 offset);
+	int32 AddNode(int32 cellIndex, int32 clusterIndex);
+	void RemoveNode(int32 node);
+
+	int32 ClusterSize = 0;
+	FIntPoint ClusterCount = FIntPoint::ZeroValue;
+	TArray<FCluster> Clusters;
+	TArray<FNode> Nodes;
+	TArray<int32> FreeNodes;
+	TSet<int32> DirtyClusters;
+};
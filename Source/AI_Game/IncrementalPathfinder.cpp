@@ -0,0 +1,229 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "IncrementalPathfinder.h"
+#include "GridPathfinder.h"
+
+bool FIncrementalPathfinder::Replan(const FNavGrid& grid, int32 currentIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts)
+{
+	ExpandedCells = 0;
+	outCells.Reset();
+	outCosts.Reset();
+	if (!grid.IsValidIndex(currentIndex) || !grid.IsValidIndex(targetIndex)) return false;
+
+	//Changes to a large part of the grid are cheaper to search again than to repair
+	bool restart = StartIndex == INDEX_NONE || Generations.Num() != grid.Num() || ChangedCells.Num() > grid.Num() / 4;
+	if (restart)
+	{
+		Start(grid, currentIndex, targetIndex);
+	}
+	else
+	{
+		SetTarget(grid, targetIndex);
+		for (int32 index : ChangedCells)
+		{
+			if (!grid.IsValidIndex(index)) continue;
+
+			UpdateCell(grid, index);
+			for (int32 neighbor : grid.GetNeighbors(index)) UpdateCell(grid, neighbor);
+		}
+		ChangedCells.Reset();
+	}
+
+	ComputeShortestPath(grid);
+	if (BuildPath(grid, currentIndex, outCells, outCosts)) return true;
+	if (restart || GetGCost(TargetIndex) == MAX_flt) return false;
+
+	//The agent is no longer next to the path searched from the start, search again from where it is
+	Start(grid, currentIndex, targetIndex);
+	ComputeShortestPath(grid);
+	return BuildPath(grid, currentIndex, outCells, outCosts);
+}
+
+void FIncrementalPathfinder::Reset()
+{
+	StartIndex = INDEX_NONE;
+	TargetIndex = INDEX_NONE;
+	ChangedCells.Reset();
+}
+
+void FIncrementalPathfinder::Start(const FNavGrid& grid, int32 startIndex, int32 targetIndex)
+{
+	int32 cellCount = grid.Num();
+	if (Generations.Num() != cellCount)
+	{
+		GCosts.SetNumUninitialized(cellCount);
+		Rhs.SetNumUninitialized(cellCount);
+		Generations.Init(0, cellCount);
+		Generation = 0;
+	}
+
+	//Same generation stamps as FPathSearchContext, starting over never clears the arrays
+	if (++Generation == 0)
+	{
+		FMemory::Memzero(Generations.GetData(), Generations.Num() * sizeof(uint32));
+		Generation = 1;
+	}
+
+	OpenCells.Reset(cellCount);
+	ChangedCells.Reset();
+	StartIndex = startIndex;
+	TargetIndex = targetIndex;
+	TargetCoordinates = grid.GetCoordinates(targetIndex);
+	KeyOffset = 0.0f;
+
+	SetCosts(startIndex, MAX_flt, 0.0f);
+	FCellHeapNode key = CalculateKey(grid, startIndex);
+	OpenCells.Push(startIndex, key.FCost, key.HCost);
+}
+
+void FIncrementalPathfinder::SetTarget(const FNavGrid& grid, int32 targetIndex)
+{
+	if (targetIndex == TargetIndex) return;
+
+	FIntVector coordinates = grid.GetCoordinates(targetIndex);
+	KeyOffset += FGridPathfinder::GetDistance(TargetCoordinates, coordinates);
+	TargetIndex = targetIndex;
+	TargetCoordinates = coordinates;
+}
+
+void FIncrementalPathfinder::ComputeShortestPath(const FNavGrid& grid)
+{
+	while (!OpenCells.IsEmpty())
+	{
+		FCellHeapNode oldKey = OpenCells.Top();
+		if (!(oldKey < CalculateKey(grid, TargetIndex)) && GetRhs(TargetIndex) == GetGCost(TargetIndex)) break;
+
+		int32 currentIndex = OpenCells.Pop();
+		ExpandedCells++;
+
+		//Queued before the target moved, its key is only a lower bound
+		FCellHeapNode newKey = CalculateKey(grid, currentIndex);
+		if (oldKey < newKey)
+		{
+			OpenCells.Push(currentIndex, newKey.FCost, newKey.HCost);
+			continue;
+		}
+
+		float gCost = GetGCost(currentIndex);
+		float rhs = GetRhs(currentIndex);
+		if (gCost > rhs)
+		{
+			SetCosts(currentIndex, rhs, rhs);
+		}
+		else
+		{
+			SetCosts(currentIndex, MAX_flt, rhs);
+			UpdateCell(grid, currentIndex);
+		}
+
+		for (int32 index : grid.GetNeighbors(currentIndex)) UpdateCell(grid, index);
+	}
+}
+
+void FIncrementalPathfinder::UpdateCell(const FNavGrid& grid, int32 index)
+{
+	if (index != StartIndex)
+	{
+		float rhs = MAX_flt;
+		for (int32 neighbor : grid.GetNeighbors(index))
+		{
+			float gCost = GetGCost(neighbor);
+			if (gCost < MAX_flt) rhs = FMath::Min(rhs, gCost + GetStepCost(grid, neighbor, index));
+		}
+		SetCosts(index, GetGCost(index), rhs);
+	}
+
+	OpenCells.Remove(index);
+	if (GetGCost(index) != GetRhs(index))
+	{
+		FCellHeapNode key = CalculateKey(grid, index);
+		OpenCells.Push(index, key.FCost, key.HCost);
+	}
+}
+
+bool FIncrementalPathfinder::BuildPath(const FNavGrid& grid, int32 currentIndex, TArray<int32>& outCells, TArray<float>& outCosts) const
+{
+	if (GetGCost(TargetIndex) == MAX_flt) return false;
+
+	//Walk back from the target through the cheapest neighbors
+	TArray<int32> path;
+	path.Add(TargetIndex);
+	while (path.Last() != StartIndex)
+	{
+		int32 index = path.Last();
+		int32 bestIndex = INDEX_NONE;
+		float bestCost = MAX_flt;
+		for (int32 neighbor : grid.GetNeighbors(index))
+		{
+			float gCost = GetGCost(neighbor);
+			if (gCost == MAX_flt) continue;
+
+			float cost = gCost + GetStepCost(grid, neighbor, index);
+			if (cost < bestCost)
+			{
+				bestIndex = neighbor;
+				bestCost = cost;
+			}
+		}
+		if (bestIndex == INDEX_NONE || path.Num() > grid.Num()) return false;
+		path.Add(bestIndex);
+	}
+	Algo::Reverse(path);
+
+	int32 position = path.Find(currentIndex);
+	float cost = 0.0f;
+	if (position == INDEX_NONE)
+	{
+		//Agents cut corners, a path cell next to the agent is close enough. Take the one furthest along.
+		FCellNeighbors neighbors = grid.GetNeighbors(currentIndex);
+		for (int32 i = path.Num() - 1; i >= 0 && position == INDEX_NONE; i--)
+		{
+			if (neighbors.Contains(path[i]) && grid.GetState(path[i]) != ECellState::BLOCKED) position = i;
+		}
+		if (position == INDEX_NONE) return false;
+
+		cost = GetStepCost(grid, currentIndex, path[position]);
+		outCells.Add(path[position]);
+		outCosts.Add(cost);
+	}
+
+	for (int32 i = position + 1; i < path.Num(); i++)
+	{
+		cost += GetStepCost(grid, path[i - 1], path[i]);
+		outCells.Add(path[i]);
+		outCosts.Add(cost);
+	}
+	return true;
+}
+
+void FIncrementalPathfinder::SetCosts(int32 index, float gCost, float rhs)
+{
+	Generations[index] = Generation;
+	GCosts[index] = gCost;
+	Rhs[index] = rhs;
+}
+
+float FIncrementalPathfinder::GetStepCost(const FNavGrid& grid, int32 fromIndex, int32 toIndex) const
+{
+	if (grid.GetState(toIndex) == ECellState::BLOCKED) return MAX_flt;
+
+	return FGridPathfinder::GetDistance(grid.GetCoordinates(fromIndex), grid.GetCoordinates(toIndex)) + grid.GetMoveCost(toIndex);
+}
+
+FCellHeapNode FIncrementalPathfinder::CalculateKey(const FNavGrid& grid, int32 index) const
+{
+	FCellHeapNode key;
+	key.CellIndex = index;
+	float cost = FMath::Min(GetGCost(index), GetRhs(index));
+	if (cost == MAX_flt)
+	{
+		key.FCost = MAX_flt;
+		key.HCost = MAX_flt;
+		return key;
+	}
+
+	key.FCost = cost + FGridPathfinder::GetDistance(grid.GetCoordinates(index), TargetCoordinates) + KeyOffset;
+	key.HCost = cost;
+	return key;
+}
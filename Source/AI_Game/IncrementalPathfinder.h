@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavGrid.h"
+#include "CellHeap.h"
+
+/**
+ * Incremental A* (LPA* with the moving-target key offset of D* Lite) over an FNavGrid.
+ * The search is rooted at the cell the agent was in when it started and keeps its costs between calls to Replan,
+ * so a changed cell or a target that moved a few cells only repairs the part of the search they affect.
+ * It starts over from the agent's cell when the agent is no longer next to the path.
+ * One planner per agent, it only runs on the game thread.
+ */
+class AI_GAME_API FIncrementalPathfinder
+{
+public:
+	//Fills outCells with the path from currentIndex (excluded) to targetIndex and outCosts with the cost to reach each of them
+	bool Replan(const FNavGrid& grid, int32 currentIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts);
+
+	//Queues a changed cell, it is repaired by the next Replan
+	inline void OnCellChanged(int32 cellIndex) { ChangedCells.Add(cellIndex); }
+	//Drops the search, the next Replan starts over
+	void Reset();
+
+	//Cells expanded by the last Replan
+	int32 ExpandedCells = 0;
+	//Frame the planner was last used, the least recently used planners are dropped first
+	uint64 LastUsedFrame = 0;
+
+private:
+	void Start(const FNavGrid& grid, int32 startIndex, int32 targetIndex);
+	void SetTarget(const FNavGrid& grid, int32 targetIndex);
+	void ComputeShortestPath(const FNavGrid& grid);
+	void UpdateCell(const FNavGrid& grid, int32 index);
+	bool BuildPath(const FNavGrid& grid, int32 currentIndex, TArray<int32>& outCells, TArray<float>& outCosts) const;
+
+	FORCEINLINE float GetGCost(int32 index) const { return Generations[index] == Generation ? GCosts[index] : MAX_flt; }
+	FORCEINLINE float GetRhs(int32 index) const { return Generations[index] == Generation ? Rhs[index] : MAX_flt; }
+	void SetCosts(int32 index, float gCost, float rhs);
+	//Cost of stepping from a cell into its neighbor, MAX_flt if the neighbor is blocked
+	float GetStepCost(const FNavGrid& grid, int32 fromIndex, int32 toIndex) const;
+	FCellHeapNode CalculateKey(const FNavGrid& grid, int32 index) const;
+
+	int32 StartIndex = INDEX_NONE;
+	int32 TargetIndex = INDEX_NONE;
+	FIntVector TargetCoordinates;
+	//Sum of the distances the target moved, keeps the keys already queued valid lower bounds
+	float KeyOffset = 0.0f;
+
+	FCellHeap OpenCells;
+	TArray<float> GCosts;
+	TArray<float> Rhs;
+	TArray<uint32> Generations;
+	uint32 Generation = 0;
+	TSet<int32> ChangedCells;
+};
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "JumpPointSearch.h"
+#include "GridPathfinder.h"
+
+bool FJumpPointSearch::FindPath(const FNavGrid& grid, FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts)
+{
+	outCells.Reset();
+	outCosts.Reset();
+
+	context.BeginQuery(grid.Num());
+	context.StartIndex = startIndex;
+	context.TargetIndex = targetIndex;
+	if (!grid.IsValidIndex(startIndex) || !grid.IsValidIndex(targetIndex)) return false;
+
+	context.TargetCoordinates = grid.GetCoordinates(targetIndex);
+	float startHCost = FGridPathfinder::GetDistance(grid.GetCoordinates(startIndex), context.TargetCoordinates);
+	context.Visit(startIndex, 0.0f, startHCost, startIndex);
+	context.OpenCells.Push(startIndex, startHCost, startHCost);
+
+	TArray<FIntPoint, TInlineAllocator<8>> directions;
+	while (!context.OpenCells.IsEmpty())
+	{
+		int32 currentIndex = context.OpenCells.Pop();
+		context.Close(currentIndex);
+		context.ExpandedCells++;
+
+		if (currentIndex == targetIndex)
+		{
+			BuildPath(grid, context, outCells, outCosts);
+			return true;
+		}
+
+		FIntVector coordinates = grid.GetCoordinates(currentIndex);
+		float currentGCost = context.GetGCost(currentIndex);
+		GetDirections(grid, coordinates, grid.GetCoordinates(context.GetParentIndex(currentIndex)), directions);
+
+		for (const auto& direction : directions)
+		{
+			int32 jumpIndex = Jump(grid, coordinates.X, coordinates.Y, direction.X, direction.Y, targetIndex);
+			if (jumpIndex == INDEX_NONE || context.IsClosed(jumpIndex)) continue;
+
+			FIntVector jumpCoordinates = grid.GetCoordinates(jumpIndex);
+			int32 steps = FMath::Max(FMath::Abs(jumpCoordinates.X - coordinates.X), FMath::Abs(jumpCoordinates.Y - coordinates.Y));
+			float newGCost = currentGCost + steps * GetStepCost(grid, direction.X, direction.Y, jumpIndex);
+
+			bool isOpen = context.IsVisited(jumpIndex);
+			if (!isOpen || context.GetGCost(jumpIndex) > newGCost)
+			{
+				float hCost = isOpen ? context.GetHCost(jumpIndex) : FGridPathfinder::GetDistance(jumpCoordinates, context.TargetCoordinates);
+				context.Visit(jumpIndex, newGCost, hCost, currentIndex);
+
+				if (isOpen) context.OpenCells.Update(jumpIndex, newGCost + hCost, hCost);
+				else context.OpenCells.Push(jumpIndex, newGCost + hCost, hCost);
+			}
+		}
+	}
+
+	return false;
+}
+
+bool FJumpPointSearch::IsWalkable(const FNavGrid& grid, int32 x, int32 y)
+{
+	int32 index;
+	return grid.GetIndex(x, y, index) && grid.GetState(index) != ECellState::BLOCKED;
+}
+
+bool FJumpPointSearch::CanStep(const FNavGrid& grid, int32 fromIndex, int32 x, int32 y, int32& outIndex)
+{
+	if (!grid.GetIndex(x, y, outIndex) || grid.GetState(outIndex) == ECellState::BLOCKED) return false;
+
+	//Cells can also be split by a slope that is too steep
+	return grid.GetNeighbors(fromIndex).Contains(outIndex);
+}
+
+bool FJumpPointSearch::HasForcedNeighbor(const FNavGrid& grid, int32 x, int32 y, int32 dx, int32 dy)
+{
+	if (dx != 0 && dy != 0)
+	{
+		return (!IsWalkable(grid, x - dx, y) && IsWalkable(grid, x - dx, y + dy))
+			|| (!IsWalkable(grid, x, y - dy) && IsWalkable(grid, x + dx, y - dy));
+	}
+	else if (dx != 0)
+	{
+		return (!IsWalkable(grid, x, y + 1) && IsWalkable(grid, x + dx, y + 1))
+			|| (!IsWalkable(grid, x, y - 1) && IsWalkable(grid, x + dx, y - 1));
+	}
+	else
+	{
+		return (!IsWalkable(grid, x + 1, y) && IsWalkable(grid, x + 1, y + dy))
+			|| (!IsWalkable(grid, x - 1, y) && IsWalkable(grid, x - 1, y + dy));
+	}
+}
+
+int32 FJumpPointSearch::Jump(const FNavGrid& grid, int32 x, int32 y, int32 dx, int32 dy, int32 targetIndex)
+{
+	int32 currentIndex;
+	if (!grid.GetIndex(x, y, currentIndex)) return INDEX_NONE;
+
+	while (true)
+	{
+		int32 nextIndex;
+		if (!CanStep(grid, currentIndex, x + dx, y + dy, nextIndex)) return INDEX_NONE;
+
+		x += dx;
+		y += dy;
+		if (nextIndex == targetIndex || HasForcedNeighbor(grid, x, y, dx, dy)) return nextIndex;
+
+		//A diagonal move stops wherever one of its straight components finds a jump point
+		if (dx != 0 && dy != 0)
+		{
+			if (Jump(grid, x, y, dx, 0, targetIndex) != INDEX_NONE || Jump(grid, x, y, 0, dy, targetIndex) != INDEX_NONE) return nextIndex;
+		}
+
+		currentIndex = nextIndex;
+	}
+}
+
+void FJumpPointSearch::GetDirections(const FNavGrid& grid, const FIntVector& coordinates, const FIntVector& parentCoordinates, TArray<FIntPoint, TInlineAllocator<8>>& outDirections)
+{
+	outDirections.Reset();
+	int32 x = coordinates.X;
+	int32 y = coordinates.Y;
+	int32 dx = FMath::Sign(x - parentCoordinates.X);
+	int32 dy = FMath::Sign(y - parentCoordinates.Y);
+
+	//The start cell has no parent, every direction is open
+	if (dx == 0 && dy == 0)
+	{
+		for (int32 i = -1; i <= 1; i++)
+		{
+			for (int32 j = -1; j <= 1; j++)
+			{
+				if (i != 0 || j != 0) outDirections.Add(FIntPoint(i, j));
+			}
+		}
+		return;
+	}
+
+	if (dx != 0 && dy != 0)
+	{
+		outDirections.Add(FIntPoint(0, dy));
+		outDirections.Add(FIntPoint(dx, 0));
+		outDirections.Add(FIntPoint(dx, dy));
+		if (!IsWalkable(grid, x - dx, y)) outDirections.Add(FIntPoint(-dx, dy));
+		if (!IsWalkable(grid, x, y - dy)) outDirections.Add(FIntPoint(dx, -dy));
+	}
+	else if (dx != 0)
+	{
+		outDirections.Add(FIntPoint(dx, 0));
+		if (!IsWalkable(grid, x, y + 1)) outDirections.Add(FIntPoint(dx, 1));
+		if (!IsWalkable(grid, x, y - 1)) outDirections.Add(FIntPoint(dx, -1));
+	}
+	else
+	{
+		outDirections.Add(FIntPoint(0, dy));
+		if (!IsWalkable(grid, x + 1, y)) outDirections.Add(FIntPoint(1, dy));
+		if (!IsWalkable(grid, x - 1, y)) outDirections.Add(FIntPoint(-1, dy));
+	}
+}
+
+float FJumpPointSearch::GetStepCost(const FNavGrid& grid, int32 dx, int32 dy, int32 cellIndex)
+{
+	//Same cost A* gives one step: the grid distance plus the move cost of the cell entered
+	return FMath::Abs(dx) + FMath::Abs(dy) + grid.GetMoveCost(cellIndex);
+}
+
+void FJumpPointSearch::BuildPath(const FNavGrid& grid, const FPathSearchContext& context, TArray<int32>& outCells, TArray<float>& outCosts)
+{
+	TArray<int32> jumpPoints;
+	for (int32 index = context.TargetIndex; index != context.StartIndex; index = context.GetParentIndex(index))
+	{
+		jumpPoints.Add(index);
+	}
+	jumpPoints.Add(context.StartIndex);
+
+	//Fill in the straight or diagonal run of cells between each pair of jump points
+	float cost = 0.0f;
+	for (int32 i = jumpPoints.Num() - 1; i > 0; i--)
+	{
+		FIntVector from = grid.GetCoordinates(jumpPoints[i]);
+		FIntVector to = grid.GetCoordinates(jumpPoints[i - 1]);
+		int32 dx = FMath::Sign(to.X - from.X);
+		int32 dy = FMath::Sign(to.Y - from.Y);
+
+		int32 index;
+		for (FIntVector step = from; step != to;)
+		{
+			step.X += dx;
+			step.Y += dy;
+			grid.GetIndex(step.X, step.Y, index);
+			cost += GetStepCost(grid, dx, dy, index);
+			outCells.Add(index);
+			outCosts.Add(cost);
+		}
+	}
+}
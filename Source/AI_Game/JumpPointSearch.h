@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavGrid.h"
+#include "PathSearchContext.h"
+
+/**
+ * Jump Point Search over an FNavGrid with diagonal links.
+ * Only valid while every cell has the same move cost, symmetric paths are then pruned and only jump points go through the open list.
+ * The returned path has every cell between the jump points, the same as FGridPathfinder returns.
+ */
+class AI_GAME_API FJumpPointSearch
+{
+public:
+	static bool FindPath(const FNavGrid& grid, FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts);
+
+private:
+	static bool IsWalkable(const FNavGrid& grid, int32 x, int32 y);
+	static bool CanStep(const FNavGrid& grid, int32 fromIndex, int32 x, int32 y, int32& outIndex);
+	static bool HasForcedNeighbor(const FNavGrid& grid, int32 x, int32 y, int32 dx, int32 dy);
+	//Moves from (x, y) in direction (dx, dy) until it finds a jump point, returns INDEX_NONE if there is none
+	static int32 Jump(const FNavGrid& grid, int32 x, int32 y, int32 dx, int32 dy, int32 targetIndex);
+	static void GetDirections(const FNavGrid& grid, const FIntVector& coordinates, const FIntVector& parentCoordinates, TArray<FIntPoint, TInlineAllocator<8>>& outDirections);
+	static float GetStepCost(const FNavGrid& grid, int32 dx, int32 dy, int32 cellIndex);
+	static void BuildPath(const FNavGrid& grid, const FPathSearchContext& context, TArray<int32>& outCells, TArray<float>& outCosts);
+};
@@ -0,0 +1,362 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavGrid.h"
+
+//Straight and diagonal directions alternate in pairs, FCellNeighbors::FIterator::GetDistance relies on it
+const FIntPoint FNavGrid::DirectionOffsets[NEIGHBOR_DIRECTIONS] = { {-1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 0}, {0, 1}, {1, 1}, {-1, 1} };
+
+void FNavGridChunk::Init(int32 count, float height, float moveCost)
+{
+	Heights.Init(height, count);
+	States.Init(ECellState::FREE, count);
+	MoveCosts.Init(moveCost, count);
+	ModifierPriorities.Init(DEFAULT_MODIFIER_PRIORITY, count);
+	Colors.Init(FNavGrid::GetStateColor(ECellState::FREE), count);
+	NeighborMasks.Init(0, count);
+}
+
+void FNavGridChunk::SetNum(int32 count, float height, float moveCost)
+{
+	int32 keptCount = FMath::Min(States.Num(), count);
+	Heights.SetNum(count);
+	States.SetNum(count);
+	MoveCosts.SetNum(count);
+	ModifierPriorities.SetNum(count);
+	Colors.SetNum(count);
+	NeighborMasks.SetNum(count);
+	for (int32 index = keptCount; index < count; index++)
+	{
+		Heights[index] = height;
+		States[index] = ECellState::FREE;
+		MoveCosts[index] = moveCost;
+		ModifierPriorities[index] = DEFAULT_MODIFIER_PRIORITY;
+		Colors[index] = FNavGrid::GetStateColor(ECellState::FREE);
+		NeighborMasks[index] = 0;
+	}
+}
+
+void FNavGridChunk::Empty()
+{
+	Heights.Empty();
+	States.Empty();
+	MoveCosts.Empty();
+	ModifierPriorities.Empty();
+	Colors.Empty();
+	NeighborMasks.Empty();
+}
+
+SIZE_T FNavGridChunk::GetAllocatedSize() const
+{
+	return Heights.GetAllocatedSize() + States.GetAllocatedSize() + MoveCosts.GetAllocatedSize()
+		+ ModifierPriorities.GetAllocatedSize() + Colors.GetAllocatedSize() + NeighborMasks.GetAllocatedSize();
+}
+
+bool FNavGridChunk::Serialize(FArchive& ar, int32 count)
+{
+	Heights.BulkSerialize(ar);
+	States.BulkSerialize(ar);
+	MoveCosts.BulkSerialize(ar);
+	ModifierPriorities.BulkSerialize(ar);
+	NeighborMasks.BulkSerialize(ar);
+
+	if (!ar.IsLoading()) return true;
+
+	if (ar.IsError() || Heights.Num() != count || States.Num() != count || MoveCosts.Num() != count
+		|| ModifierPriorities.Num() != count || NeighborMasks.Num() != count)
+	{
+		ar.SetError();
+		Empty();
+		return false;
+	}
+
+	Colors.SetNumUninitialized(count);
+	for (int32 index = 0; index < count; index++) Colors[index] = FNavGrid::GetStateColor(States[index]);
+	return true;
+}
+
+void FNavGrid::Init(const FIntVector& cellCount, const FVector& origin, float cellSize, float moveCost, int32 chunkSize)
+{
+	CellCount = FIntVector(FMath::Max(cellCount.X, 0), FMath::Max(cellCount.Y, 0), 1);
+	ColumnNum = CellCount.X * CellCount.Y;
+	CellNum = ColumnNum;
+	LayerStarts.Empty();
+	LayerColumns.Empty();
+	NeighborLayers.Empty();
+	Origin = origin;
+	CellSize = cellSize;
+	BaseMoveCost = moveCost;
+	NonUniformCostCells = 0;
+	UpdateDirectionIndexOffsets();
+
+	Chunks.Empty();
+	if (chunkSize <= 0)
+	{
+		ChunkShift = 0;
+		ChunkCount = FIntPoint(1, 1);
+		LoadedChunkCount = 1;
+		Cells.Init(CellNum, origin.Z, moveCost);
+		return;
+	}
+
+	Cells.Empty();
+	ChunkShift = FMath::Max((int32)FMath::CeilLogTwo((uint32)chunkSize), 1);
+	ChunkCount = FIntPoint(FMath::DivideAndRoundUp(CellCount.X, 1 << ChunkShift), FMath::DivideAndRoundUp(CellCount.Y, 1 << ChunkShift));
+	Chunks.SetNum(ChunkCount.X * ChunkCount.Y);
+	LoadedChunkCount = 0;
+}
+
+void FNavGrid::Empty()
+{
+	CellCount = FIntVector::ZeroValue;
+	CellNum = 0;
+	ColumnNum = 0;
+	LayerStarts.Empty();
+	LayerColumns.Empty();
+	NeighborLayers.Empty();
+	NonUniformCostCells = 0;
+	Cells.Empty();
+	ChunkShift = 0;
+	ChunkCount = FIntPoint::ZeroValue;
+	Chunks.Empty();
+	LoadedChunkCount = 0;
+}
+
+FVector FNavGrid::GetLocation(int32 index) const
+{
+	FIntVector coordinates = GetCoordinates(index);
+	return FVector(Origin.X + CellSize * coordinates.X, Origin.Y + CellSize * coordinates.Y, GetHeight(index));
+}
+
+void FNavGrid::SetHeight(int32 index, float height)
+{
+	int32 localIndex;
+	if (FNavGridChunk* chunk = FindChunk(index, localIndex)) chunk->Heights[localIndex] = height;
+}
+
+void FNavGrid::SetState(int32 index, ECellState state)
+{
+	int32 localIndex;
+	FNavGridChunk* chunk = FindChunk(index, localIndex);
+	if (!chunk) return;
+
+	chunk->States[localIndex] = state;
+	chunk->Colors[localIndex] = GetStateColor(state);
+}
+
+bool FNavGrid::SetCellParameters(int32 index, ECellState state, float moveCost, int32 modifierPriority)
+{
+	if (!IsLoaded(index) || modifierPriority < GetModifierPriority(index)) return false;
+
+	ResetCellParameters(index, state, moveCost, modifierPriority);
+	return true;
+}
+
+void FNavGrid::ResetCellParameters(int32 index, ECellState state, float moveCost, int32 modifierPriority)
+{
+	int32 localIndex;
+	FNavGridChunk* chunk = FindChunk(index, localIndex);
+	if (!chunk) return;
+
+	chunk->ModifierPriorities[localIndex] = modifierPriority;
+	NonUniformCostCells += (moveCost != BaseMoveCost) - (chunk->MoveCosts[localIndex] != BaseMoveCost);
+	chunk->MoveCosts[localIndex] = moveCost;
+	SetState(index, state);
+}
+
+void FNavGrid::SetColor(int32 index, FColor color)
+{
+	int32 localIndex;
+	if (FNavGridChunk* chunk = FindChunk(index, localIndex)) chunk->Colors[localIndex] = color;
+}
+
+void FNavGrid::SetNeighborMask(int32 index, uint8 mask)
+{
+	int32 localIndex;
+	if (FNavGridChunk* chunk = FindChunk(index, localIndex)) chunk->NeighborMasks[localIndex] = mask;
+}
+
+void FNavGrid::SetNeighborLayers(int32 index, uint16 layers)
+{
+	if (IsLayered()) NeighborLayers[index] = layers;
+}
+
+int32 FNavGrid::GetNeighbor(int32 index, int32 offsetX, int32 offsetY) const
+{
+	for (FCellNeighbors::FIterator it = GetNeighbors(index).CreateIterator(); it; ++it)
+	{
+		const FIntPoint& offset = DirectionOffsets[it.GetDirection()];
+		if (offset.X == offsetX && offset.Y == offsetY) return it.GetIndex();
+	}
+	return INDEX_NONE;
+}
+
+void FNavGrid::SetColumnLayers(TArrayView<const uint8> extraLayerCounts)
+{
+	check(!IsChunked() && extraLayerCounts.Num() == ColumnNum);
+
+	//The cells above layer 0 start over
+	for (int32 index = ColumnNum; index < CellNum; index++) NonUniformCostCells -= Cells.MoveCosts[index] != BaseMoveCost;
+	int32 maxLayers = 1;
+	LayerStarts.SetNumUninitialized(ColumnNum + 1);
+	LayerStarts[0] = ColumnNum;
+	for (int32 column = 0; column < ColumnNum; column++)
+	{
+		int32 extraLayers = FMath::Min((int32)extraLayerCounts[column], MAX_CELL_LAYERS - 1);
+		LayerStarts[column + 1] = LayerStarts[column] + extraLayers;
+		maxLayers = FMath::Max(maxLayers, extraLayers + 1);
+	}
+
+	if (maxLayers == 1) LayerStarts.Empty();
+	UpdateLayerColumns();
+	CellCount.Z = maxLayers;
+	Cells.SetNum(CellNum, Origin.Z, BaseMoveCost);
+	//The links of layer 0 still lead to layer 0
+	NeighborLayers.Reset();
+	if (IsLayered()) NeighborLayers.SetNumZeroed(CellNum);
+}
+
+bool FNavGrid::UpdateLayerColumns()
+{
+	LayerColumns.Reset();
+	CellNum = ColumnNum;
+	if (!IsLayered()) return true;
+	if (LayerStarts.Num() != ColumnNum + 1) return false;
+
+	for (int32 column = 0; column < ColumnNum; column++)
+	{
+		int32 extraLayers = LayerStarts[column + 1] - LayerStarts[column];
+		if (LayerStarts[column] != ColumnNum + LayerColumns.Num() || extraLayers < 0 || extraLayers >= MAX_CELL_LAYERS) return false;
+
+		for (int32 layer = 0; layer < extraLayers; layer++) LayerColumns.Add(column);
+	}
+	CellNum = ColumnNum + LayerColumns.Num();
+	return true;
+}
+
+void FNavGrid::GetChunkBounds(int32 chunkIndex, FIntPoint& outMin, FIntPoint& outMax) const
+{
+	int32 chunkSize = GetChunkSize();
+	outMin = FIntPoint(chunkIndex / ChunkCount.Y * chunkSize, chunkIndex % ChunkCount.Y * chunkSize);
+	outMax = FIntPoint(FMath::Min(outMin.X + chunkSize, CellCount.X) - 1, FMath::Min(outMin.Y + chunkSize, CellCount.Y) - 1);
+}
+
+void FNavGrid::LoadChunk(int32 chunkIndex)
+{
+	FNavGridChunk& chunk = GetChunk(chunkIndex);
+	if (chunk.IsLoaded()) return;
+
+	chunk.Init(GetChunkCellCount(), Origin.Z, BaseMoveCost);
+	LoadedChunkCount++;
+}
+
+void FNavGrid::UnloadChunk(int32 chunkIndex)
+{
+	FNavGridChunk& chunk = GetChunk(chunkIndex);
+	if (!chunk.IsLoaded()) return;
+
+	for (float moveCost : chunk.MoveCosts) NonUniformCostCells -= moveCost != BaseMoveCost;
+	chunk.Empty();
+	LoadedChunkCount--;
+}
+
+bool FNavGrid::SerializeChunk(int32 chunkIndex, FArchive& ar)
+{
+	FNavGridChunk& chunk = GetChunk(chunkIndex);
+	if (!ar.IsLoading()) return chunk.IsLoaded() && chunk.Serialize(ar, GetChunkCellCount());
+
+	UnloadChunk(chunkIndex);
+	if (!chunk.Serialize(ar, GetChunkCellCount())) return false;
+
+	for (float moveCost : chunk.MoveCosts) NonUniformCostCells += moveCost != BaseMoveCost;
+	LoadedChunkCount++;
+	return true;
+}
+
+SIZE_T FNavGrid::GetChunkAllocatedSize(int32 chunkIndex) const
+{
+	return GetChunk(chunkIndex).GetAllocatedSize();
+}
+
+SIZE_T FNavGrid::GetAllocatedSize() const
+{
+	SIZE_T size = Cells.GetAllocatedSize() + Chunks.GetAllocatedSize() + LayerStarts.GetAllocatedSize() + LayerColumns.GetAllocatedSize() + NeighborLayers.GetAllocatedSize();
+	for (const FNavGridChunk& chunk : Chunks) size += chunk.GetAllocatedSize();
+	return size;
+}
+
+void FNavGrid::Serialize(FArchive& ar)
+{
+	check(ar.IsLoading() || !IsChunked());
+	ar << CellCount << Origin << CellSize << BaseMoveCost;
+
+	//Layered grids add their layout around the cells, a grid without layers has a single one in CellCount.Z
+	if (!ar.IsLoading())
+	{
+		if (IsLayered()) LayerStarts.BulkSerialize(ar);
+		Cells.Serialize(ar, CellNum);
+		if (IsLayered()) NeighborLayers.BulkSerialize(ar);
+		return;
+	}
+
+	Chunks.Empty();
+	ColumnNum = CellCount.X * CellCount.Y;
+	LayerStarts.Empty();
+	NeighborLayers.Empty();
+	if (CellCount.Z > 1) LayerStarts.BulkSerialize(ar);
+	if (!UpdateLayerColumns() || !Cells.Serialize(ar, CellNum))
+	{
+		Empty();
+		return;
+	}
+	if (IsLayered())
+	{
+		NeighborLayers.BulkSerialize(ar);
+		if (NeighborLayers.Num() != CellNum)
+		{
+			ar.SetError();
+			Empty();
+			return;
+		}
+	}
+
+	//Only the data derived from the cell arrays is rebuilt cell by cell
+	UpdateDirectionIndexOffsets();
+	ChunkShift = 0;
+	ChunkCount = FIntPoint(1, 1);
+	LoadedChunkCount = 1;
+	NonUniformCostCells = 0;
+	for (float moveCost : Cells.MoveCosts) NonUniformCostCells += moveCost != BaseMoveCost;
+}
+
+void FNavGrid::SerializeLayout(FArchive& ar)
+{
+	FIntVector cellCount = CellCount;
+	FVector origin = Origin;
+	float cellSize = CellSize;
+	float moveCost = BaseMoveCost;
+	int32 chunkSize = IsChunked() ? GetChunkSize() : 0;
+	ar << cellCount << origin << cellSize << moveCost << chunkSize;
+
+	if (ar.IsLoading()) Init(cellCount, origin, cellSize, moveCost, chunkSize);
+}
+
+void FNavGrid::UpdateDirectionIndexOffsets()
+{
+	for (int32 direction = 0; direction < NEIGHBOR_DIRECTIONS; direction++)
+	{
+		DirectionIndexOffsets[direction] = DirectionOffsets[direction].X * CellCount.Y + DirectionOffsets[direction].Y;
+	}
+}
+
+FColor FNavGrid::GetStateColor(ECellState state)
+{
+	switch (state)
+	{
+	case FREE: return FColor::Green;
+	case OCCUPIED: return FColor::Yellow;
+	case BLOCKED: return FColor::Red;
+	case DEAD: return FColor::Black;
+	default: return FColor::White;
+	}
+}
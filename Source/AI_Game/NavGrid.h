@@ -0,0 +1,316 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Cell.h"
+
+#define NEIGHBOR_DIRECTIONS 8
+//Walkable surfaces a column of a layered grid can hold, a link picks the layer of the neighbor column with 2 bits
+#define MAX_CELL_LAYERS 4
+
+/**
+ * Neighbors of one cell, read straight from the cell's direction mask.
+ * Copying and iterating it never allocates, the neighbor column is the cell's column plus the grid's offset for each direction.
+ * On layered grids the layer each link leads to in that column is read from 2 bits per direction.
+ * Directions are visited in the order AGridManager::SetCellNeighbors has always added the neighbors in.
+ */
+class FCellNeighbors
+{
+public:
+	class FIterator
+	{
+	public:
+		FORCEINLINE FIterator(int32 column, uint32 mask, const int32* indexOffsets, uint32 layers, const int32* layerStarts)
+			: Column(column), Mask(mask), IndexOffsets(indexOffsets), Layers(layers), LayerStarts(layerStarts) {}
+
+		FORCEINLINE int32 GetDirection() const { return FMath::CountTrailingZeros(Mask); }
+		FORCEINLINE int32 GetIndex() const
+		{
+			int32 direction = GetDirection();
+			int32 column = Column + IndexOffsets[direction];
+			int32 layer = (Layers >> (direction * 2)) & 3;
+			return layer == 0 ? column : LayerStarts[column] + layer - 1;
+		}
+		//Step distance to the neighbor, the one FGridPathfinder::GetDistance gives for adjacent cells
+		FORCEINLINE float GetDistance() const { return GetDirection() & 2 ? 2.0f : 1.0f; }
+
+		FORCEINLINE int32 operator*() const { return GetIndex(); }
+		FORCEINLINE FIterator& operator++() { Mask &= Mask - 1; return *this; }
+		FORCEINLINE explicit operator bool() const { return Mask != 0; }
+		FORCEINLINE bool operator!=(const FIterator& other) const { return Mask != other.Mask; }
+
+	private:
+		int32 Column;
+		uint32 Mask;
+		const int32* IndexOffsets;
+		uint32 Layers;
+		const int32* LayerStarts;
+	};
+
+	//column is the cell index on a grid without layers, whose links all lead to layer 0
+	FORCEINLINE FCellNeighbors(int32 column, uint8 mask, const int32* indexOffsets, uint16 layers = 0, const int32* layerStarts = nullptr)
+		: Column(column), Mask(mask), IndexOffsets(indexOffsets), Layers(layers), LayerStarts(layerStarts) {}
+
+	FORCEINLINE FIterator CreateIterator() const { return FIterator(Column, Mask, IndexOffsets, Layers, LayerStarts); }
+	FORCEINLINE FIterator begin() const { return CreateIterator(); }
+	FORCEINLINE FIterator end() const { return FIterator(Column, 0, IndexOffsets, Layers, LayerStarts); }
+
+	FORCEINLINE int32 Num() const { return FMath::CountBits(Mask); }
+	bool Contains(int32 index) const
+	{
+		for (FIterator it = CreateIterator(); it; ++it)
+		{
+			if (it.GetIndex() == index) return true;
+		}
+		return false;
+	}
+	//Neighbor at the given position of the iteration order
+	int32 operator[](int32 position) const
+	{
+		FIterator it = CreateIterator();
+		while (position-- > 0) ++it;
+		return it.GetIndex();
+	}
+
+private:
+	int32 Column;
+	uint8 Mask;
+	const int32* IndexOffsets;
+	uint16 Layers;
+	const int32* LayerStarts;
+};
+
+//Priority of the cells no modifier was applied to
+#define DEFAULT_MODIFIER_PRIORITY -999
+
+//Cell arrays of one chunk of a split FNavGrid, or of the whole grid when it is not split. Empty while the chunk is unloaded.
+struct AI_GAME_API FNavGridChunk
+{
+	TArray<float> Heights;
+	TArray<TEnumAsByte<ECellState>> States;
+	TArray<float> MoveCosts;
+	TArray<int32> ModifierPriorities;
+	TArray<FColor> Colors;
+	TArray<uint8> NeighborMasks;
+
+	FORCEINLINE bool IsLoaded() const { return States.Num() > 0; }
+	void Init(int32 count, float height, float moveCost);
+	//Keeps the first cells, the ones added get the values Init gives them
+	void SetNum(int32 count, float height, float moveCost);
+	void Empty();
+	SIZE_T GetAllocatedSize() const;
+	//The cell arrays are bulk serialized, the colors are rebuilt from the states. Returns false if what was read doesn't hold count cells.
+	bool Serialize(FArchive& ar, int32 count);
+};
+
+/**
+ * Navigation grid data stored as flat arrays (structure of arrays), all indexed by the cell Index.
+ * Index = x * CellCount.Y + y, the same scheme the UCell objects used.
+ * Cell locations are not stored, they are rebuilt from the coordinates and the cell height.
+ * Adjacency is one byte per cell, a bit for each of the 8 directions a neighbor can be in.
+ * The arrays can be split in square chunks that are loaded and unloaded on their own, the indices stay those of the whole grid.
+ * Cells of an unloaded chunk read as blocked cells without neighbors and ignore changes.
+ * A grid that is not split can hold several walkable surfaces per column, for bridges and floors. Layer 0 of every column is the
+ * cell with the column's index, the cells of the other layers are stored after all the columns, only for the columns that have them.
+ * Cells of every layer share their column's coordinates, GetLayer tells them apart.
+ */
+class AI_GAME_API FNavGrid
+{
+public:
+	//chunkSize > 0 splits the grid in chunks of that many cells a side, rounded up to a power of two, which all start unloaded
+	void Init(const FIntVector& cellCount, const FVector& origin, float cellSize, float moveCost, int32 chunkSize = 0);
+	void Empty();
+
+	FORCEINLINE int32 Num() const { return CellNum; }
+	FORCEINLINE bool IsValidIndex(int32 index) const { return index >= 0 && index < CellNum; }
+	FORCEINLINE const FIntVector& GetCellCount() const { return CellCount; }
+	FORCEINLINE const FVector& GetOrigin() const { return Origin; }
+	FORCEINLINE float GetCellSize() const { return CellSize; }
+	FORCEINLINE float GetBaseMoveCost() const { return BaseMoveCost; }
+
+	//Returns false if the coordinates are outside the grid
+	FORCEINLINE bool GetIndex(int32 x, int32 y, int32& outIndex) const
+	{
+		if (x < 0 || x >= CellCount.X || y < 0 || y >= CellCount.Y) return false;
+		outIndex = x * CellCount.Y + y;
+		return true;
+	}
+	FORCEINLINE bool GetIndex(int32 x, int32 y, int32 layer, int32& outIndex) const
+	{
+		if (!GetIndex(x, y, outIndex) || layer < 0 || layer >= GetLayerCount(outIndex)) return false;
+		outIndex = GetLayerCell(outIndex, layer);
+		return true;
+	}
+	//Coordinates of the cell's column, Z is always 0
+	FORCEINLINE FIntVector GetCoordinates(int32 index) const
+	{
+		int32 column = GetColumn(index);
+		return FIntVector(column / CellCount.Y, column % CellCount.Y, 0);
+	}
+	FVector GetLocation(int32 index) const;
+
+	FORCEINLINE float GetHeight(int32 index) const
+	{
+		int32 localIndex;
+		const FNavGridChunk* chunk = FindChunk(index, localIndex);
+		return chunk ? chunk->Heights[localIndex] : Origin.Z;
+	}
+	void SetHeight(int32 index, float height);
+
+	FORCEINLINE ECellState GetState(int32 index) const
+	{
+		int32 localIndex;
+		const FNavGridChunk* chunk = FindChunk(index, localIndex);
+		return chunk ? (ECellState)chunk->States[localIndex] : ECellState::BLOCKED;
+	}
+	//Sets the state ignoring modifier priorities, used while the grid is being built
+	void SetState(int32 index, ECellState state);
+
+	FORCEINLINE float GetMoveCost(int32 index) const
+	{
+		int32 localIndex;
+		const FNavGridChunk* chunk = FindChunk(index, localIndex);
+		return chunk ? chunk->MoveCosts[localIndex] : BaseMoveCost;
+	}
+	//True while every loaded cell still has the move cost the grid was created with
+	FORCEINLINE bool HasUniformMoveCost() const { return NonUniformCostCells == 0; }
+	FORCEINLINE int32 GetModifierPriority(int32 index) const
+	{
+		int32 localIndex;
+		const FNavGridChunk* chunk = FindChunk(index, localIndex);
+		return chunk ? chunk->ModifierPriorities[localIndex] : DEFAULT_MODIFIER_PRIORITY;
+	}
+	//Only applies the change if modifierPriority is at least the current priority of the cell, returns true if it did
+	bool SetCellParameters(int32 index, ECellState state, float moveCost, int32 modifierPriority);
+	//Sets the parameters ignoring modifier priorities, used to put back a cell an obstacle no longer covers
+	void ResetCellParameters(int32 index, ECellState state, float moveCost, int32 modifierPriority);
+
+	FORCEINLINE FColor GetColor(int32 index) const
+	{
+		int32 localIndex;
+		const FNavGridChunk* chunk = FindChunk(index, localIndex);
+		return chunk ? chunk->Colors[localIndex] : GetStateColor(ECellState::BLOCKED);
+	}
+	void SetColor(int32 index, FColor color);
+
+	FORCEINLINE FCellNeighbors GetNeighbors(int32 index) const
+	{
+		return FCellNeighbors(GetColumn(index), GetNeighborMask(index), DirectionIndexOffsets, IsLayered() ? NeighborLayers[index] : 0, LayerStarts.GetData());
+	}
+	FORCEINLINE uint8 GetNeighborMask(int32 index) const
+	{
+		int32 localIndex;
+		const FNavGridChunk* chunk = FindChunk(index, localIndex);
+		return chunk ? chunk->NeighborMasks[localIndex] : 0;
+	}
+	void SetNeighborMask(int32 index, uint8 mask);
+	//Layer of the neighbor column each link of the cell leads to, 2 bits per direction. Always 0 on a grid without layers.
+	FORCEINLINE uint16 GetNeighborLayers(int32 index) const { return IsLayered() ? NeighborLayers[index] : 0; }
+	void SetNeighborLayers(int32 index, uint16 layers);
+	//Cell the link of index towards the adjacent column at the offset leads to, INDEX_NONE if there is no such link
+	int32 GetNeighbor(int32 index, int32 offsetX, int32 offsetY) const;
+
+	FORCEINLINE bool IsLayered() const { return LayerStarts.Num() > 0; }
+	//Cells of layer 0, one per column
+	FORCEINLINE int32 GetColumnCount() const { return ColumnNum; }
+	FORCEINLINE int32 GetColumn(int32 index) const { return index < ColumnNum ? index : LayerColumns[index - ColumnNum]; }
+	FORCEINLINE int32 GetLayer(int32 index) const { return index < ColumnNum ? 0 : index - LayerStarts[LayerColumns[index - ColumnNum]] + 1; }
+	FORCEINLINE int32 GetLayerCount(int32 column) const { return IsLayered() ? LayerStarts[column + 1] - LayerStarts[column] + 1 : 1; }
+	FORCEINLINE int32 GetLayerCell(int32 column, int32 layer) const { return layer == 0 ? column : LayerStarts[column] + layer - 1; }
+	//Gives each column extraLayerCounts[column] layers above layer 0, at most MAX_CELL_LAYERS in all. The cells of layer 0 are kept and the
+	//new ones are FREE cells at the height of the origin, without neighbors. Only for grids that are not split. No extra layer makes the grid flat again.
+	void SetColumnLayers(TArrayView<const uint8> extraLayerCounts);
+
+	//Coordinate offset of each neighbor direction, in iteration order
+	static const FIntPoint& GetDirectionOffset(int32 direction) { return DirectionOffsets[direction]; }
+
+	FORCEINLINE bool IsChunked() const { return ChunkShift > 0; }
+	//Cells a side of every chunk, a grid that is not split is one chunk
+	FORCEINLINE int32 GetChunkSize() const { return IsChunked() ? 1 << ChunkShift : FMath::Max(CellCount.X, CellCount.Y); }
+	FORCEINLINE const FIntPoint& GetChunkCount() const { return ChunkCount; }
+	FORCEINLINE int32 GetChunkIndex(int32 index) const
+	{
+		if (!IsChunked()) return 0;
+		int32 x = index / CellCount.Y;
+		int32 y = index - x * CellCount.Y;
+		return (x >> ChunkShift) * ChunkCount.Y + (y >> ChunkShift);
+	}
+	//First and last coordinates of the cells of the chunk
+	void GetChunkBounds(int32 chunkIndex, FIntPoint& outMin, FIntPoint& outMax) const;
+	FORCEINLINE bool IsChunkLoaded(int32 chunkIndex) const { return IsChunked() ? Chunks[chunkIndex].IsLoaded() : Cells.IsLoaded(); }
+	FORCEINLINE bool IsLoaded(int32 index) const
+	{
+		int32 localIndex;
+		return FindChunk(index, localIndex) != nullptr;
+	}
+	//Gives the chunk FREE cells at the height of the origin with the base move cost and no neighbors, to be built
+	void LoadChunk(int32 chunkIndex);
+	void UnloadChunk(int32 chunkIndex);
+	//Writes the cells of a loaded chunk, or reads them into the chunk and loads it. Returns false if they could not be read.
+	bool SerializeChunk(int32 chunkIndex, FArchive& ar);
+	SIZE_T GetChunkAllocatedSize(int32 chunkIndex) const;
+	FORCEINLINE int32 GetLoadedChunkCount() const { return LoadedChunkCount; }
+
+	SIZE_T GetAllocatedSize() const;
+	//Writes or reads the whole grid, which must not be split. The cell arrays are bulk serialized and each cell's neighbors are stored as one byte of directions.
+	void Serialize(FArchive& ar);
+	//Writes or reads the size of the grid and of its chunks without any cell, a grid read this way has all its chunks unloaded
+	void SerializeLayout(FArchive& ar);
+
+	static FColor GetStateColor(ECellState state);
+
+private:
+	//Z is the most layers a column has
+	FIntVector CellCount = FIntVector::ZeroValue;
+	int32 CellNum = 0;
+	int32 ColumnNum = 0;
+	FVector Origin = FVector::ZeroVector;
+	float CellSize = 0.0f;
+	float BaseMoveCost = 0.0f;
+	int32 NonUniformCostCells = 0;
+
+	//The cells of a grid that is not split
+	FNavGridChunk Cells;
+	//log2 of the chunk size, 0 if the grid is not split
+	int32 ChunkShift = 0;
+	FIntPoint ChunkCount = FIntPoint::ZeroValue;
+	TArray<FNavGridChunk> Chunks;
+	int32 LoadedChunkCount = 0;
+
+	//Layered grids only: index of the first cell above layer 0 of each column, a column's layers end where the next one's start
+	TArray<int32> LayerStarts;
+	//Column of each cell above layer 0
+	TArray<int32> LayerColumns;
+	TArray<uint16> NeighborLayers;
+	//Rebuilds LayerColumns and the cell count from LayerStarts, returns false if LayerStarts is not a valid layout
+	bool UpdateLayerColumns();
+
+	FORCEINLINE const FNavGridChunk* FindChunk(int32 index, int32& outLocalIndex) const
+	{
+		if (!IsChunked())
+		{
+			outLocalIndex = index;
+			return &Cells;
+		}
+
+		int32 x = index / CellCount.Y;
+		int32 y = index - x * CellCount.Y;
+		int32 mask = (1 << ChunkShift) - 1;
+		outLocalIndex = ((x & mask) << ChunkShift) | (y & mask);
+		const FNavGridChunk& chunk = Chunks[(x >> ChunkShift) * ChunkCount.Y + (y >> ChunkShift)];
+		return chunk.IsLoaded() ? &chunk : nullptr;
+	}
+	FORCEINLINE FNavGridChunk* FindChunk(int32 index, int32& outLocalIndex)
+	{
+		return const_cast<FNavGridChunk*>(static_cast<const FNavGrid*>(this)->FindChunk(index, outLocalIndex));
+	}
+	FNavGridChunk& GetChunk(int32 chunkIndex) { return IsChunked() ? Chunks[chunkIndex] : Cells; }
+	const FNavGridChunk& GetChunk(int32 chunkIndex) const { return IsChunked() ? Chunks[chunkIndex] : Cells; }
+	FORCEINLINE int32 GetChunkCellCount() const { return IsChunked() ? 1 << (ChunkShift * 2) : CellNum; }
+
+	static const FIntPoint DirectionOffsets[NEIGHBOR_DIRECTIONS];
+	//Index offset of each direction for this grid's row length
+	int32 DirectionIndexOffsets[NEIGHBOR_DIRECTIONS] = {};
+	void UpdateDirectionIndexOffsets();
+};
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NavGridAsset.h"
+#include "Serialization/CustomVersion.h"
+
+const FGuid FNavGridAssetVersion::GUID(0x6A3F21C4, 0x4E7B40D9, 0x9C05B8E2, 0x17D4A36F);
+static FCustomVersionRegistration GRegisterNavGridAssetVersion(FNavGridAssetVersion::GUID, FNavGridAssetVersion::LatestVersion, TEXT("NavGridAsset"));
+
+void UNavGridAsset::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	//Changes to the layout of FNavGrid::Serialize need a new FNavGridAssetVersion, older assets are then baked again
+	Ar.UsingCustomVersion(FNavGridAssetVersion::GUID);
+	bool chunked = Grid.IsChunked();
+	if (Ar.CustomVer(FNavGridAssetVersion::GUID) >= FNavGridAssetVersion::ChunkedGrid) Ar << chunked;
+	if (!chunked)
+	{
+		Grid.Serialize(Ar);
+		if (Ar.IsLoading()) ChunkData.Empty();
+		return;
+	}
+
+	Grid.SerializeLayout(Ar);
+	Ar << ChunkData;
+}
+
+void UNavGridAsset::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Grid.GetAllocatedSize());
+	for (const TArray<uint8>& data : ChunkData) CumulativeResourceSize.AddDedicatedSystemMemoryBytes(data.GetAllocatedSize());
+}
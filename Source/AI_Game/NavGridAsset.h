@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "NavGrid.h"
+#include "NavGridAsset.generated.h"
+
+struct FNavGridAssetVersion
+{
+	enum Type
+	{
+		Initial = 0,
+		//Streamed grids store the layout and one compressed blob per chunk
+		ChunkedGrid,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	static const FGuid GUID;
+};
+
+/**
+ * Navigation grid baked offline by AGridManager::BakeGrid.
+ * Holds the finished FNavGrid (heights, states, costs and neighbors) in a compact binary form that loads without tracing the level.
+ * The settings the grid depends on are stored with it, the manager only loads it while they still match its own.
+ * A grid baked for streaming keeps each chunk compressed on its own, the manager reads them as it loads the chunks.
+ */
+UCLASS(BlueprintType)
+class AI_GAME_API UNavGridAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Serialize(FArchive& Ar) override;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	//The whole grid, or only its layout when it is split in chunks
+	FNavGrid Grid;
+	//Cells of each chunk of a split grid as written by FNavGrid::SerializeChunk, zlib compressed
+	TArray<TArray<uint8>> ChunkData;
+
+	UPROPERTY(VisibleAnywhere, Category = "Bake")
+		float SafetyRadius = 0.0f;
+	UPROPERTY(VisibleAnywhere, Category = "Bake")
+		float LineTraceHeight = 0.0f;
+	UPROPERTY(VisibleAnywhere, Category = "Bake")
+		float MaxTraversableSlope = 0.0f;
+	UPROPERTY(VisibleAnywhere, Category = "Bake")
+		bool CanMoveOnDiagonals = false;
+	UPROPERTY(VisibleAnywhere, Category = "Bake")
+		int32 MaxCellLayers = 1;
+	UPROPERTY(VisibleAnywhere, Category = "Bake")
+		float MinLayerClearance = 0.0f;
+	//Only shown in the editor, the grid itself is not a property
+	UPROPERTY(VisibleAnywhere, Category = "Bake")
+		int32 CellCount = 0;
+};
@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NearestCellIndex.h"
+
+//Past this many separate boxes the changes are rebuilt as the one box around all of them
+#define MAX_DIRTY_BOXES 16
+
+void FNearestCellIndex::Build(const FNavGrid& grid, int32 radius)
+{
+	Radius = FMath::Max(radius, 1);
+	NearestCells.SetNumUninitialized(grid.Num());
+	ClearDirtyCells();
+	if (grid.Num() == 0) return;
+
+	const FIntVector& cellCount = grid.GetCellCount();
+	Propagate(grid, FIntPoint(0, 0), FIntPoint(cellCount.X - 1, cellCount.Y - 1));
+}
+
+void FNearestCellIndex::Empty()
+{
+	Radius = 0;
+	NearestCells.Empty();
+	ClearDirtyCells();
+}
+
+void FNearestCellIndex::ClearDirtyCells()
+{
+	DirtyBoxes.Reset();
+}
+
+void FNearestCellIndex::MarkCellChanged(const FNavGrid& grid, int32 cellIndex)
+{
+	if (!IsBuilt() || !grid.IsValidIndex(cellIndex)) return;
+
+	FIntVector coordinates = grid.GetCoordinates(cellIndex);
+	FDirtyBox box = { FIntPoint(coordinates.X, coordinates.Y), FIntPoint(coordinates.X, coordinates.Y) };
+	//Merging a box can bring it close to one already passed over, go again until none is left
+	int32 gap = 2 * Radius + 1;
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (int32 i = DirtyBoxes.Num() - 1; i >= 0; i--)
+		{
+			const FDirtyBox& other = DirtyBoxes[i];
+			if (other.Min.X - box.Max.X > gap || box.Min.X - other.Max.X > gap || other.Min.Y - box.Max.Y > gap || box.Min.Y - other.Max.Y > gap) continue;
+
+			box.Min = FIntPoint(FMath::Min(box.Min.X, other.Min.X), FMath::Min(box.Min.Y, other.Min.Y));
+			box.Max = FIntPoint(FMath::Max(box.Max.X, other.Max.X), FMath::Max(box.Max.Y, other.Max.Y));
+			DirtyBoxes.RemoveAtSwap(i, 1, false);
+			merged = true;
+		}
+	}
+	DirtyBoxes.Add(box);
+
+	if (DirtyBoxes.Num() > MAX_DIRTY_BOXES)
+	{
+		for (const FDirtyBox& other : DirtyBoxes)
+		{
+			box.Min = FIntPoint(FMath::Min(box.Min.X, other.Min.X), FMath::Min(box.Min.Y, other.Min.Y));
+			box.Max = FIntPoint(FMath::Max(box.Max.X, other.Max.X), FMath::Max(box.Max.Y, other.Max.Y));
+		}
+		DirtyBoxes.Reset();
+		DirtyBoxes.Add(box);
+	}
+}
+
+void FNearestCellIndex::RebuildDirtyCells(const FNavGrid& grid)
+{
+	if (!HasDirtyCells()) return;
+
+	//A cell's nearest cell is never further than the radius, so only the cells that close to a changed one can get another.
+	//The cells around the box keep theirs and are where the passes take the nearest cells from outside of it.
+	const FIntVector& cellCount = grid.GetCellCount();
+	for (const FDirtyBox& box : DirtyBoxes)
+	{
+		FIntPoint min(FMath::Max(box.Min.X - Radius, 0), FMath::Max(box.Min.Y - Radius, 0));
+		FIntPoint max(FMath::Min(box.Max.X + Radius, cellCount.X - 1), FMath::Min(box.Max.Y + Radius, cellCount.Y - 1));
+		Propagate(grid, min, max);
+	}
+	ClearDirtyCells();
+}
+
+void FNearestCellIndex::Propagate(const FNavGrid& grid, const FIntPoint& min, const FIntPoint& max)
+{
+	int32 column;
+	for (int32 x = min.X; x <= max.X; x++)
+	{
+		for (int32 y = min.Y; y <= max.Y; y++)
+		{
+			if (!grid.GetIndex(x, y, column)) continue;
+
+			for (int32 layer = 0; layer < grid.GetLayerCount(column); layer++)
+			{
+				int32 index = grid.GetLayerCell(column, layer);
+				NearestCells[index] = grid.GetState(index) != ECellState::BLOCKED ? index : INDEX_NONE;
+			}
+		}
+	}
+
+	//Columns are stored x major, the forward pass reads the columns before the cell in that order and the backward pass the ones after it
+	static const FIntPoint forwardOffsets[] = { FIntPoint(-1, -1), FIntPoint(-1, 0), FIntPoint(-1, 1), FIntPoint(0, -1) };
+	auto propagateColumn = [&](int32 x, int32 y, int32 offsetSign)
+	{
+		if (!grid.GetIndex(x, y, column)) return;
+
+		FIntPoint coordinates(x, y);
+		int32 layerCount = grid.GetLayerCount(column);
+		for (int32 layer = 0; layer < layerCount; layer++)
+		{
+			int32 index = grid.GetLayerCell(column, layer);
+			if (NearestCells[index] == index) continue;
+
+			float distanceSquared = NearestCells[index] == INDEX_NONE ? MAX_flt : FVector::DistSquared(grid.GetLocation(index), grid.GetLocation(NearestCells[index]));
+			for (const FIntPoint& offset : forwardOffsets)
+			{
+				PropagateFromColumn(grid, index, coordinates, x + offset.X * offsetSign, y + offset.Y * offsetSign, distanceSquared);
+			}
+			//The other floors of the column, for a cell with no walkable cell left around it on its own
+			PropagateFromColumn(grid, index, coordinates, x, y, distanceSquared);
+		}
+	};
+
+	for (int32 x = min.X; x <= max.X; x++)
+	{
+		for (int32 y = min.Y; y <= max.Y; y++) propagateColumn(x, y, 1);
+	}
+	for (int32 x = max.X; x >= min.X; x--)
+	{
+		for (int32 y = max.Y; y >= min.Y; y--) propagateColumn(x, y, -1);
+	}
+}
+
+void FNearestCellIndex::PropagateFromColumn(const FNavGrid& grid, int32 index, const FIntPoint& coordinates, int32 neighborX, int32 neighborY, float& inOutDistanceSquared)
+{
+	int32 neighborColumn;
+	if (!grid.GetIndex(neighborX, neighborY, neighborColumn)) return;
+
+	FVector location = grid.GetLocation(index);
+	for (int32 layer = 0; layer < grid.GetLayerCount(neighborColumn); layer++)
+	{
+		int32 nearestIndex = NearestCells[grid.GetLayerCell(neighborColumn, layer)];
+		if (nearestIndex == INDEX_NONE || nearestIndex == NearestCells[index]) continue;
+
+		FIntVector nearestCoordinates = grid.GetCoordinates(nearestIndex);
+		if (FMath::Square(nearestCoordinates.X - coordinates.X) + FMath::Square(nearestCoordinates.Y - coordinates.Y) > Radius * Radius) continue;
+
+		float distanceSquared = FVector::DistSquared(location, grid.GetLocation(nearestIndex));
+		if (distanceSquared < inOutDistanceSquared)
+		{
+			NearestCells[index] = nearestIndex;
+			inOutDistanceSquared = distanceSquared;
+		}
+	}
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavGrid.h"
+
+/**
+ * Nearest walkable cell of every cell, so a location next to a wall or on a blocked cell is snapped to a cell a path
+ * can start or end on in O(1).
+ * Build runs a two pass distance transform over the cell states that carries the index of the nearest walkable cell
+ * instead of a distance, which can be a fraction of a cell off the exact nearest one. Distances are measured between the
+ * cell locations, so on a layered grid a cell keeps to the walkable cells of its own floor.
+ * Cells with no walkable cell within the radius get INDEX_NONE, and changed cells only get the cells within the radius
+ * around them recomputed. Changes far apart are kept in separate boxes, so two doors opening on opposite sides of the map
+ * don't rebuild everything in between.
+ */
+class AI_GAME_API FNearestCellIndex
+{
+public:
+	void Build(const FNavGrid& grid, int32 radius);
+	void Empty();
+
+	FORCEINLINE bool IsBuilt() const { return NearestCells.Num() > 0; }
+	FORCEINLINE int32 Num() const { return NearestCells.Num(); }
+	FORCEINLINE int32 GetRadius() const { return Radius; }
+	//Walkable cells are their own nearest cell
+	FORCEINLINE int32 GetNearestCell(int32 index) const { return NearestCells.IsValidIndex(index) ? NearestCells[index] : INDEX_NONE; }
+
+	//The cells within the radius of the cell are recomputed by the next RebuildDirtyCells
+	void MarkCellChanged(const FNavGrid& grid, int32 cellIndex);
+	FORCEINLINE bool HasDirtyCells() const { return DirtyBoxes.Num() > 0; }
+	void RebuildDirtyCells(const FNavGrid& grid);
+
+	SIZE_T GetAllocatedSize() const { return NearestCells.GetAllocatedSize(); }
+
+private:
+	//Resets the columns in the box and runs both passes over them, the cells around the box are read as they are
+	void Propagate(const FNavGrid& grid, const FIntPoint& min, const FIntPoint& max);
+	//Keeps the nearest cell of the neighbor column's cells if it is closer to the cell than the one it has
+	void PropagateFromColumn(const FNavGrid& grid, int32 index, const FIntPoint& coordinates, int32 neighborX, int32 neighborY, float& inOutDistanceSquared);
+	void ClearDirtyCells();
+
+	int32 Radius = 0;
+	TArray<int32> NearestCells;
+	//Columns changed since the last rebuild. Boxes whose rebuilt areas would touch are merged into one.
+	struct FDirtyBox
+	{
+		FIntPoint Min;
+		FIntPoint Max;
+	};
+	TArray<FDirtyBox> DirtyBoxes;
+};
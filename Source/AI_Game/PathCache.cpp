@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PathCache.h"
+#include "GridPathfinder.h"
+
+//Rough cost of one cell in CellEntries
+#define CELL_ENTRY_BYTES 16
+
+bool FPathCache::Find(int32 startIndex, int32 goalIndex, uint32 flags, TArray<int32>& outCells, TArray<float>& outCosts)
+{
+	if (const int32* id = EntryIds.Find({ startIndex, goalIndex, flags }))
+	{
+		const FEntry& entry = Entries[*id];
+		outCells.Reset(entry.Cells.Num());
+		outCells.Append(entry.Cells);
+		outCosts.Reset(entry.Costs.Num());
+		outCosts.Append(entry.Costs);
+		Unlink(*id);
+		Link(*id);
+		Stats.Hits++;
+		return true;
+	}
+
+	TArray<int32, TInlineAllocator<16>> ids;
+	CellEntries.MultiFind(startIndex, ids);
+	for (int32 id : ids)
+	{
+		const FEntry& entry = Entries[id];
+		if (entry.Key.GoalIndex != goalIndex || entry.Key.Flags != flags) continue;
+
+		//The start is excluded from the cells, the rest of the path begins right after it
+		int32 position = entry.Cells.Find(startIndex);
+		float startCost = entry.Costs[position];
+		outCells.Reset(entry.Cells.Num() - position - 1);
+		outCosts.Reset(entry.Cells.Num() - position - 1);
+		for (int32 i = position + 1; i < entry.Cells.Num(); i++)
+		{
+			outCells.Add(entry.Cells[i]);
+			outCosts.Add(entry.Costs[i] - startCost);
+		}
+		Unlink(id);
+		Link(id);
+		Stats.SuffixHits++;
+		return true;
+	}
+
+	Stats.Misses++;
+	return false;
+}
+
+void FPathCache::Add(const FNavGrid& grid, int32 startIndex, int32 goalIndex, uint32 flags, const TArray<int32>& cells, const TArray<float>& costs)
+{
+	if (cells.Num() == 0 || cells.Num() != costs.Num() || cells.Last() != goalIndex) return;
+	if (!IsValidPath(grid, startIndex, cells, costs)) return;
+
+	FKey key = { startIndex, goalIndex, flags };
+	if (const int32* existingId = EntryIds.Find(key)) Remove(*existingId);
+
+	SIZE_T bytes = sizeof(FEntry) + cells.Num() * (sizeof(int32) + sizeof(float) + CELL_ENTRY_BYTES);
+	if (bytes > MaxBytes) return;
+	while (UsedBytes + bytes > MaxBytes && Oldest != INDEX_NONE)
+	{
+		Remove(Oldest);
+		Stats.Evictions++;
+	}
+
+	int32 id = Entries.Add(FEntry());
+	FEntry& entry = Entries[id];
+	entry.Key = key;
+	entry.Cells = cells;
+	entry.Costs = costs;
+	entry.Bytes = bytes;
+	EntryIds.Add(key, id);
+	for (int32 index : cells) CellEntries.Add(index, id);
+	UsedBytes += bytes;
+	Link(id);
+}
+
+void FPathCache::OnCellChanged(const FNavGrid& grid, int32 cellIndex)
+{
+	OnCellsChanged(grid, TArrayView<const int32>(&cellIndex, 1));
+}
+
+void FPathCache::OnCellsChanged(const FNavGrid& grid, TArrayView<const int32> cellIndices)
+{
+	//The paths over the cells may no longer be walkable or cost what they did
+	TArray<int32, TInlineAllocator<16>> ids;
+	FIntPoint min(MAX_int32, MAX_int32);
+	FIntPoint max(MIN_int32, MIN_int32);
+	for (int32 cellIndex : cellIndices)
+	{
+		CellEntries.MultiFind(cellIndex, ids);
+		for (int32 id : ids)
+		{
+			Remove(id);
+			Stats.Invalidations++;
+		}
+		ids.Reset();
+
+		//A blocked cell can't make any path shorter, a cell that can be walked may now be a shortcut
+		if (!grid.IsValidIndex(cellIndex) || grid.GetState(cellIndex) == ECellState::BLOCKED) continue;
+
+		FIntVector coordinates = grid.GetCoordinates(cellIndex);
+		min = FIntPoint(FMath::Min(min.X, coordinates.X), FMath::Min(min.Y, coordinates.Y));
+		max = FIntPoint(FMath::Max(max.X, coordinates.X), FMath::Max(max.Y, coordinates.Y));
+	}
+	if (min.X > max.X) return;
+
+	for (auto it = Entries.CreateConstIterator(); it; ++it)
+	{
+		if (GetCostBoundThrough(grid, *it, min, max) < it->Costs.Last()) ids.Add(it.GetIndex());
+	}
+	for (int32 id : ids)
+	{
+		Remove(id);
+		Stats.Invalidations++;
+	}
+}
+
+void FPathCache::Empty()
+{
+	Entries.Empty();
+	EntryIds.Empty();
+	CellEntries.Empty();
+	Newest = INDEX_NONE;
+	Oldest = INDEX_NONE;
+	UsedBytes = 0;
+}
+
+void FPathCache::SetMaxBytes(SIZE_T maxBytes)
+{
+	MaxBytes = maxBytes;
+	while (UsedBytes > MaxBytes && Oldest != INDEX_NONE)
+	{
+		Remove(Oldest);
+		Stats.Evictions++;
+	}
+}
+
+bool FPathCache::IsValidPath(const FNavGrid& grid, int32 startIndex, const TArray<int32>& cells, const TArray<float>& costs) const
+{
+	if (!grid.IsValidIndex(startIndex)) return false;
+
+	int32 previousIndex = startIndex;
+	float previousCost = 0.0f;
+	for (int32 i = 0; i < cells.Num(); i++)
+	{
+		int32 index = cells[i];
+		if (!grid.IsValidIndex(index) || grid.GetState(index) == ECellState::BLOCKED || !grid.GetNeighbors(previousIndex).Contains(index)) return false;
+
+		float cost = previousCost + FGridPathfinder::GetDistance(grid.GetCoordinates(previousIndex), grid.GetCoordinates(index)) + grid.GetMoveCost(index);
+		if (!FMath::IsNearlyEqual(costs[i], cost, FMath::Max(cost, 1.0f) * 1e-4f)) return false;
+
+		previousIndex = index;
+		previousCost = costs[i];
+	}
+	return true;
+}
+
+float FPathCache::GetCostBoundThrough(const FNavGrid& grid, const FEntry& entry, const FIntPoint& min, const FIntPoint& max) const
+{
+	FIntVector start = grid.GetCoordinates(entry.Key.StartIndex);
+	FIntVector goal = grid.GetCoordinates(entry.Key.GoalIndex);
+	//No cell of the box is closer to the start or to the goal than the cell of the box nearest to each
+	FIntVector nearStart(FMath::Clamp(start.X, min.X, max.X), FMath::Clamp(start.Y, min.Y, max.Y), 0);
+	FIntVector nearGoal(FMath::Clamp(goal.X, min.X, max.X), FMath::Clamp(goal.Y, min.Y, max.Y), 0);
+
+	//Every step pays its grid distance plus the move cost of the cell it enters, and no path takes fewer steps than with diagonals
+	int32 steps = FMath::Max(FMath::Abs(nearStart.X - start.X), FMath::Abs(nearStart.Y - start.Y)) + FMath::Max(FMath::Abs(goal.X - nearGoal.X), FMath::Abs(goal.Y - nearGoal.Y));
+	steps = FMath::Max(steps, FMath::Max(FMath::Abs(goal.X - start.X), FMath::Abs(goal.Y - start.Y)));
+	float distance = FMath::Max(FGridPathfinder::GetDistance(start, nearStart) + FGridPathfinder::GetDistance(nearGoal, goal), FGridPathfinder::GetDistance(start, goal));
+	float minMoveCost = grid.HasUniformMoveCost() ? grid.GetBaseMoveCost() : 0.0f;
+	return distance + steps * minMoveCost;
+}
+
+void FPathCache::Link(int32 id)
+{
+	FEntry& entry = Entries[id];
+	entry.Newer = INDEX_NONE;
+	entry.Older = Newest;
+	if (Newest != INDEX_NONE) Entries[Newest].Newer = id;
+	Newest = id;
+	if (Oldest == INDEX_NONE) Oldest = id;
+}
+
+void FPathCache::Unlink(int32 id)
+{
+	FEntry& entry = Entries[id];
+	if (entry.Newer != INDEX_NONE) Entries[entry.Newer].Older = entry.Older;
+	else Newest = entry.Older;
+	if (entry.Older != INDEX_NONE) Entries[entry.Older].Newer = entry.Newer;
+	else Oldest = entry.Newer;
+	entry.Newer = INDEX_NONE;
+	entry.Older = INDEX_NONE;
+}
+
+void FPathCache::Remove(int32 id)
+{
+	Unlink(id);
+	FEntry& entry = Entries[id];
+	for (int32 index : entry.Cells) CellEntries.RemoveSingle(index, id);
+	EntryIds.Remove(entry.Key);
+	UsedBytes -= entry.Bytes;
+	Entries.RemoveAt(id);
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavGrid.h"
+
+struct FPathCacheStats
+{
+	int64 Hits = 0;
+	//Queries answered with the end of a cached path, the start cell was on it
+	int64 SuffixHits = 0;
+	int64 Misses = 0;
+	//Paths dropped because a cell changed
+	int64 Invalidations = 0;
+	//Paths dropped to stay under the memory budget
+	int64 Evictions = 0;
+};
+
+/**
+ * Least recently used cache of found paths, keyed by start cell, goal cell and the flags of the search (movement rules, algorithm).
+ * A query whose start cell lies on a cached path to the same goal gets the rest of that path, every part of a shortest path is one.
+ * A changed cell only drops the paths that walk over it and the ones it could now make shorter.
+ * Game thread only.
+ */
+class AI_GAME_API FPathCache
+{
+public:
+	//Fills outCells and outCosts like FGridPathfinder::FindPath, returns false on a miss
+	bool Find(int32 startIndex, int32 goalIndex, uint32 flags, TArray<int32>& outCells, TArray<float>& outCosts);
+	//Paths that don't match the grid any more (the grid changed while they were searched) are not kept
+	void Add(const FNavGrid& grid, int32 startIndex, int32 goalIndex, uint32 flags, const TArray<int32>& cells, const TArray<float>& costs);
+
+	//Call after the cell changed
+	void OnCellChanged(const FNavGrid& grid, int32 cellIndex);
+	//Call after the cells changed, each cached path is checked once against all of them
+	void OnCellsChanged(const FNavGrid& grid, TArrayView<const int32> cellIndices);
+	void Empty();
+
+	void SetMaxBytes(SIZE_T maxBytes);
+	FORCEINLINE int32 Num() const { return Entries.Num(); }
+	FORCEINLINE SIZE_T GetUsedBytes() const { return UsedBytes; }
+	FORCEINLINE const FPathCacheStats& GetStats() const { return Stats; }
+	FORCEINLINE void ResetStats() { Stats = FPathCacheStats(); }
+
+private:
+	struct FKey
+	{
+		int32 StartIndex;
+		int32 GoalIndex;
+		uint32 Flags;
+
+		FORCEINLINE bool operator==(const FKey& other) const { return StartIndex == other.StartIndex && GoalIndex == other.GoalIndex && Flags == other.Flags; }
+		friend FORCEINLINE uint32 GetTypeHash(const FKey& key) { return HashCombine(HashCombine(GetTypeHash(key.StartIndex), GetTypeHash(key.GoalIndex)), GetTypeHash(key.Flags)); }
+	};
+
+	struct FEntry
+	{
+		FKey Key;
+		TArray<int32> Cells;
+		TArray<float> Costs;
+		SIZE_T Bytes = 0;
+		//Neighbors in the recently used list, towards Newest and towards Oldest
+		int32 Newer = INDEX_NONE;
+		int32 Older = INDEX_NONE;
+	};
+
+	bool IsValidPath(const FNavGrid& grid, int32 startIndex, const TArray<int32>& cells, const TArray<float>& costs) const;
+	//Lowest cost a path from the entry's start to its goal through a cell of the box of coordinates could have
+	float GetCostBoundThrough(const FNavGrid& grid, const FEntry& entry, const FIntPoint& min, const FIntPoint& max) const;
+	void Link(int32 id);
+	void Unlink(int32 id);
+	void Remove(int32 id);
+
+	TSparseArray<FEntry> Entries;
+	TMap<FKey, int32> EntryIds;
+	//Entries walking over each cell, the start cell excluded
+	TMultiMap<int32, int32> CellEntries;
+	int32 Newest = INDEX_NONE;
+	int32 Oldest = INDEX_NONE;
+
+	SIZE_T UsedBytes = 0;
+	SIZE_T MaxBytes = 256 * 1024;
+	FPathCacheStats Stats;
+};
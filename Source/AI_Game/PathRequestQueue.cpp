@@ -0,0 +1,310 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PathRequestQueue.h"
+#include "Async/Async.h"
+#include "GridPathfinder.h"
+
+//Cells expanded between two checks of the time budget
+#define EXPANSIONS_PER_SLICE 64
+//Result buffers kept for reuse
+#define MAX_FREE_RESULTS 64
+
+void FPathRequestQueue::Initialize(const FNavGrid* grid, FPathSearchFunction searchFunction, FPathMissingChunksFunction missingChunksFunction)
+{
+	Grid = grid;
+	SearchFunction = MoveTemp(searchFunction);
+	MissingChunksFunction = MoveTemp(missingChunksFunction);
+}
+
+int32 FPathRequestQueue::Request(const UObject* requester, int32 startIndex, int32 targetIndex, bool bHold)
+{
+	FRequestPtr request = CreateRequest(requester, startIndex, targetIndex);
+	if (!request.IsValid()) return RequesterHandles.FindRef(requester);
+
+	if (bHold) Held.Add(request);
+	else Waiting.Add(request);
+	return request->Handle;
+}
+
+void FPathRequestQueue::Release(int32 handle)
+{
+	int32 position = Held.IndexOfByPredicate([handle](const FRequestPtr& request) { return request->Handle == handle; });
+	if (position == INDEX_NONE) return;
+
+	Waiting.Add(Held[position]);
+	Held.RemoveAt(position);
+}
+
+bool FPathRequestQueue::Requeue(FPathRequestResult& result)
+{
+	if (result.Requester && RequesterHandles.Contains(result.Requester)) return false;
+
+	FRequestPtr request = MakeShared<FRequest, ESPMode::ThreadSafe>();
+	request->Handle = result.Handle;
+	request->Requester = result.Requester;
+	request->StartIndex = result.StartIndex;
+	request->TargetIndex = result.TargetIndex;
+	request->Result = MoveTemp(result);
+	request->Result.bFound = false;
+	request->Result.Cells.Reset();
+	request->Result.Costs.Reset();
+	request->Result.Waypoints.Reset();
+	request->Result.MissingChunks.Reset();
+	request->Result.GridChangeCount = GridChangeCount;
+
+	if (request->Requester) RequesterHandles.Add(request->Requester, request->Handle);
+	Held.Add(request);
+	return true;
+}
+
+int32 FPathRequestQueue::RequestFound(const UObject* requester, int32 startIndex, int32 targetIndex, const TArray<int32>& cells, const TArray<float>& costs)
+{
+	FRequestPtr request = CreateRequest(requester, startIndex, targetIndex);
+	if (!request.IsValid()) return RequesterHandles.FindRef(requester);
+
+	request->Result.bFound = true;
+	request->Result.bFromCache = true;
+	request->Result.Cells.Append(cells);
+	request->Result.Costs.Append(costs);
+	Found.Add(request);
+	return request->Handle;
+}
+
+bool FPathRequestQueue::HasLiveRequest(const UObject* requester, int32 targetIndex) const
+{
+	const int32* handle = requester ? RequesterHandles.Find(requester) : nullptr;
+	if (!handle) return false;
+
+	FRequestPtr existing = Find(*handle);
+	return existing.IsValid() && existing->TargetIndex == targetIndex;
+}
+
+FPathRequestQueue::FRequestPtr FPathRequestQueue::CreateRequest(const UObject* requester, int32 startIndex, int32 targetIndex)
+{
+	if (requester)
+	{
+		//Same target as the live request, keep it instead of restarting the search
+		if (HasLiveRequest(requester, targetIndex)) return nullptr;
+		if (const int32* existingHandle = RequesterHandles.Find(requester)) Cancel(*existingHandle);
+	}
+
+	FRequestPtr request = MakeShared<FRequest, ESPMode::ThreadSafe>();
+	request->Handle = NextHandle;
+	request->Requester = requester;
+	request->StartIndex = startIndex;
+	request->TargetIndex = targetIndex;
+	if (FreeResults.Num() > 0)
+	{
+		request->Result = MoveTemp(FreeResults.Last());
+		FreeResults.Pop(false);
+	}
+	request->Result.Handle = NextHandle;
+	request->Result.Requester = requester;
+	request->Result.StartIndex = startIndex;
+	request->Result.TargetIndex = targetIndex;
+	request->Result.GridChangeCount = GridChangeCount;
+	NextHandle = NextHandle == MAX_int32 ? 0 : NextHandle + 1;
+
+	if (requester) RequesterHandles.Add(requester, request->Handle);
+	return request;
+}
+
+void FPathRequestQueue::Cancel(int32 handle)
+{
+	FRequestPtr request = Find(handle);
+	if (!request.IsValid()) return;
+
+	request->bCancelled = true;
+	Found.Remove(request);
+	Held.Remove(request);
+	Waiting.Remove(request);
+	if (Sliced == request) Sliced.Reset();
+	//Running requests stay in the list until their task returns, their result is then dropped
+
+	if (request->Requester && RequesterHandles.FindRef(request->Requester) == handle) RequesterHandles.Remove(request->Requester);
+}
+
+void FPathRequestQueue::CancelAll()
+{
+	for (auto& request : Running) request->bCancelled = true;
+	Found.Empty();
+	Held.Empty();
+	Waiting.Empty();
+	Sliced.Reset();
+	RequesterHandles.Empty();
+}
+
+bool FPathRequestQueue::IsPending(int32 handle) const
+{
+	return Find(handle).IsValid();
+}
+
+void FPathRequestQueue::Tick(EPathRequestMode mode, float budgetMicroseconds, int32 maxWorkerTasks, TArray<FPathRequestResult>& outResults)
+{
+	//Searches left running on workers by another mode are finished first, so nothing depends on their timing
+	if (mode == SAME_TICK) WaitForWorkers();
+
+	for (const FRequestPtr& request : Found) Finish(request, outResults);
+	Found.Empty();
+
+	for (int32 i = 0; i < Running.Num();)
+	{
+		if (!Running[i]->Task.IsReady())
+		{
+			i++;
+			continue;
+		}
+
+		if (!Running[i]->bCancelled) Finish(Running[i], outResults);
+		Running.RemoveAt(i);
+	}
+
+	if (mode == WORKER_THREADS)
+	{
+		//A search left over from time-sliced mode starts again on a worker
+		if (Sliced.IsValid())
+		{
+			Waiting.Insert(Sliced, 0);
+			Sliced.Reset();
+		}
+
+		int32 dispatched = 0;
+		while (dispatched < Waiting.Num() && Running.Num() < maxWorkerTasks)
+		{
+			Dispatch(Waiting[dispatched++]);
+		}
+		Waiting.RemoveAt(0, dispatched);
+	}
+	else if (mode == SAME_TICK)
+	{
+		TickSameTick(outResults);
+	}
+	else
+	{
+		TickTimeSliced(budgetMicroseconds, outResults);
+	}
+}
+
+void FPathRequestQueue::WaitForWorkers()
+{
+	for (auto& request : Running)
+	{
+		if (request->Task.IsValid()) request->Task.Wait();
+	}
+}
+
+void FPathRequestQueue::Recycle(TArray<FPathRequestResult>& results)
+{
+	for (FPathRequestResult& result : results)
+	{
+		if (FreeResults.Num() >= MAX_FREE_RESULTS) break;
+
+		result.bFound = false;
+		result.bFromCache = false;
+		result.Cells.Reset();
+		result.Costs.Reset();
+		result.Waypoints.Reset();
+		result.MissingChunks.Reset();
+		FreeResults.Add(MoveTemp(result));
+	}
+	results.Reset();
+}
+
+void FPathRequestQueue::Dispatch(const FRequestPtr& request)
+{
+	const FPathSearchFunction* searchFunction = &SearchFunction;
+	const FPathMissingChunksFunction* missingChunksFunction = &MissingChunksFunction;
+
+	//Tasks are only started from the game thread and the grid is only changed there after WaitForWorkers, so the grid is stable while they run
+	request->Task = Async(EAsyncExecution::TaskGraph, [searchFunction, missingChunksFunction, request]()
+	{
+		if (request->bCancelled) return;
+
+		FPathSearchContext& context = FPathSearchContext::GetThreadContext();
+		request->Result.bFound = (*searchFunction)(context, request->StartIndex, request->TargetIndex, request->Result.Cells, request->Result.Costs, request->Result.Waypoints);
+		if (!request->Result.bFound && *missingChunksFunction) (*missingChunksFunction)(context, request->StartIndex, request->TargetIndex, request->Result.MissingChunks);
+	});
+
+	Running.Add(request);
+}
+
+void FPathRequestQueue::FindMissingChunks(FPathSearchContext& context, FRequest& request) const
+{
+	if (!request.Result.bFound && MissingChunksFunction) MissingChunksFunction(context, request.StartIndex, request.TargetIndex, request.Result.MissingChunks);
+}
+
+void FPathRequestQueue::Finish(const FRequestPtr& request, TArray<FPathRequestResult>& outResults)
+{
+	if (request->Requester && RequesterHandles.FindRef(request->Requester) == request->Handle) RequesterHandles.Remove(request->Requester);
+	outResults.Add(MoveTemp(request->Result));
+}
+
+void FPathRequestQueue::TickTimeSliced(float budgetMicroseconds, TArray<FPathRequestResult>& outResults)
+{
+	double deadline = FPlatformTime::Seconds() + budgetMicroseconds * 1e-6;
+
+	//At least one slice runs every tick so searches always make progress
+	do
+	{
+		if (!Sliced.IsValid())
+		{
+			if (Waiting.Num() == 0) return;
+
+			if (!bStepSearches)
+			{
+				FRequestPtr request = Waiting[0];
+				Waiting.RemoveAt(0);
+				request->Result.bFound = SearchFunction(SlicedContext, request->StartIndex, request->TargetIndex, request->Result.Cells, request->Result.Costs, request->Result.Waypoints);
+				FindMissingChunks(SlicedContext, *request);
+				Finish(request, outResults);
+				continue;
+			}
+
+			Sliced = Waiting[0];
+			Waiting.RemoveAt(0);
+			FGridPathfinder::BeginSearch(*Grid, SlicedContext, SlicedContext.OpenCells, Sliced->StartIndex, Sliced->TargetIndex);
+		}
+
+		EPathSearchStatus status = FGridPathfinder::Step(*Grid, SlicedContext, SlicedContext.OpenCells, EXPANSIONS_PER_SLICE);
+		if (status != EPathSearchStatus::InProgress)
+		{
+			Sliced->Result.bFound = status == EPathSearchStatus::Found;
+			if (Sliced->Result.bFound) FGridPathfinder::BuildPath(SlicedContext, Sliced->Result.Cells, Sliced->Result.Costs);
+			FindMissingChunks(SlicedContext, *Sliced);
+
+			Finish(Sliced, outResults);
+			Sliced.Reset();
+		}
+	} while (FPlatformTime::Seconds() < deadline);
+}
+
+void FPathRequestQueue::TickSameTick(TArray<FPathRequestResult>& outResults)
+{
+	//A search left over from time-sliced mode starts again from the beginning
+	if (Sliced.IsValid())
+	{
+		Waiting.Insert(Sliced, 0);
+		Sliced.Reset();
+	}
+
+	for (const FRequestPtr& request : Waiting)
+	{
+		request->Result.bFound = SearchFunction(SlicedContext, request->StartIndex, request->TargetIndex, request->Result.Cells, request->Result.Costs, request->Result.Waypoints);
+		FindMissingChunks(SlicedContext, *request);
+		Finish(request, outResults);
+	}
+	Waiting.Empty();
+}
+
+FPathRequestQueue::FRequestPtr FPathRequestQueue::Find(int32 handle) const
+{
+	auto matches = [handle](const FRequestPtr& request) { return request->Handle == handle && !request->bCancelled; };
+
+	if (Sliced.IsValid() && matches(Sliced)) return Sliced;
+	if (const FRequestPtr* request = Found.FindByPredicate(matches)) return *request;
+	if (const FRequestPtr* request = Held.FindByPredicate(matches)) return *request;
+	if (const FRequestPtr* request = Waiting.FindByPredicate(matches)) return *request;
+	if (const FRequestPtr* request = Running.FindByPredicate(matches)) return *request;
+	return nullptr;
+}
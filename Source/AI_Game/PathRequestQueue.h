@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Templates/Atomic.h"
+#include "NavGrid.h"
+#include "PathSearchContext.h"
+#include "PathRequestQueue.generated.h"
+
+UENUM()
+enum EPathRequestMode
+{
+	WORKER_THREADS	UMETA(DisplayName = "Worker Threads"),
+	TIME_SLICED		UMETA(DisplayName = "Time Sliced"),
+	//Every request finishes on the game thread in the tick after it was made, in request order. Deterministic, for simulations.
+	SAME_TICK		UMETA(DisplayName = "Same Tick")
+};
+
+typedef TFunction<bool(FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outCells, TArray<float>& outCosts, TArray<int32>& outWaypoints)> FPathSearchFunction;
+//Runs right after a search failed, with the context it used, on the same thread
+typedef TFunction<void(FPathSearchContext& context, int32 startIndex, int32 targetIndex, TArray<int32>& outMissingChunks)> FPathMissingChunksFunction;
+
+struct FPathRequestResult
+{
+	int32 Handle = INDEX_NONE;
+	const UObject* Requester = nullptr;
+	int32 StartIndex = INDEX_NONE;
+	int32 TargetIndex = INDEX_NONE;
+	bool bFound = false;
+	//Answered by RequestFound, no search ran
+	bool bFromCache = false;
+	//Grid changes counted by the queue when the request was made
+	uint32 GridChangeCount = 0;
+	TArray<int32> Cells;
+	TArray<float> Costs;
+	TArray<int32> Waypoints;
+	//Unloaded chunks of a streamed grid a failed search could have gone on into
+	TArray<int32> MissingChunks;
+};
+
+/**
+ * Queue of pending path searches.
+ * Searches either run on the task graph or are time-sliced on the game thread, finished ones are handed back by Tick.
+ * Each requester has at most one live request: asking again for the same target reuses it, asking for a new target cancels it.
+ * A request can be held back until the data it needs is there, it keeps its handle and is only searched once released.
+ */
+class AI_GAME_API FPathRequestQueue
+{
+public:
+	//searchFunction runs whole searches, it must be safe to call from worker threads. So must missingChunksFunction, which fills
+	//MissingChunks of the requests whose search failed.
+	void Initialize(const FNavGrid* grid, FPathSearchFunction searchFunction, FPathMissingChunksFunction missingChunksFunction = nullptr);
+	//When false, time-sliced mode runs each search in one go with the search function instead of stepping A*
+	inline void SetStepSearches(bool stepSearches) { bStepSearches = stepSearches; }
+
+	//A held request waits for Release before it is searched
+	int32 Request(const UObject* requester, int32 startIndex, int32 targetIndex, bool bHold = false);
+	//A request already answered, by a cache for instance. It follows the same rules as Request and is handed back by the next Tick.
+	int32 RequestFound(const UObject* requester, int32 startIndex, int32 targetIndex, const TArray<int32>& cells, const TArray<float>& costs);
+	//True if the requester's live request already goes to targetIndex, Request would keep it and return its handle
+	bool HasLiveRequest(const UObject* requester, int32 targetIndex) const;
+	void Release(int32 handle);
+	//Holds the request of a failed result again with the same handle, false if its requester made another request since
+	bool Requeue(FPathRequestResult& result);
+	void Cancel(int32 handle);
+	void CancelAll();
+	bool IsPending(int32 handle) const;
+	inline int32 Num() const { return Found.Num() + Held.Num() + Waiting.Num() + Running.Num() + (Sliced.IsValid() ? 1 : 0); }
+
+	//Starts or advances searches and moves the finished ones into outResults
+	void Tick(EPathRequestMode mode, float budgetMicroseconds, int32 maxWorkerTasks, TArray<FPathRequestResult>& outResults);
+	//Blocks until every search running on a worker thread has returned, call it before changing the grid
+	void WaitForWorkers();
+	//Takes back the results Tick handed out, the next requests fill their buffers instead of allocating new ones
+	void Recycle(TArray<FPathRequestResult>& results);
+
+	//Call after cells changed, the requests made before are not searched on the grid as it is now
+	inline void OnGridChanged() { GridChangeCount++; }
+	//False if the grid changed since the request was made, even if it was after the search finished
+	inline bool IsOnCurrentGrid(const FPathRequestResult& result) const { return result.GridChangeCount == GridChangeCount; }
+
+private:
+	struct FRequest
+	{
+		int32 Handle = INDEX_NONE;
+		const UObject* Requester = nullptr;
+		int32 StartIndex = INDEX_NONE;
+		int32 TargetIndex = INDEX_NONE;
+		TAtomic<bool> bCancelled { false };
+		FPathRequestResult Result;
+		TFuture<void> Task;
+	};
+	typedef TSharedPtr<FRequest, ESPMode::ThreadSafe> FRequestPtr;
+
+	//Replaces the requester's live request, returns nullptr if that one already goes to targetIndex
+	FRequestPtr CreateRequest(const UObject* requester, int32 startIndex, int32 targetIndex);
+	void Dispatch(const FRequestPtr& request);
+	void Finish(const FRequestPtr& request, TArray<FPathRequestResult>& outResults);
+	//Runs the missing chunks function on the game thread after the request's search failed
+	void FindMissingChunks(FPathSearchContext& context, FRequest& request) const;
+	void TickTimeSliced(float budgetMicroseconds, TArray<FPathRequestResult>& outResults);
+	void TickSameTick(TArray<FPathRequestResult>& outResults);
+	FRequestPtr Find(int32 handle) const;
+
+	const FNavGrid* Grid = nullptr;
+	FPathSearchFunction SearchFunction;
+	FPathMissingChunksFunction MissingChunksFunction;
+	bool bStepSearches = true;
+
+	TArray<FRequestPtr> Found;
+	TArray<FRequestPtr> Held;
+	TArray<FRequestPtr> Waiting;
+	TArray<FRequestPtr> Running;
+	FRequestPtr Sliced;
+	FPathSearchContext SlicedContext;
+
+	TMap<const UObject*, int32> RequesterHandles;
+	TArray<FPathRequestResult> FreeResults;
+	int32 NextHandle = 0;
+	uint32 GridChangeCount = 0;
+};
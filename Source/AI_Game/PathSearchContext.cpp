@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PathSearchContext.h"
+
+void FPathSearchContext::BeginQuery(int32 cellCount)
+{
+	//Arrays only grow, so one context can serve grids and graphs of different sizes without reallocating
+	if (VisitedGenerations.Num() < cellCount)
+	{
+		GCosts.SetNumUninitialized(cellCount);
+		HCosts.SetNumUninitialized(cellCount);
+		ParentIndices.SetNumUninitialized(cellCount);
+		VisitedGenerations.Init(0, cellCount);
+		ClosedGenerations.Init(0, cellCount);
+		Generation = 0;
+	}
+
+	//Generation 0 is never used, so freshly initialized stamps always read as unvisited
+	if (++Generation == 0)
+	{
+		FMemory::Memzero(VisitedGenerations.GetData(), VisitedGenerations.Num() * sizeof(uint32));
+		FMemory::Memzero(ClosedGenerations.GetData(), ClosedGenerations.Num() * sizeof(uint32));
+		Generation = 1;
+	}
+
+	OpenCells.Reset(cellCount);
+	ExpandedCells = 0;
+}
+
+FPathSearchContext& FPathSearchContext::GetThreadContext()
+{
+	static thread_local FPathSearchContext context;
+	return context;
+}
+
+SIZE_T FPathSearchContext::GetAllocatedSize() const
+{
+	return OpenCells.GetAllocatedSize() + GCosts.GetAllocatedSize() + HCosts.GetAllocatedSize() + ParentIndices.GetAllocatedSize()
+		+ VisitedGenerations.GetAllocatedSize() + ClosedGenerations.GetAllocatedSize();
+}
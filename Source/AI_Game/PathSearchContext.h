@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CellHeap.h"
+
+/**
+ * Per-query A* state (costs, parents, open and closed cells).
+ * Entries are stamped with the generation of the query that wrote them, so starting a new query never has to clear the arrays.
+ * A context must only be used by one search at a time, use GetThreadContext to get one owned by the calling thread.
+ */
+class AI_GAME_API FPathSearchContext
+{
+public:
+	//Starts a new query over cellCount cells (or nodes), everything written by previous queries becomes unvisited
+	void BeginQuery(int32 cellCount);
+
+	FORCEINLINE bool IsVisited(int32 index) const { return VisitedGenerations[index] == Generation; }
+	FORCEINLINE bool IsClosed(int32 index) const { return ClosedGenerations[index] == Generation; }
+
+	FORCEINLINE void Visit(int32 index, float gCost, float hCost, int32 parentIndex)
+	{
+		VisitedGenerations[index] = Generation;
+		GCosts[index] = gCost;
+		HCosts[index] = hCost;
+		ParentIndices[index] = parentIndex;
+	}
+	FORCEINLINE void Close(int32 index) { ClosedGenerations[index] = Generation; }
+
+	FORCEINLINE float GetGCost(int32 index) const { return GCosts[index]; }
+	FORCEINLINE float GetHCost(int32 index) const { return HCosts[index]; }
+	FORCEINLINE int32 GetParentIndex(int32 index) const { return ParentIndices[index]; }
+
+	FCellHeap OpenCells;
+	int32 ExpandedCells = 0;
+	int32 StartIndex = INDEX_NONE;
+	int32 TargetIndex = INDEX_NONE;
+	FIntVector TargetCoordinates;
+
+	//Context owned by the calling thread, for searches running on the task graph
+	static FPathSearchContext& GetThreadContext();
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	TArray<float> GCosts;
+	TArray<float> HCosts;
+	TArray<int32> ParentIndices;
+	TArray<uint32> VisitedGenerations;
+	TArray<uint32> ClosedGenerations;
+	uint32 Generation = 0;
+};
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PathSmoother.h"
+
+int32 FPathSmoother::Smooth(const FNavGrid& grid, int32 startIndex, TArray<int32>& cells, TArray<float>& costs, int32 firstCell)
+{
+	if (firstCell < 0 || cells.Num() - firstCell < 2) return 0;
+
+	int32 anchorIndex = firstCell > 0 ? cells[firstCell - 1] : startIndex;
+	if (!grid.IsValidIndex(anchorIndex)) return 0;
+
+	//Most expensive cell the original path walks through since the anchor
+	float stretchMoveCost = grid.GetMoveCost(cells[firstCell]);
+	int32 writeCell = firstCell;
+	for (int32 i = firstCell + 1; i < cells.Num(); i++)
+	{
+		stretchMoveCost = FMath::Max(stretchMoveCost, grid.GetMoveCost(cells[i]));
+		if (HasLineOfSight(grid, anchorIndex, cells[i], stretchMoveCost)) continue;
+
+		//The previous cell is the furthest one in sight, it becomes the next waypoint
+		cells[writeCell] = cells[i - 1];
+		costs[writeCell] = costs[i - 1];
+		writeCell++;
+		anchorIndex = cells[i - 1];
+		stretchMoveCost = grid.GetMoveCost(cells[i]);
+	}
+	cells[writeCell] = cells.Last();
+	costs[writeCell] = costs.Last();
+	writeCell++;
+
+	int32 removed = cells.Num() - writeCell;
+	cells.SetNum(writeCell, false);
+	costs.SetNum(writeCell, false);
+	return removed;
+}
+
+bool FPathSmoother::HasLineOfSight(const FNavGrid& grid, int32 fromIndex, int32 toIndex, float maxMoveCost)
+{
+	if (!grid.IsValidIndex(fromIndex) || !grid.IsValidIndex(toIndex)) return false;
+
+	FIntVector from = grid.GetCoordinates(fromIndex);
+	FIntVector to = grid.GetCoordinates(toIndex);
+	int32 dx = FMath::Abs(to.X - from.X);
+	int32 dy = FMath::Abs(to.Y - from.Y);
+	int32 stepX = to.X > from.X ? 1 : -1;
+	int32 stepY = to.Y > from.Y ? 1 : -1;
+
+	//Supercover: every cell the segment passes through, one straight step at a time
+	int32 x = from.X;
+	int32 y = from.Y;
+	int32 index = fromIndex;
+	int32 error = dx - dy;
+	for (int32 steps = dx + dy; steps > 0; steps--)
+	{
+		int32 nextIndex;
+		if (error > 0)
+		{
+			if (!CanEnter(grid, index, x + stepX, y, maxMoveCost, nextIndex)) return false;
+			x += stepX;
+			error -= 2 * dy;
+		}
+		else if (error < 0)
+		{
+			if (!CanEnter(grid, index, x, y + stepY, maxMoveCost, nextIndex)) return false;
+			y += stepY;
+			error += 2 * dx;
+		}
+		else
+		{
+			//Through a corner: the segment grazes both cells beside it, both have to be walkable and lead to the diagonal cell
+			int32 sideX;
+			int32 sideY;
+			int32 cornerIndex;
+			if (!CanEnter(grid, index, x + stepX, y, maxMoveCost, sideX) || !CanEnter(grid, sideX, x + stepX, y + stepY, maxMoveCost, cornerIndex)) return false;
+			if (!CanEnter(grid, index, x, y + stepY, maxMoveCost, sideY) || !CanEnter(grid, sideY, x + stepX, y + stepY, maxMoveCost, cornerIndex)) return false;
+			x += stepX;
+			y += stepY;
+			error += 2 * dx - 2 * dy;
+			nextIndex = cornerIndex;
+			steps--;
+		}
+		index = nextIndex;
+	}
+	//On a layered grid the walk can end on another layer of the target's column
+	return index == toIndex;
+}
+
+bool FPathSmoother::CanEnter(const FNavGrid& grid, int32 fromIndex, int32 x, int32 y, float maxMoveCost, int32& outIndex)
+{
+	//The link covers what the cell states don't, like slopes too steep to climb, and picks the layer of the column on layered grids
+	FIntVector from = grid.GetCoordinates(fromIndex);
+	outIndex = grid.GetNeighbor(fromIndex, x - from.X, y - from.Y);
+	return outIndex != INDEX_NONE && grid.GetState(outIndex) != ECellState::BLOCKED && grid.GetMoveCost(outIndex) <= maxMoveCost;
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavGrid.h"
+
+/**
+ * String pulling over an FNavGrid: drops the cells of a path that an agent can skip by walking straight to a later one.
+ * Line of sight is a supercover walk over the cell states and links, no physics traces. It only crosses cells that can be
+ * walked, through links that exist, and on grids with move costs never through a cell dearer than the stretch it replaces.
+ */
+class AI_GAME_API FPathSmoother
+{
+public:
+	//Smooths cells[firstCell...] in place, walking from startIndex or from the cell before firstCell. The last cell is always kept.
+	//The costs kept are still the ones of walking the original path to each cell. Returns the number of cells removed.
+	static int32 Smooth(const FNavGrid& grid, int32 startIndex, TArray<int32>& cells, TArray<float>& costs, int32 firstCell = 0);
+
+	//True if every cell the segment between the two cell centers touches can be walked and costs at most maxMoveCost
+	static bool HasLineOfSight(const FNavGrid& grid, int32 fromIndex, int32 toIndex, float maxMoveCost = MAX_flt);
+
+private:
+	static bool CanEnter(const FNavGrid& grid, int32 fromIndex, int32 x, int32 y, float maxMoveCost, int32& outIndex);
+};
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PathfindingBenchmarkCommandlet.h"
+#include "GridManager.h"
+#include "Engine/Engine.h"
+
+UPathfindingBenchmarkCommandlet::UPathfindingBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = true;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UPathfindingBenchmarkCommandlet::Main(const FString& Params)
+{
+#if UE_BUILD_SHIPPING
+	UE_LOG(LogTemp, Error, TEXT("PathfindingBenchmark: the benchmarks are not built in shipping builds"));
+	return 1;
+#else
+	int32 queryCount = 100;
+	int32 seed = 0;
+	int32 gridSize = 256;
+	float obstacleDensity = 0.2f;
+	FString outputFile;
+	FParse::Value(*Params, TEXT("queries="), queryCount);
+	FParse::Value(*Params, TEXT("seed="), seed);
+	FParse::Value(*Params, TEXT("gridsize="), gridSize);
+	FParse::Value(*Params, TEXT("density="), obstacleDensity);
+	FParse::Value(*Params, TEXT("output="), outputFile);
+	bool runSuite = FParse::Param(*Params, TEXT("suite"));
+
+	if (queryCount <= 0 || gridSize < 8)
+	{
+		UE_LOG(LogTemp, Error, TEXT("PathfindingBenchmark: invalid arguments, expected -queries > 0 and -gridsize >= 8"));
+		return 1;
+	}
+
+	UWorld* world = UWorld::CreateWorld(EWorldType::Game, false, TEXT("PathfindingBenchmark"));
+	FWorldContext& worldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	worldContext.SetCurrentWorld(world);
+
+	FActorSpawnParameters spawnParams;
+	spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AGridManager* gridManager = world->SpawnActor<AGridManager>(FVector::ZeroVector, FRotator::ZeroRotator, spawnParams);
+
+	int32 result = 0;
+	if (runSuite)
+	{
+		result = gridManager->RunBenchmarkSuite(queryCount, seed, outputFile).IsEmpty() ? 1 : 0;
+	}
+	else
+	{
+		gridManager->BenchmarkPathfinding(queryCount, seed, gridSize, obstacleDensity);
+	}
+
+	GEngine->DestroyWorldContext(world);
+	world->DestroyWorld(false);
+	return result;
+#endif
+}
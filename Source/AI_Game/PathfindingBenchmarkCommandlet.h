@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PathfindingBenchmarkCommandlet.generated.h"
+
+/**
+ * Runs the pathfinding benchmarks on a grid manager of its own, in a world with nothing else in it, so they never touch the grid
+ * of a level. Logs the engines compared on one generated grid, or with -suite writes the report of AGridManager::RunBenchmarkSuite:
+ * UE4Editor-Cmd AI_Game -run=PathfindingBenchmark -queries=100 -seed=0 -gridsize=256 -density=0.2 -nullrhi
+ * UE4Editor-Cmd AI_Game -run=PathfindingBenchmark -suite -queries=100 -seed=0 -output=Pathfinding.json -nullrhi
+ */
+UCLASS()
+class AI_GAME_API UPathfindingBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPathfindingBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
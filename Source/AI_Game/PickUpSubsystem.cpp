@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PickUpSubsystem.h"
+#include "BasePickUp.h"
+#include "GridManager.h"
+
+void UPickUpSubsystem::RegisterPickUp(ABasePickUp* pickUp)
+{
+	if (!pickUp) return;
+
+	for (const FName& tag : pickUp->Tags)
+	{
+		FPickUpSet& set = PickUpSets.FindOrAdd(tag);
+		set.PickUps.AddUnique(pickUp);
+		set.Dirty = true;
+	}
+}
+
+void UPickUpSubsystem::UnregisterPickUp(ABasePickUp* pickUp)
+{
+	for (auto& pair : PickUpSets)
+	{
+		if (pair.Value.PickUps.Remove(pickUp) > 0) pair.Value.Dirty = true;
+	}
+}
+
+void UPickUpSubsystem::OnValidPickUpChanged(ABasePickUp* pickUp)
+{
+	if (!pickUp) return;
+
+	for (const FName& tag : pickUp->Tags)
+	{
+		if (FPickUpSet* set = PickUpSets.Find(tag)) set->Dirty = true;
+	}
+}
+
+FPickUpSet* UPickUpSubsystem::GetUpdatedSet(FName tag)
+{
+	FPickUpSet* set = PickUpSets.Find(tag);
+	if (!set || !set->Dirty) return set;
+
+	set->ValidPickUps.Reset();
+	TArray<FVector> locations;
+	for (ABasePickUp* pickUp : set->PickUps)
+	{
+		if (!IsValid(pickUp) || !pickUp->IsValidPickUp()) continue;
+
+		set->ValidPickUps.Add(pickUp);
+		locations.Add(pickUp->GetActorLocation());
+	}
+	set->Hash.Build(locations, HashCellSize);
+	set->Dirty = false;
+	return set;
+}
+
+ABasePickUp* UPickUpSubsystem::FindNearestPickUp(FName tag, FVector location, AGridManager* gridManager)
+{
+	FPickUpSet* set = GetUpdatedSet(tag);
+	if (!set || set->ValidPickUps.Num() == 0) return nullptr;
+
+	if (IsValid(gridManager))
+	{
+		TArray<int32> goalCells;
+		goalCells.SetNumUninitialized(set->ValidPickUps.Num());
+		for (int32 i = 0; i < set->ValidPickUps.Num(); i++) goalCells[i] = gridManager->GetClosestWalkableCellIndex(set->ValidPickUps[i]->GetActorLocation());
+
+		const FFlowField* flowField = gridManager->GetFlowField(goalCells);
+		int32 goalCell = flowField ? flowField->FindGoal(gridManager->GetClosestWalkableCellIndex(location)) : INDEX_NONE;
+		if (goalCell != INDEX_NONE) return set->ValidPickUps[goalCells.IndexOfByKey(goalCell)];
+	}
+
+	//None of them can be reached over the grid, the straight line one is still worth walking towards
+	TArray<int32> candidates;
+	set->Hash.FindNearest(location, 1, MAX_flt, candidates);
+	return candidates.Num() > 0 ? set->ValidPickUps[candidates[0]] : nullptr;
+}
+
+int32 UPickUpSubsystem::GetValidPickUpCount(FName tag)
+{
+	FPickUpSet* set = GetUpdatedSet(tag);
+	return set ? set->ValidPickUps.Num() : 0;
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SpatialHash.h"
+#include "PickUpSubsystem.generated.h"
+
+class ABasePickUp;
+class AGridManager;
+
+//The pick ups sharing one tag, with a spatial hash of the ones that can be picked up
+USTRUCT()
+struct FPickUpSet
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		TArray<ABasePickUp*> PickUps;
+	//Hash point i is ValidPickUps[i]
+	UPROPERTY()
+		TArray<ABasePickUp*> ValidPickUps;
+	FSpatialHash Hash;
+	//A pick up was added, removed or changed ValidPickUp since the hash was built
+	bool Dirty = true;
+};
+
+/**
+ * Registry of the pick ups in the world, by tag ("AmmoPickUp", "HealthPickUp").
+ * Pick ups register themselves in BeginPlay and report when they are taken or come back, so finding the nearest one
+ * never iterates the actors of the world. They don't move, the hash of a tag is only rebuilt after one of them changed.
+ */
+UCLASS()
+class AI_GAME_API UPickUpSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterPickUp(ABasePickUp* pickUp);
+	void UnregisterPickUp(ABasePickUp* pickUp);
+	void OnValidPickUpChanged(ABasePickUp* pickUp);
+
+	//Nearest pick up with the tag that can be picked up, nullptr if there is none.
+	//With a grid manager the distance is the one walked over the grid, read from one flow field out from every pick up of the tag
+	//that is kept until they or the cells change. Otherwise, or if none can be reached, it is a straight line.
+	UFUNCTION(BlueprintCallable)
+		ABasePickUp* FindNearestPickUp(FName tag, FVector location, AGridManager* gridManager = nullptr);
+
+	UFUNCTION(BlueprintCallable)
+		int32 GetValidPickUpCount(FName tag);
+
+protected:
+	UPROPERTY(Transient)
+		TMap<FName, FPickUpSet> PickUpSets;
+
+	//Cell size of the hashes
+	float HashCellSize = 2000.0f;
+
+	FPickUpSet* GetUpdatedSet(FName tag);
+};
@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpatialHash.h"
+
+void FSpatialHash::Build(const TArray<FVector>& points, float cellSize)
+{
+	Points = points;
+	CellSize = FMath::Max(cellSize, 1.0f);
+	uint32 bucketCount = FMath::RoundUpToPowerOfTwo(FMath::Max(Points.Num() * 2, 2));
+	BucketMask = bucketCount - 1;
+
+	//Counting sort of the points by bucket
+	TArray<int32> buckets;
+	buckets.SetNumUninitialized(Points.Num());
+	BucketStarts.Init(0, bucketCount + 1);
+	MinCell = FIntPoint(MAX_int32, MAX_int32);
+	MaxCell = FIntPoint(MIN_int32, MIN_int32);
+	for (int32 i = 0; i < Points.Num(); i++)
+	{
+		FIntPoint cell = GetCell(Points[i]);
+		MinCell = FIntPoint(FMath::Min(MinCell.X, cell.X), FMath::Min(MinCell.Y, cell.Y));
+		MaxCell = FIntPoint(FMath::Max(MaxCell.X, cell.X), FMath::Max(MaxCell.Y, cell.Y));
+		buckets[i] = GetBucket(cell);
+		BucketStarts[buckets[i] + 1]++;
+	}
+	for (uint32 bucket = 0; bucket < bucketCount; bucket++) BucketStarts[bucket + 1] += BucketStarts[bucket];
+
+	TArray<int32> nextSlots(BucketStarts.GetData(), bucketCount);
+	SortedPoints.SetNumUninitialized(Points.Num());
+	for (int32 i = 0; i < Points.Num(); i++) SortedPoints[nextSlots[buckets[i]]++] = i;
+}
+
+void FSpatialHash::Empty()
+{
+	Points.Empty();
+	SortedPoints.Empty();
+	BucketStarts.Empty();
+	BucketMask = 0;
+}
+
+void FSpatialHash::GatherCell(const FIntPoint& cell, const FVector& location, float radiusSquared, int32 ignoreIndex, TArray<TPair<float, int32>>& outCandidates) const
+{
+	int32 bucket = GetBucket(cell);
+	for (int32 slot = BucketStarts[bucket]; slot < BucketStarts[bucket + 1]; slot++)
+	{
+		int32 index = SortedPoints[slot];
+		//Other cells hashed into the same bucket are filtered out here too
+		if (index == ignoreIndex || GetCell(Points[index]) != cell) continue;
+
+		float distanceSquared = FVector::DistSquared(location, Points[index]);
+		if (distanceSquared <= radiusSquared) outCandidates.Emplace(distanceSquared, index);
+	}
+}
+
+void FSpatialHash::FindInRadius(const FVector& location, float radius, TArray<int32>& outIndices, int32 ignoreIndex) const
+{
+	outIndices.Reset();
+	if (Points.Num() == 0 || radius < 0.0f) return;
+
+	TArray<TPair<float, int32>> candidates;
+	//A radius much larger than the cells would visit the same buckets over and over, every bucket once is enough then
+	float cellSpan = radius * 2.0f / CellSize + 2.0f;
+	if (cellSpan * cellSpan > float(BucketMask) + 1.0f)
+	{
+		for (int32 index = 0; index < Points.Num(); index++)
+		{
+			float distanceSquared = FVector::DistSquared(location, Points[index]);
+			if (index != ignoreIndex && distanceSquared <= radius * radius) candidates.Emplace(distanceSquared, index);
+		}
+	}
+	else
+	{
+		FIntPoint minCell = GetCell(location - FVector(radius));
+		FIntPoint maxCell = GetCell(location + FVector(radius));
+		for (int32 y = minCell.Y; y <= maxCell.Y; y++)
+		{
+			for (int32 x = minCell.X; x <= maxCell.X; x++) GatherCell(FIntPoint(x, y), location, radius * radius, ignoreIndex, candidates);
+		}
+	}
+
+	//Equal distances keep the order of the points, the result doesn't depend on the cells
+	candidates.Sort([](const TPair<float, int32>& a, const TPair<float, int32>& b) { return a.Key < b.Key || (a.Key == b.Key && a.Value < b.Value); });
+	outIndices.Reserve(candidates.Num());
+	for (const auto& candidate : candidates) outIndices.Add(candidate.Value);
+}
+
+void FSpatialHash::FindNearest(const FVector& location, int32 count, float maxRadius, TArray<int32>& outIndices, int32 ignoreIndex) const
+{
+	outIndices.Reset();
+	if (Points.Num() == 0 || count <= 0 || maxRadius < 0.0f) return;
+
+	//Rings of cells around the location's cell, until the count nearest found are closer than anything in the next ring
+	TArray<TPair<float, int32>> candidates;
+	FIntPoint center = GetCell(location);
+	int64 boundsRing = FMath::Max(FMath::Max(int64(center.X) - MinCell.X, int64(MaxCell.X) - center.X), FMath::Max(int64(center.Y) - MinCell.Y, int64(MaxCell.Y) - center.Y));
+	int32 maxRing = int32(FMath::Min(int64(FMath::Min(maxRadius / CellSize, float(MAX_int32 / 4))) + 1, boundsRing));
+	auto byDistance = [](const TPair<float, int32>& a, const TPair<float, int32>& b) { return a.Key < b.Key || (a.Key == b.Key && a.Value < b.Value); };
+	if (int64(maxRing * 2 + 1) * (maxRing * 2 + 1) > int64(BucketMask) + 1)
+	{
+		//Same as FindInRadius, with few points in a large radius looking at all of them is cheaper
+		FindInRadius(location, maxRadius, outIndices, ignoreIndex);
+		if (outIndices.Num() > count) outIndices.SetNum(count, false);
+		return;
+	}
+	for (int32 ring = 0; ring <= maxRing; ring++)
+	{
+		for (int32 y = center.Y - ring; y <= center.Y + ring; y++)
+		{
+			//Inner rows only have the two cells on the ring's sides
+			int32 step = (y == center.Y - ring || y == center.Y + ring) ? 1 : FMath::Max(ring * 2, 1);
+			for (int32 x = center.X - ring; x <= center.X + ring; x += step)
+			{
+				GatherCell(FIntPoint(x, y), location, maxRadius * maxRadius, ignoreIndex, candidates);
+			}
+		}
+
+		if (candidates.Num() < count) continue;
+		candidates.Sort(byDistance);
+		candidates.SetNum(count, false);
+		//The next ring is at least ring cells away from the location in X or Y
+		float nextRingDistance = ring * CellSize;
+		if (candidates.Last().Key <= nextRingDistance * nextRingDistance) break;
+	}
+
+	candidates.Sort(byDistance);
+	if (candidates.Num() > count) candidates.SetNum(count, false);
+	outIndices.Reserve(candidates.Num());
+	for (const auto& candidate : candidates) outIndices.Add(candidate.Value);
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Spatial hash of points on the XY plane, rebuilt from scratch whenever the points move.
+ * Points are bucketed by the square cell they fall in, the cells are hashed into a table twice the size of the point count
+ * and the points sorted by bucket, so a build is two linear passes and a query only looks at the buckets of the cells it overlaps.
+ * Distances are 3D. Queries only read, any number of threads can run them at once.
+ */
+class AI_GAME_API FSpatialHash
+{
+public:
+	//A query of radius cellSize overlaps at most 3x3 cells
+	void Build(const TArray<FVector>& points, float cellSize);
+	void Empty();
+
+	FORCEINLINE int32 Num() const { return Points.Num(); }
+	FORCEINLINE const FVector& GetPoint(int32 index) const { return Points[index]; }
+
+	//Indices of the points within radius of location, nearest first. ignoreIndex is left out.
+	void FindInRadius(const FVector& location, float radius, TArray<int32>& outIndices, int32 ignoreIndex = INDEX_NONE) const;
+	//Indices of the count points nearest to location and within maxRadius, nearest first. ignoreIndex is left out.
+	void FindNearest(const FVector& location, int32 count, float maxRadius, TArray<int32>& outIndices, int32 ignoreIndex = INDEX_NONE) const;
+
+	SIZE_T GetAllocatedSize() const { return Points.GetAllocatedSize() + SortedPoints.GetAllocatedSize() + BucketStarts.GetAllocatedSize(); }
+
+private:
+	FORCEINLINE FIntPoint GetCell(const FVector& location) const { return FIntPoint(FMath::FloorToInt(location.X / CellSize), FMath::FloorToInt(location.Y / CellSize)); }
+	FORCEINLINE int32 GetBucket(const FIntPoint& cell) const { return (uint32(cell.X) * 73856093u ^ uint32(cell.Y) * 19349663u) & BucketMask; }
+	//Adds the points of the cell within the radius to outCandidates, with their squared distance
+	void GatherCell(const FIntPoint& cell, const FVector& location, float radiusSquared, int32 ignoreIndex, TArray<TPair<float, int32>>& outCandidates) const;
+
+	float CellSize = 1.0f;
+	uint32 BucketMask = 0;
+	//Cells the points span, rings further out than these are empty
+	FIntPoint MinCell;
+	FIntPoint MaxCell;
+	TArray<FVector> Points;
+	//Point indices sorted by bucket, the points of bucket b are SortedPoints[BucketStarts[b]] to SortedPoints[BucketStarts[b + 1] - 1]
+	TArray<int32> SortedPoints;
+	TArray<int32> BucketStarts;
+};